@@ -230,6 +230,10 @@ void CandidateSet::initParentTrees() {
 
 
 int CandidateSet::update(string newTree, double newScore) {
+    return update(newTree, newScore, getTopology(newTree));
+}
+
+int CandidateSet::update(string newTree, double newScore, uint64_t topology) {
     // Do not update candidate set if the new tree has worse score than the
     // worst tree in the candidate set
     if (newScore < begin()->first && size() >= maxSize) {
@@ -237,7 +241,7 @@ int CandidateSet::update(string newTree, double newScore) {
     }
     CandidateTree candidate;
     candidate.score = newScore;
-    candidate.topology = convertTreeString(newTree);
+    candidate.topology = topology;
     candidate.tree = newTree;
 
     int treePos;
@@ -300,30 +304,18 @@ string CandidateSet::convertTreeString(string treeString, int format) {
     return ostr.str();
 }
 
-string CandidateSet::getTopology(string tree) {
-//	PhyloTree mtree;
-//	mtree.rooted = params->is_rooted;
-//	mtree.aln = this->aln;
-//	mtree.setParams(params);
+uint64_t CandidateSet::getTopology(string tree) {
     MTree mtree;
 
     stringstream str;
     str << tree;
     str.seekg(0, ios::beg);
-//	freeNode();
     mtree.readTree(str, Params::getInstance().is_rooted);
-//	mtree.setAlignment(aln);
-//	mtree.setRootNode(params->root);
     mtree.assignLeafID();
-    string x = "0";
-    mtree.root = mtree.findLeafName(x);
-
-    ostringstream ostr;
-    mtree.printTree(ostr, WT_TAXON_ID | WT_SORT_TAXA);
-    return ostr.str();
+    return mtree.getTopologyFingerprint();
 }
 
-double CandidateSet::getTopologyScore(string topology) {
+double CandidateSet::getTopologyScore(uint64_t topology) {
     assert(topologies.find(topology) != topologies.end());
     return topologies[topology];
 }
@@ -363,15 +355,15 @@ void CandidateSet::getAllTrees(vector<string> &trees, vector<double> &scores, in
     }
 }
 
-bool CandidateSet::treeTopologyExist(string topo) {
+bool CandidateSet::treeTopologyExist(uint64_t topo) {
     return (topologies.find(topo) != topologies.end());
 }
 
 bool CandidateSet::treeExist(string tree) {
-    return treeTopologyExist(convertTreeString(tree));
+    return treeTopologyExist(getTopology(tree));
 }
 
-CandidateSet::iterator CandidateSet::getCandidateTree(string topology) {
+CandidateSet::iterator CandidateSet::getCandidateTree(uint64_t topology) {
     for (CandidateSet::reverse_iterator rit = rbegin(); rit != rend(); rit++) {
         if (rit->second.topology == topology)
             return --(rit.base());
@@ -379,7 +371,7 @@ CandidateSet::iterator CandidateSet::getCandidateTree(string topology) {
     return end();
 }
 
-void CandidateSet::removeCandidateTree(string topology) {
+void CandidateSet::removeCandidateTree(uint64_t topology) {
     bool removed = false;
     double treeScore;
     // Find the score of the topology
@@ -500,7 +492,7 @@ void CandidateSet::printTrees(string suffix) {
     outLHs.precision(15);
     for (reverse_iterator rit = rbegin(); rit != rend(); rit++) {
         outLHs << rit->first << endl;
-        outTrees << rit->second.topology << endl;
+        outTrees << convertTreeString(rit->second.tree) << endl;
     }
     outTrees.close();
     outLHs.close();
@@ -32,6 +32,9 @@
 
 class IQTree;
 
+/** map from topology fingerprint to tree score */
+typedef unordered_map<uint64_t, double> TopologyScoreMap;
+
 struct CandidateTree {
 
 	/**
@@ -41,11 +44,10 @@ struct CandidateTree {
 	string tree;
 
 	/**
-	 * tree topology WITHOUT branch lengths
-	 * and WITH TAXON ID (instead of taxon names)
-	 * for sorting purpose
+	 * fingerprint of the tree topology (see MTree::getTopologyFingerprint)
+	 * to detect duplicated topologies
 	 */
-	string topology;
+	uint64_t topology;
 
 	/**
 	 * log-likelihood or parsimony score
@@ -127,6 +129,15 @@ public:
      */
     int update(string newTree, double newScore);
 
+    /**
+     *  same as above for a tree whose topology fingerprint is already known,
+     *  saves parsing \a newTree
+     *
+     *  @param topology
+     *      fingerprint of \a newTree (see MTree::getTopologyFingerprint)
+     */
+    int update(string newTree, double newScore, uint64_t topology);
+
     /**
      *  Get the \a numBestScores best scores in the candidate set
      *
@@ -182,9 +193,9 @@ public:
      * 	Check if tree topology \a topo already exists
      *
      * 	@param topo
-     * 		Newick string of the tree topology
+     * 		Fingerprint of the tree topology
      */
-    bool treeTopologyExist(string topo);
+    bool treeTopologyExist(uint64_t topo);
 
     /**
      * 	Check if tree \a tree already exists
@@ -208,25 +219,24 @@ public:
     string convertTreeString(const string tree, int format = WT_TAXON_ID | WT_SORT_TAXA);
 
     /**
-     * 	Return a unique topology (sorted by taxon names, rooted at taxon with alphabetically smallest name)
-     * 	without branch lengths
+     * 	Return the topology fingerprint of a tree
      *
      * 	@param tree
-     * 		The newick tree string, from which the topology string will be generated
+     * 		The newick tree string with taxon IDs
      * 	@return
-     * 		Newick string of the tree topology
+     * 		Fingerprint of the tree topology
      */
-    string getTopology(string tree);
+    uint64_t getTopology(string tree);
     
     /**
      * return the score of \a topology
      *
      * @param topology
-     * 		Newick topology
+     * 		Fingerprint of the tree topology
      * @return
      * 		Score of the topology
      */
-    double getTopologyScore(string topology);
+    double getTopologyScore(uint64_t topology);
 
     /**
      *  Empty the candidate set
@@ -275,13 +285,13 @@ public:
      * @param topology
      * @return
      */
-    iterator getCandidateTree(string topology);
+    iterator getCandidateTree(uint64_t topology);
 
     /**
      * Remove candidate trees with topology equal to the specified topology
      * @param topology
      */
-    void removeCandidateTree(string topology);
+    void removeCandidateTree(uint64_t topology);
 
     /**
      *  Remove the worst tree in the candidate set
@@ -291,7 +301,7 @@ public:
     /* Getter and Setter function */
 	void setAln(Alignment* aln);
 
-	const StringDoubleHashMap& getTopologies() const {
+	const TopologyScoreMap& getTopologies() const {
 		return topologies;
 	}
 
@@ -378,9 +388,9 @@ private:
 	SplitIntMap candSplits;
 
     /**
-     *  Map data structure storing <topology_string, score>
+     *  Map data structure storing <topology_fingerprint, score>
      */
-    StringDoubleHashMap topologies;
+    TopologyScoreMap topologies;
 
     /**
      *  Trees used for reproduction
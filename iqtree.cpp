@@ -27,6 +27,9 @@
 #include "model/modelgtr.h"
 #include "model/rategamma.h"
 #include <numeric>
+#include <atomic>
+#include <mutex>
+#include <thread>
 #include "tools.h"
 #include "MPIHelper.h"
 #include "pllnni.h"
@@ -56,6 +59,10 @@ void IQTree::init() {
     nni_cutoff = -1e6;
     nni_sort = false;
     testNNI = false;
+    searchinfo.curPerStrength = Params::getInstance().initPS;
+    perturb_pool_size = Params::getInstance().popSize;
+    nni_worker_lh_size = nni_worker_scale_size = 0;
+    boot_tree_fingerprint = 0;
 //    print_tree_lh = false;
 //    write_intermediate_trees = 0;
 //    max_candidate_trees = 0;
@@ -131,6 +138,15 @@ void IQTree::saveUFBoot(Checkpoint *checkpoint) {
 void IQTree::saveCheckpoint() {
     stop_rule.saveCheckpoint();
     candidateTrees.saveCheckpoint();
+
+    if (params->adaptive_search) {
+        checkpoint->startStruct("AdaptiveSearch");
+        double perturb_strength = searchinfo.curPerStrength;
+        CKP_SAVE(perturb_strength);
+        CKP_SAVE(perturb_pool_size);
+        CKP_VECTOR_SAVE(search_successes);
+        checkpoint->endStruct();
+    }
     
     if (boot_samples.size() > 0 && !boot_trees.front().empty()) {
         saveUFBoot(checkpoint);
@@ -172,6 +188,16 @@ void IQTree::restoreCheckpoint() {
     stop_rule.restoreCheckpoint();
     candidateTrees.restoreCheckpoint();
 
+    if (params->adaptive_search) {
+        checkpoint->startStruct("AdaptiveSearch");
+        double perturb_strength = searchinfo.curPerStrength;
+        CKP_RESTORE(perturb_strength);
+        searchinfo.curPerStrength = perturb_strength;
+        CKP_RESTORE(perturb_pool_size);
+        CKP_VECTOR_RESTORE(search_successes);
+        checkpoint->endStruct();
+    }
+
     if (params->gbo_replicates > 0 && checkpoint->hasKey("UFBoot.logl_cutoff")) {
         checkpoint->startStruct("UFBoot");
 //        CKP_RESTORE(max_candidate_trees);
@@ -431,6 +457,9 @@ IQTree::~IQTree() {
     	aligned_free(boot_samples[0]); // free memory
         boot_samples.clear();
     }
+
+    deleteNNIWorkers();
+    deleteSearchers();
 }
 
 extern const char *aa_model_names_rax[];
@@ -626,8 +655,13 @@ void IQTree::computeInitialTree(string &dist_file, LikelihoodKernel kernel) {
 }
 
 int IQTree::addTreeToCandidateSet(string treeString, double score, bool updateStopRule, int sourceProcID) {
+    // trees from other processes or from the checkpoint only exist as strings
+    return addTreeToCandidateSet(treeString, score, updateStopRule, sourceProcID, candidateTrees.getTopology(treeString));
+}
+
+int IQTree::addTreeToCandidateSet(string treeString, double score, bool updateStopRule, int sourceProcID, uint64_t topology) {
     double curBestScore = candidateTrees.getBestScore();
-    int pos = candidateTrees.update(treeString, score);
+    int pos = candidateTrees.update(treeString, score, topology);
     if (updateStopRule) {
         stop_rule.setCurIt(stop_rule.getCurIt() + 1);
         if (score > curBestScore) {
@@ -638,57 +672,72 @@ int IQTree::addTreeToCandidateSet(string treeString, double score, bool updateSt
                 cout << "UPDATE BEST LOG-LIKELIHOOD: " << score << endl;
             }
             bestcandidate_changed = true;
+            // with -deadline, keep the best tree on disk in case the run is stopped early
+            if (params->deadline > 0)
+                printBestTreeString(treeString);
             // COMMENT OUT: not safe with MPI version
 //            printResultTree();
         }
 
+        if (params->adaptive_search)
+            search_successes.push_back(pos > 0 && pos <= perturb_pool_size);
         curScore = score;
         printIterationInfo(sourceProcID);
     }
     return pos;
 }
 
+void IQTree::adaptSearchParameters() {
+    // 1/5 success rule: judge the last window of iterations by the fraction of trees
+    // that made it into the perturbation pool
+    const int window = 10;
+    stop_rule.adaptUnsuccessIteration(max(params->unsuccess_iteration/2, 1), params->unsuccess_iteration*2);
+    if (search_successes.size() < window)
+        return;
+    double success_rate = (double)count(search_successes.begin(), search_successes.end(), 1) / search_successes.size();
+    search_successes.clear();
+    if (success_rate < 0.1) {
+        // search stagnates: perturb stronger and from a wider pool of trees
+        searchinfo.curPerStrength = min(searchinfo.curPerStrength * 1.25, min(params->initPS * 2, 1.0));
+        perturb_pool_size = min(perturb_pool_size + 1, params->popSize * 2);
+    } else if (success_rate > 0.3) {
+        // search still improves: perturb weaker and focus on the best trees
+        searchinfo.curPerStrength = max(searchinfo.curPerStrength * 0.8, params->initPS / 2);
+        perturb_pool_size = max(perturb_pool_size - 1, max(params->popSize / 2, 1));
+    }
+    if (verbose_mode >= VB_MED)
+        cout << "Success rate " << success_rate << ": perturbation strength " << searchinfo.curPerStrength
+             << ", pool size " << perturb_pool_size << ", " << stop_rule.getUnsuccessIteration()
+             << " unsuccessful iterations to stop" << endl;
+}
+
 void IQTree::initCandidateTreeSet(int nParTrees, int nNNITrees) {
 
     if (nParTrees > 0) {
         if (params->start_tree == STT_RANDOM_TREE)
-            cout << "Generating " << nParTrees  << " random trees... ";
+            cout << "Generating " << nParTrees  << " random trees";
         else
-            cout << "Generating " << nParTrees  << " parsimony trees... ";
+            cout << "Generating " << nParTrees  << " parsimony trees";
+        cout << " and computing their log-likelihoods... ";
         cout.flush();
     }
     double startTime = getRealTime();
 
-#ifdef _OPENMP
-    StrVector pars_trees;
-    if (params->start_tree == STT_PARSIMONY && nParTrees >= 1) {
-        pars_trees.resize(nParTrees);
-        if (aln->ordered_pattern.empty())
-            aln->orderPatternByNumChars();
-        #pragma omp parallel
-        {
-            PhyloTree tree;
-            if (params->constraint_tree_file) {
-                tree.constraintTree.initConstraint(params->constraint_tree_file, aln->getSeqNames());
-            }
-            tree.setParams(params);
-            tree.setParsimonyKernel(params->SSE);
-            #pragma omp for schedule(dynamic)
-            for (int i = 0; i < nParTrees; i++) {
-                tree.computeParsimonyTree(NULL, aln);
-                pars_trees[i] = tree.getTreeString();
-            }
-        }
-    }
-#endif
+    int processID = MPIHelper::getInstance().getProcessID();
 
     int init_size = candidateTrees.size();
+    vector<string> initTreeStrings = candidateTrees.getBestTreeStrings();
+
+    // the start trees are filled in and marked ready one by one
+    StrVector pars_trees(nParTrees);
+    vector<uint64_t> pars_topologies(nParTrees);
+    vector<atomic<int> > pars_ready(nParTrees);
+    for (int i = 0; i < nParTrees; i++)
+        pars_ready[i] = 0;
 
-    int processID = MPIHelper::getInstance().getProcessID();
 //    unsigned long curNumTrees = candidateTrees.size();
-    for (int treeNr = 1; treeNr <= nParTrees; treeNr++) {
+    for (int treeNr = 1; treeNr <= nParTrees && params->start_tree != STT_PARSIMONY; treeNr++) {
         int parRandSeed = Params::getInstance().ran_seed + processID * nParTrees + treeNr;
-        string curParsTree;
 
         /********* Create parsimony tree using PLL *********/
         if (params->start_tree == STT_PLL_PARSIMONY) {
@@ -698,62 +747,106 @@ void IQTree::initCandidateTreeSet(int nParTrees, int nNNITrees) {
 			pllTreeToNewick(pllInst->tree_string, pllInst, pllPartitions,
 					pllInst->start->back, PLL_FALSE, PLL_TRUE, PLL_FALSE,
 					PLL_FALSE, PLL_FALSE, PLL_SUMMARIZE_LH, PLL_FALSE, PLL_FALSE);
-			curParsTree = string(pllInst->tree_string);
+			string curParsTree = string(pllInst->tree_string);
 			PhyloTree::readTreeStringSeqName(curParsTree);
 			wrapperFixNegativeBranch(true);
-			curParsTree = getTreeString();
         } else if (params->start_tree == STT_RANDOM_TREE) {
             generateRandomTree(YULE_HARDING);
             wrapperFixNegativeBranch(true);
-			curParsTree = getTreeString();
-        } else if (params->start_tree == STT_PARSIMONY) {
-            /********* Create parsimony tree using IQ-TREE *********/
-#ifdef _OPENMP
-            if (params->start_tree == STT_PARSIMONY)
-                curParsTree = pars_trees[treeNr-1];
-            else
-                curParsTree = generateParsimonyTree(parRandSeed);
-#else
-            curParsTree = generateParsimonyTree(parRandSeed);
-#endif
-        }
-        
-        int pos = addTreeToCandidateSet(curParsTree, -DBL_MAX, false, MPIHelper::getInstance().getProcessID());
-        // if a duplicated tree is generated, then randomize the tree
-        if (pos == -1) {
-            readTreeString(curParsTree);
-            string randTree = doRandomNNIs();
-            addTreeToCandidateSet(randTree, -DBL_MAX, false, MPIHelper::getInstance().getProcessID());
         }
+        pars_trees[treeNr-1] = getTreeString();
+        pars_topologies[treeNr-1] = getTopologyFingerprint();
+        pars_ready[treeNr-1] = 1;
     }
 
-    if (nParTrees > 0)
-        cout << getRealTime() - startTime << " second" << endl;
-
     /****************************************************************************************
-                          Compute logl of all initial trees
+          Generate the parsimony trees and optimize the branch lengths of the finished ones
     *****************************************************************************************/
 
-    vector<string> initTreeStrings = candidateTrees.getBestTreeStrings();
-    candidateTrees.clear();
+    // the searchers (or this tree) consume the trees while the remaining threads generate them
+    int num_consumers = max((int)searchers.size(), 1);
+    int num_producers = 0;
+    if (params->start_tree == STT_PARSIMONY && nParTrees >= 1) {
+        if (aln->ordered_pattern.empty())
+            aln->orderPatternByNumChars();
+        num_producers = max(min(ThreadPool::getInstance().getNumThreads() - num_consumers, nParTrees), 1);
+    }
+    StrVector newTreeStrings(nParTrees);
+    DoubleVector newTreeScores(nParTrees);
+    vector<uint64_t> newTreeTopologies(nParTrees);
+    mutex order_mutex;
+    int next_tree = 0;
+    // producers have the lower task IDs, thus they are all running before a consumer waits for them
+    ThreadPool::getInstance().run(num_producers + num_consumers, [&](int task) {
+        if (task < num_producers) {
+            PhyloTree tree;
+            if (params->constraint_tree_file) {
+                tree.constraintTree.initConstraint(params->constraint_tree_file, aln->getSeqNames());
+            }
+            tree.setParams(params);
+            tree.setParsimonyKernel(params->SSE);
+            for (int i = task; i < nParTrees; i += num_producers) {
+                // every tree has its own random stream, thus the trees do not depend on the number of threads
+                int *rstream;
+                init_random(Params::getInstance().ran_seed + processID * nParTrees + i + 1, false, &rstream);
+                tree.computeParsimonyTree(NULL, aln, rstream);
+                finish_random(rstream);
+                pars_trees[i] = tree.getTreeString();
+                pars_topologies[i] = tree.getTopologyFingerprint();
+                pars_ready[i] = 1;
+            }
+            return;
+        }
+        IQTree *tree = searchers.empty() ? this : searchers[task - num_producers];
+        while (true) {
+            int i;
+            string curParsTree;
+            uint64_t curParsTopology;
+            {
+                // duplicates are resolved in tree order, independent of the thread timing
+                lock_guard<mutex> lock(order_mutex);
+                if (next_tree >= nParTrees)
+                    break;
+                i = next_tree++;
+                while (!pars_ready[i])
+                    this_thread::yield();
+                curParsTree = pars_trees[i];
+                curParsTopology = pars_topologies[i];
+                int pos = addTreeToCandidateSet(curParsTree, -DBL_MAX, false, processID, curParsTopology);
+                // if a duplicated tree is generated, then randomize the tree
+                if (pos == -1) {
+                    tree->readTreeString(curParsTree);
+                    curParsTree = tree->doRandomNNIs();
+                    curParsTopology = tree->getTopologyFingerprint();
+                    pos = addTreeToCandidateSet(curParsTree, -DBL_MAX, false, processID, curParsTopology);
+                }
+                if (pos < 0)
+                    continue;
+            }
+            tree->readTreeString(curParsTree);
+            newTreeStrings[i] = tree->optimizeBranches(2);
+            newTreeScores[i] = tree->getCurScore();
+            newTreeTopologies[i] = curParsTopology;
+        }
+    });
 
-    if (init_size < initTreeStrings.size())
-        cout << "Computing log-likelihood of " << initTreeStrings.size() - init_size << " initial trees ... ";
-    startTime = getRealTime();
+    // trees pushed out of the full candidate set are dropped as before
+    for (int i = 0; i < nParTrees; i++)
+        if (!newTreeStrings[i].empty() && !candidateTrees.treeTopologyExist(newTreeTopologies[i]))
+            newTreeStrings[i] = "";
+    candidateTrees.clear();
 
-    for (vector<string>::iterator it = initTreeStrings.begin(); it != initTreeStrings.end(); ++it) {
-        string treeString;
-        double score;
-        readTreeString(*it);
-        if (it-initTreeStrings.begin() >= init_size)
-            treeString = optimizeBranches(2);
-        else {
-            computeLogL();
-            treeString = getTreeString();
-        }
-        score = getCurScore();
-        candidateTrees.update(treeString,score);
+    for (int i = 0; i < init_size; i++) {
+        readTreeString(initTreeStrings[i]);
+        computeLogL();
+        candidateTrees.update(getTreeString(), getCurScore(), getTopologyFingerprint());
     }
+    for (int i = 0; i < nParTrees; i++)
+        if (!newTreeStrings[i].empty())
+            candidateTrees.update(newTreeStrings[i], newTreeScores[i], newTreeTopologies[i]);
+
+    if (nParTrees > 0)
+        cout << getRealTime() - startTime << " seconds" << endl;
 
     if (Params::getInstance().writeDistImdTrees)
         intermediateTrees.initTrees(candidateTrees);
@@ -798,17 +891,36 @@ void IQTree::initCandidateTreeSet(int nParTrees, int nNNITrees) {
     candidateTrees.clear();
     candidateTrees.setMaxSize(Params::getInstance().numSupportTrees);
 
-    for (vector<string>::iterator it = bestInitTrees.begin(); it != bestInitTrees.end(); it++) {
-        readTreeString(*it);
-        doNNISearch();
-        string treeString = getTreeString();
-        addTreeToCandidateSet(treeString, curScore, true, MPIHelper::getInstance().getProcessID());
-        if (Params::getInstance().writeDistImdTrees)
-            intermediateTrees.update(treeString, curScore);
+    if (!searchers.empty()) {
+        // the searchers optimize one batch of trees at a time
+        for (int start = 0; start < bestInitTrees.size(); start += searchers.size()) {
+            if (start > 0 && stop_rule.meetDeadline()) {
+                cout << "NOTE: NNI search on " << bestInitTrees.size() - start << " initial trees skipped to meet the deadline" << endl;
+                break;
+            }
+            int num_trees = min(searchers.size(), bestInitTrees.size() - start);
+            StrVector trees(bestInitTrees.begin() + start, bestInitTrees.begin() + start + num_trees);
+            DoubleVector scores;
+            runSearchers(trees, scores, false);
+            addSearcherTrees(trees, scores);
+        }
+    } else {
+        for (vector<string>::iterator it = bestInitTrees.begin(); it != bestInitTrees.end(); it++) {
+            if (it != bestInitTrees.begin() && stop_rule.meetDeadline()) {
+                cout << "NOTE: NNI search on " << bestInitTrees.end() - it << " initial trees skipped to meet the deadline" << endl;
+                break;
+            }
+            readTreeString(*it);
+            doNNISearch();
+            string treeString = getTreeString();
+            addTreeToCandidateSet(treeString, curScore, true, MPIHelper::getInstance().getProcessID(), getTopologyFingerprint());
+            if (Params::getInstance().writeDistImdTrees)
+                intermediateTrees.update(treeString, curScore);
 //#ifdef _IQTREE_MPI
-//        MPIHelper::getInstance().distributeTree(getTreeString(), curScore, TREE_TAG);
-//        MPI_CollectTrees(false, maxNumTrees, true);
+//            MPIHelper::getInstance().distributeTree(getTreeString(), curScore, TREE_TAG);
+//            MPI_CollectTrees(false, maxNumTrees, true);
 //#endif
+        }
     }
 
     //---- BLOCKING COMMUNICATION
@@ -1207,7 +1319,7 @@ void IQTree::raiseBonus(Neighbor *nei, Node *dad, double bonus) {
 
 double IQTree::computePartialBonus(Node *node, Node* dad) {
     PhyloNeighbor *node_nei = (PhyloNeighbor*) node->findNeighbor(dad);
-    if (node_nei->partial_lh_computed)
+    if (node_nei->partial_lh_computed & 1)
         return node_nei->lh_scale_factor;
 
     FOR_NEIGHBOR_IT(node, dad, it){
@@ -1558,7 +1670,7 @@ string IQTree::perturbStableSplits(double suppValue) {
     return getTreeString();
 }
 
-string IQTree::doRandomNNIs(bool storeTabu) {
+string IQTree::doRandomNNIs(bool storeTabu, int *rstream) {
     int cntNNI = 0;
     int numRandomNNI;
     Branches nniBranches;
@@ -1569,7 +1681,7 @@ string IQTree::doRandomNNIs(bool storeTabu) {
         int numNonStableBranches = leafNum - 3 - stableBranches.size();
         numRandomNNI = numNonStableBranches;
     } else {
-        numRandomNNI = floor((leafNum - 3) * Params::getInstance().initPS);
+        numRandomNNI = floor((leafNum - 3) * searchinfo.curPerStrength);
     }
 
     initTabuSplits.clear();
@@ -1583,8 +1695,8 @@ string IQTree::doRandomNNIs(bool storeTabu) {
         for (Branches::iterator it = nniBranches.begin(); it != nniBranches.end(); ++it) {
             vectorNNIBranches.push_back(it->second);
         }
-        int randInt = random_int((int) vectorNNIBranches.size());
-        NNIMove randNNI = getRandomNNI(vectorNNIBranches[randInt]);
+        int randInt = random_int((int) vectorNNIBranches.size(), rstream);
+        NNIMove randNNI = getRandomNNI(vectorNNIBranches[randInt], rstream);
         if (constraintTree.isCompatible(randNNI)) {
             // only if random NNI satisfies constraintTree
             doNNI(randNNI);
@@ -2161,6 +2273,17 @@ double IQTree::doTreeSearch() {
     if (treesPerProc < 1 && params->numInitTrees > candidateTrees.size())
         treesPerProc = 1;
 
+    // the searchers also optimize the initial trees
+    bool use_searchers = useSearchers();
+    if (use_searchers) {
+        // past the seeds of the parsimony trees of all processes, see initCandidateTreeSet()
+        initSearchers(MPIHelper::getInstance().getNumProcesses() * treesPerProc +
+                      MPIHelper::getInstance().getProcessID() * params->num_searchers);
+        cout << "Running " << searchers.size() << " searchers with " << searchers[0]->num_threads
+             << " thread(s) each" << endl;
+    } else if (params->num_searchers > 1)
+        cout << "NOTE: -nsearch is not supported with the chosen search options, using one searcher" << endl;
+
     /* Initialize candidate tree set */
     if (!getCheckpoint()->getBool("finishedCandidateSet")) {
         initCandidateTreeSet(treesPerProc, params->numNNITrees);
@@ -2204,7 +2327,6 @@ double IQTree::doTreeSearch() {
     if (!getCheckpoint()->getBool("finishedCandidateSet"))
         cout << "CHECKPOINT: " << stop_rule.getCurIt() << " search iterations restored" << endl;
 
-    searchinfo.curPerStrength = params->initPS;
     double cur_correlation = 0.0;
 
 
@@ -2264,24 +2386,28 @@ double IQTree::doTreeSearch() {
 
         Alignment *saved_aln = aln;
 
-        string curTree;
-        /*----------------------------------------
-         * Perturb the tree
-         *---------------------------------------*/
-        doTreePerturbation();
-
-        /*----------------------------------------
-         * Optimize tree with NNI
-         *----------------------------------------*/
-        pair<int, int> nniInfos; // <num_NNIs, num_steps>
-        nniInfos = doNNISearch();
-        curTree = getTreeString();
-        int pos = addTreeToCandidateSet(curTree, curScore, true, MPIHelper::getInstance().getProcessID());
-        if (pos != -2 && pos != -1 && (Params::getInstance().fixStableSplits || Params::getInstance().adaptPertubation))
-            candidateTrees.computeSplitOccurences(Params::getInstance().stableSplitThreshold);
-
-        if (MPIHelper::getInstance().isWorker() || MPIHelper::getInstance().gotMessage())
-            syncCurrentTree();
+        if (use_searchers) {
+            doSearcherRound(cur_correlation);
+        } else {
+            string curTree;
+            /*----------------------------------------
+             * Perturb the tree
+             *---------------------------------------*/
+            doTreePerturbation();
+
+            /*----------------------------------------
+             * Optimize tree with NNI
+             *----------------------------------------*/
+            pair<int, int> nniInfos; // <num_NNIs, num_steps>
+            nniInfos = doNNISearch();
+            curTree = getTreeString();
+            int pos = addTreeToCandidateSet(curTree, curScore, true, MPIHelper::getInstance().getProcessID(), getTopologyFingerprint());
+            if (pos != -2 && pos != -1 && (Params::getInstance().fixStableSplits || Params::getInstance().adaptPertubation))
+                candidateTrees.computeSplitOccurences(Params::getInstance().stableSplitThreshold);
+
+            if (MPIHelper::getInstance().isWorker() || MPIHelper::getInstance().gotMessage())
+                syncCurrentTree();
+        }
 
 /*
 #ifdef _IQTREE_MPI
@@ -2358,6 +2484,8 @@ double IQTree::doTreeSearch() {
             sg->removeTrivialSplits();
             sg->setCheckpoint(checkpoint);
             boot_splits.push_back(sg);
+            if (params->deadline > 0)
+                printInterimConsensusTree(*sg);
             cout << "Log-likelihood cutoff on original alignment: " << logl_cutoff << endl;
 //            MPIHelper::getInstance().sendMsg(LOGL_CUTOFF_TAG, convertDoubleToString(logl_cutoff));
 
@@ -2378,6 +2506,9 @@ double IQTree::doTreeSearch() {
 
         // print UFBoot trees every 10 iterations
 
+        if (params->adaptive_search)
+            adaptSearchParameters();
+
         saveCheckpoint();
         checkpoint->dump();
 
@@ -2394,6 +2525,9 @@ double IQTree::doTreeSearch() {
     if (optimization_looped)
         sendStopMessage();
 
+    if (use_searchers)
+        deleteSearchers();
+
     readTreeString(candidateTrees.getBestTreeStrings()[0]);
 
     if (testNNI)
@@ -2532,7 +2666,7 @@ double IQTree::doTreePerturbation() {
             if (Params::getInstance().five_plus_five) {
                 readTreeString(candidateTrees.getNextCandTree());
             } else {
-                readTreeString(candidateTrees.getRandTopTree(Params::getInstance().popSize));
+                readTreeString(candidateTrees.getRandTopTree(perturb_pool_size));
             }
             if (Params::getInstance().iqp) {
                 doIQP();
@@ -2562,6 +2696,108 @@ double IQTree::doTreePerturbation() {
     return curScore;
 }
 
+bool IQTree::useSearchers() {
+    // searchers only perturb by random NNIs and do not record intermediate trees
+    return params->num_searchers > 1 && params->snni && !params->iqp && !params->pll
+        && !params->fixStableSplits && !params->adaptPertubation && !params->count_trees
+        && !params->write_intermediate_trees && !params->writeDistImdTrees && !params->print_trees_site_posterior
+        && iqp_assess_quartet != IQP_BOOTSTRAP && save_all_trees == 0 && !isSuperTree()
+        && MPIHelper::getInstance().getNumProcesses() == 1;
+}
+
+void IQTree::doSearcherRound(double cur_correlation) {
+    int num_searchers = searchers.size();
+
+    // draw the start trees here so that the round does not depend on thread timing
+    StrVector start_trees(num_searchers);
+    for (int id = 0; id < num_searchers; id++) {
+        if (Params::getInstance().five_plus_five)
+            start_trees[id] = candidateTrees.getNextCandTree();
+        else
+            start_trees[id] = candidateTrees.getRandTopTree(perturb_pool_size);
+        searchers[id]->searchinfo.curPerStrength = searchinfo.curPerStrength;
+    }
+
+    DoubleVector scores;
+    runSearchers(start_trees, scores, true);
+    addSearcherTrees(start_trees, scores, &cur_correlation);
+}
+
+void IQTree::runSearchers(StrVector &trees, DoubleVector &scores, bool perturb) {
+    scores.resize(trees.size());
+    ThreadPool::getInstance().run(trees.size(), [&](int id) {
+        IQTree *searcher = searchers[id];
+        searcher->readTreeString(trees[id]);
+        searcher->clearAllPartialLH();
+        if (perturb)
+            searcher->doRandomNNIs(Params::getInstance().tabu, searcher_rstreams[id]);
+        searcher->computeLogL();
+        searcher->optimizeNNISPR(Params::getInstance().speednni);
+        trees[id] = searcher->getTreeString();
+        scores[id] = searcher->getCurScore();
+    });
+}
+
+void IQTree::addSearcherTrees(StrVector &trees, DoubleVector &scores, double *cur_correlation) {
+    for (int id = 0; id < trees.size(); id++) {
+        if (cur_correlation && stop_rule.meetStopCondition(stop_rule.getCurIt(), *cur_correlation))
+            break;
+        uint64_t topology = searchers[id]->getTopologyFingerprint();
+        if (scores[id] > candidateTrees.getBestScore() + params->modelEps) {
+            // better tree found: re-optimize model parameters as in doNNISearch(),
+            // the searchers are idle and see the new parameters in the next round
+            readTreeString(trees[id]);
+            optimizeModelParameters(false, params->modelEps * 10);
+            getModelFactory()->saveCheckpoint();
+            trees[id] = getTreeString();
+            scores[id] = getCurScore();
+        }
+        addTreeToCandidateSet(trees[id], scores[id], true, MPIHelper::getInstance().getProcessID(), topology);
+        MPIHelper::getInstance().setNumNNISearch(MPIHelper::getInstance().getNumNNISearch() + 1);
+    }
+}
+
+void IQTree::initSearchers(int seed_offset) {
+    int num_searchers = params->num_searchers;
+    // the pattern-level split of each searcher gets the remaining threads
+    int searcher_threads = max(num_threads / num_searchers, 1);
+    string tree_string = getTreeString();
+    for (int id = 0; id < num_searchers; id++) {
+        IQTree *searcher = new IQTree(aln);
+        searcher->setParams(params);
+        if (params->constraint_tree_file)
+            searcher->constraintTree.initConstraint(params->constraint_tree_file, aln->getSeqNames());
+        searcher->setModelFactory(model_factory);
+        searcher->setModel(model);
+        searcher->setRate(site_rate);
+        searcher->optimize_by_newton = optimize_by_newton;
+        searcher->setLikelihoodKernel(sse, searcher_threads);
+        searcher->readTreeString(tree_string);
+        searcher->initializeAllPartialLh();
+        searchers.push_back(searcher);
+
+        int *rstream;
+        init_random(params->ran_seed + seed_offset + id + 1, false, &rstream);
+        searcher_rstreams.push_back(rstream);
+    }
+}
+
+void IQTree::deleteSearchers() {
+    for (vector<IQTree*>::reverse_iterator it = searchers.rbegin(); it != searchers.rend(); it++) {
+        skippedNNIub += (*it)->skippedNNIub;
+        totalNNIub += (*it)->totalNNIub;
+        // model is owned by this tree
+        (*it)->setModelFactory(NULL);
+        (*it)->setModel(NULL);
+        (*it)->setRate(NULL);
+        delete (*it);
+    }
+    searchers.clear();
+    for (vector<int*>::iterator it = searcher_rstreams.begin(); it != searcher_rstreams.end(); it++)
+        finish_random(*it);
+    searcher_rstreams.clear();
+}
+
 /****************************************************************************
  Fast Nearest Neighbor Interchange by maximum likelihood
  ****************************************************************************/
@@ -2583,7 +2819,7 @@ pair<int, int> IQTree::doNNISearch() {
                 PLL_TRUE, 0, 0, 0, PLL_SUMMARIZE_LH, 0, 0);
         readTreeString(string(pllInst->tree_string));
     } else {
-        nniInfos = optimizeNNI(Params::getInstance().speednni);
+        nniInfos = optimizeNNISPR(Params::getInstance().speednni);
         if (isSuperTree()) {
             ((PhyloSuperTree*) this)->computeBranchLengths();
         }
@@ -2612,6 +2848,10 @@ pair<int, int> IQTree::optimizeNNI(bool speedNNI) {
     Branches nonNNIBranches;
     vector<NNIMove> positiveNNIs;
     vector<NNIMove> appliedNNIs;
+    // -nniinc: best positive NNI of each branch that was not applied, newloglh is the gain
+    map<int, NNIMove> cachedNNIs;
+    // branches of positiveNNIs whose score was taken from cachedNNIs
+    set<int> cachedNNIBranches;
     SplitIntMap tabuSplits;
     if (!initTabuSplits.empty()) {
         tabuSplits = initTabuSplits;
@@ -2652,9 +2892,14 @@ pair<int, int> IQTree::optimizeNNI(bool speedNNI) {
         }
 
         if (startSpeedNNI) {
-            // speedNNI option: only evaluate NNIs that are 2 branches away from the previously applied NNI
+            // speedNNI option: only evaluate NNIs that are nni_radius branches away from the previously applied NNI
             Branches filteredNNIBranches;
             filterNNIBranches(appliedNNIs, filteredNNIBranches);
+            if (params->nni_incremental) {
+                // cached scores around the applied NNIs are outdated
+                for (Branches::iterator it = filteredNNIBranches.begin(); it != filteredNNIBranches.end(); it++)
+                    cachedNNIs.erase(it->first);
+            }
             for (Branches::iterator it = filteredNNIBranches.begin(); it != filteredNNIBranches.end(); it++) {
                 Branch curBranch = it->second;
                 PhyloNeighbor* nei = (PhyloNeighbor*) curBranch.first->findNeighbor(curBranch.second);
@@ -2679,6 +2924,7 @@ pair<int, int> IQTree::optimizeNNI(bool speedNNI) {
             }
         } else {
             getNNIBranches(tabuSplits, candidateTrees.getCandSplits(), nonNNIBranches, nniBranches);
+            cachedNNIs.clear();
         }
 
         if (!tabuSplits.empty()) {
@@ -2688,6 +2934,15 @@ pair<int, int> IQTree::optimizeNNI(bool speedNNI) {
         positiveNNIs.clear();
         evaluateNNIs(nniBranches, positiveNNIs);
 
+        // the remaining branches keep their cached scores
+        cachedNNIBranches.clear();
+        for (map<int, NNIMove>::iterator it = cachedNNIs.begin(); it != cachedNNIs.end(); it++)
+            if (it->second.node1->isNeighbor(it->second.node2)) {
+                positiveNNIs.push_back(it->second);
+                positiveNNIs.back().newloglh += curScore;
+                cachedNNIBranches.insert(it->first);
+            }
+
         if (positiveNNIs.size() == 0) {
             if (!nonNNIBranches.empty() && totalNNIApplied == 0) {
                 evaluateNNIs(nonNNIBranches, positiveNNIs);
@@ -2706,6 +2961,15 @@ pair<int, int> IQTree::optimizeNNI(bool speedNNI) {
         appliedNNIs.clear();
         getCompatibleNNIs(positiveNNIs, appliedNNIs);
 
+        // cached scores are estimates, NNIs are only applied with scores of the current tree
+        while (reevaluateCachedNNIs(appliedNNIs, positiveNNIs, cachedNNIBranches)) {
+            sort(positiveNNIs.begin(), positiveNNIs.end());
+            appliedNNIs.clear();
+            getCompatibleNNIs(positiveNNIs, appliedNNIs);
+        }
+        if (appliedNNIs.empty())
+            break;
+
         // do non-conflicting positive NNIs
         doNNIs(appliedNNIs);
         curScore = optimizeAllBranches(1, params->loglh_epsilon, PLL_NEWZPERCYCLE);
@@ -2728,6 +2992,17 @@ pair<int, int> IQTree::optimizeNNI(bool speedNNI) {
             totalNNIApplied += appliedNNIs.size();
         }
 
+        if (params->nni_incremental) {
+            cachedNNIs.clear();
+            for (vector<NNIMove>::iterator it = positiveNNIs.begin(); it != positiveNNIs.end(); it++) {
+                NNIMove &nni = cachedNNIs[pairInteger(it->node1->id, it->node2->id)];
+                nni = *it;
+                nni.newloglh -= oldScore;
+            }
+            for (vector<NNIMove>::iterator it = appliedNNIs.begin(); it != appliedNNIs.end(); it++)
+                cachedNNIs.erase(pairInteger(it->node1->id, it->node2->id));
+        }
+
 
         if (curScore - oldScore <  params->loglh_epsilon)
             break;
@@ -2755,6 +3030,26 @@ pair<int, int> IQTree::optimizeNNI(bool speedNNI) {
     return make_pair(numSteps, totalNNIApplied);
 }
 
+bool IQTree::reevaluateCachedNNIs(vector<NNIMove> &appliedNNIs, vector<NNIMove> &positiveNNIs, set<int> &cachedBranches) {
+    bool reevaluated = false;
+    for (vector<NNIMove>::iterator it = appliedNNIs.begin(); it != appliedNNIs.end(); it++) {
+        int branchID = pairInteger(it->node1->id, it->node2->id);
+        if (cachedBranches.erase(branchID) == 0)
+            continue;
+        reevaluated = true;
+        NNIMove nni = getBestNNIForBran(it->node1, it->node2, NULL);
+        for (vector<NNIMove>::iterator pit = positiveNNIs.begin(); pit != positiveNNIs.end(); pit++)
+            if (pairInteger(pit->node1->id, pit->node2->id) == branchID) {
+                if (nni.newloglh > curScore)
+                    *pit = nni;
+                else
+                    positiveNNIs.erase(pit);
+                break;
+            }
+    }
+    return reevaluated;
+}
+
 void IQTree::filterNNIBranches(vector<NNIMove> &appliedNNIs, Branches &nniBranches) {
     for (vector<NNIMove>::iterator it = appliedNNIs.begin(); it != appliedNNIs.end(); it++) {
         Branch curBranch;
@@ -2763,9 +3058,130 @@ void IQTree::filterNNIBranches(vector<NNIMove> &appliedNNIs, Branches &nniBranch
         int branchID = pairInteger(it->node1->id, it->node2->id);
         if (nniBranches.find(branchID) == nniBranches.end())
             nniBranches.insert(pair<int,Branch>(branchID, curBranch));
-        getSurroundingInnerBranches(it->node1, it->node2, 2, nniBranches);
-        getSurroundingInnerBranches(it->node2, it->node1, 2, nniBranches);
+        getSurroundingInnerBranches(it->node1, it->node2, params->nni_radius, nniBranches);
+        getSurroundingInnerBranches(it->node2, it->node1, params->nni_radius, nniBranches);
+    }
+}
+
+pair<int, int> IQTree::optimizeNNISPR(bool speedNNI) {
+    pair<int, int> nniInfos = optimizeNNI(speedNNI);
+    // an SPR move may open up new NNIs
+    while (params->lh_spr && !isSuperTree() && optimizeLazySPR() > 0) {
+        pair<int, int> moreInfos = optimizeNNI(speedNNI);
+        nniInfos.first += moreInfos.first;
+        nniInfos.second += moreInfos.second;
     }
+    return nniInfos;
+}
+
+/****************************************************************************
+ Subtree Pruning and Regrafting by maximum likelihood
+ ****************************************************************************/
+
+int IQTree::optimizeLazySPR() {
+    NodeVector nodes1, nodes2;
+    getBranches(nodes1, nodes2);
+    curScore = computeLikelihood();
+    double oldScore = curScore;
+    int num_moves = 0;
+    for (int i = 0; i < nodes1.size(); i++)
+        for (int j = 0; j < 2; j++) {
+            // prune the subtree on either side of the branch
+            PhyloNode *node = (PhyloNode*) (j == 0 ? nodes1[i] : nodes2[i]);
+            PhyloNode *dad = (PhyloNode*) (j == 0 ? nodes2[i] : nodes1[i]);
+            // the branch may be gone after a previous move
+            if (dad->degree() != 3 || !node->isNeighbor(dad))
+                continue;
+            if (regraftLazySPR(node, dad))
+                num_moves++;
+        }
+
+    if (num_moves > 0) {
+        if (Params::getInstance().fixStableSplits || Params::getInstance().adaptPertubation)
+            buildNodeSplit();
+        curScore = optimizeAllBranches(1, params->loglh_epsilon, PLL_NEWZPERCYCLE);
+    }
+    if (verbose_mode >= VB_MED)
+        cout << "SPR round: " << num_moves << " moves applied, LogL: " << oldScore << " -> " << curScore << endl;
+    return num_moves;
+}
+
+bool IQTree::regraftLazySPR(PhyloNode *node, PhyloNode *dad) {
+    PhyloNode *left = NULL, *right = NULL;
+    FOR_NEIGHBOR_IT(dad, node, it)
+        if (!left)
+            left = (PhyloNode*) (*it)->node;
+        else
+            right = (PhyloNode*) (*it)->node;
+    double left_len = dad->findNeighbor(left)->length;
+    double right_len = dad->findNeighbor(right)->length;
+    double node_len = dad->findNeighbor(node)->length;
+    // computeLikelihood() below overwrites curScore
+    double orig_score = curScore;
+
+    vector<Branch> regrafts;
+    getSPRRegraftBranches(regrafts, params->lh_spr_radius, left, dad);
+    getSPRRegraftBranches(regrafts, params->lh_spr_radius, right, dad);
+    if (regrafts.empty())
+        return false;
+
+    // score every position with the current branch lengths, consecutive positions are
+    // neighbors, thus only a few partial likelihoods are recomputed per position
+    DoubleVector regraft_len(regrafts.size());
+    vector<pair<double, int> > scores;
+    for (int i = 0; i < regrafts.size(); i++) {
+        PhyloNode *node1 = (PhyloNode*) regrafts[i].first;
+        PhyloNode *node2 = (PhyloNode*) regrafts[i].second;
+        regraft_len[i] = node1->findNeighbor(node2)->length;
+        moveSubtree(node, dad, node1, node2);
+        double score = computeLikelihoodBranch((PhyloNeighbor*) dad->findNeighbor(node), dad);
+        scores.push_back(make_pair(-score, i));
+    }
+    sort(scores.begin(), scores.end());
+
+    // optimize the branch lengths around the best positions only
+    int num_evaluated = 0;
+    int cur_pos = regrafts.size() - 1;
+    for (vector<pair<double, int> >::iterator it = scores.begin();
+            it != scores.end() && num_evaluated < params->lh_spr_top; it++) {
+        int i = it->second;
+        PhyloNode *node1 = (PhyloNode*) regrafts[i].first;
+        PhyloNode *node2 = (PhyloNode*) regrafts[i].second;
+        if (i != cur_pos) {
+            moveSubtree(node, dad, node1, node2);
+            cur_pos = i;
+        }
+        if (!constraintTree.isCompatible(this))
+            continue;
+        num_evaluated++;
+        // the merged branch is shared by all positions
+        double merged_len = left->findNeighbor(right)->length;
+        optimizeOneBranch(dad, node);
+        optimizeOneBranch(dad, node1);
+        optimizeOneBranch(dad, node2);
+        optimizeOneBranch(left, right);
+        double score = computeLikelihood();
+        if (save_all_trees == 2)
+            saveCurrentTree(score); // BQM: for new bootstrap
+        if (verbose_mode >= VB_DEBUG)
+            cout << "SPR " << node->id << "-" << dad->id << " to " << node1->id << "-" << node2->id
+                 << ": " << -it->first << " / " << score << endl;
+        if (score > orig_score + params->loglh_epsilon)
+            return true;
+        // moveSubtree() clears the partial likelihoods affected by the lengths around dad
+        dad->findNeighbor(node)->length = node->findNeighbor(dad)->length = node_len;
+        dad->findNeighbor(node1)->length = node1->findNeighbor(dad)->length = regraft_len[i] / 2;
+        dad->findNeighbor(node2)->length = node2->findNeighbor(dad)->length = regraft_len[i] - regraft_len[i] / 2;
+        left->findNeighbor(right)->length = right->findNeighbor(left)->length = merged_len;
+        left->clearReversePartialLh(right);
+        right->clearReversePartialLh(left);
+    }
+
+    // no improvement, restore the original tree
+    dad->findNeighbor(node)->length = node->findNeighbor(dad)->length = node_len;
+    moveSubtree(node, dad, left, right, left_len, right_len);
+    curScore = orig_score;
+    return false;
 }
 
 double IQTree::pllOptimizeNNI(int &totalNNICount, int &nniSteps, SearchInfo &searchinfo) {
@@ -3011,6 +3427,11 @@ void IQTree::setDelete(int _delete) {
 }
 
 void IQTree::evaluateNNIs(Branches &nniBranches, vector<NNIMove>  &positiveNNIs) {
+    if (params->nni_workers > 1 && nniBranches.size() > 1 && num_threads > 1
+        && !isSuperTree() && params->lh_mem_save != LM_MEM_SAVE && save_all_trees != 2) {
+        evaluateNNIsParallel(nniBranches, positiveNNIs);
+        return;
+    }
     for (Branches::iterator it = nniBranches.begin(); it != nniBranches.end(); it++) {
         NNIMove nni = getBestNNIForBran((PhyloNode*) it->second.first, (PhyloNode*) it->second.second, NULL);
         if (nni.newloglh > curScore) {
@@ -3025,6 +3446,155 @@ void IQTree::evaluateNNIs(Branches &nniBranches, vector<NNIMove>  &positiveNNIs)
     }
 }
 
+void IQTree::evaluateNNIsParallel(Branches &nniBranches, vector<NNIMove> &positiveNNIs) {
+    initNNIWorkers();
+
+    NodeVector nodes;
+    getTaxa(nodes);
+    getInternalNodes(nodes);
+    vector<PhyloNode*> node_map(nodeNum, NULL);
+    for (NodeVector::iterator it = nodes.begin(); it != nodes.end(); it++)
+        node_map[(*it)->id] = (PhyloNode*)(*it);
+
+    vector<Branch> branches;
+    for (Branches::iterator it = nniBranches.begin(); it != nniBranches.end(); it++)
+        branches.push_back(it->second);
+    vector<NNIMove> nnis(branches.size());
+
+    // each task owns one worker; branches are dealt out with a fixed stride so that
+    // every worker sees the same sequence of branches and results are reproducible
+    int num_workers = nni_workers.size();
+    ThreadPool::getInstance().run(num_workers, [&](int worker_id) {
+        PhyloTree *worker = nni_workers[worker_id];
+        vector<PhyloNode*> &worker_nodes = nni_worker_nodes[worker_id];
+        for (int i = worker_id; i < branches.size(); i += num_workers) {
+            NNIMove nni = worker->getBestNNIForBran(worker_nodes[branches[i].first->id],
+                worker_nodes[branches[i].second->id], NULL);
+            // translate the move back to the nodes of this tree
+            PhyloNode *node1 = node_map[nni.node1->id];
+            PhyloNode *node2 = node_map[nni.node2->id];
+            nnis[i] = nni;
+            nnis[i].node1 = node1;
+            nnis[i].node2 = node2;
+            nnis[i].node1Nei_it = node1->findNeighborIt(node_map[(*nni.node1Nei_it)->node->id]);
+            nnis[i].node2Nei_it = node2->findNeighborIt(node_map[(*nni.node2Nei_it)->node->id]);
+        }
+    });
+
+    // collect upper-bound statistics of the workers
+    for (vector<PhyloTree*>::iterator it = nni_workers.begin(); it != nni_workers.end(); it++) {
+        skippedNNIub += (*it)->skippedNNIub;
+        totalNNIub += (*it)->totalNNIub;
+        (*it)->skippedNNIub = (*it)->totalNNIub = 0;
+    }
+
+    for (vector<NNIMove>::iterator it = nnis.begin(); it != nnis.end(); it++)
+        if (it->newloglh > curScore)
+            positiveNNIs.push_back(*it);
+
+    // synchronize tree during optimization step
+    if (MPIHelper::getInstance().isMaster() && candidateset_changed.size() > 0
+        && MPIHelper::getInstance().gotMessage()) {
+        syncCurrentTree();
+    }
+}
+
+void IQTree::initNNIWorkers() {
+    int num_workers = min(params->nni_workers, num_threads);
+    // the pattern-level split of each worker gets the remaining threads
+    int worker_threads = max(num_threads / num_workers, 1);
+    if (!nni_workers.empty() && (nni_workers.size() != num_workers || nni_workers[0]->num_threads != worker_threads
+        || nni_worker_lh_size != getPartialLhSize() || nni_worker_scale_size != getScaleNumSize()))
+        deleteNNIWorkers();
+    nni_worker_lh_size = getPartialLhSize();
+    nni_worker_scale_size = getScaleNumSize();
+
+    nni_worker_nodes.resize(num_workers);
+    for (int id = 0; id < num_workers; id++) {
+        if (id == nni_workers.size()) {
+            PhyloTree *worker = new PhyloTree(aln);
+            worker->setParams(params);
+            if (params->constraint_tree_file)
+                worker->constraintTree.initConstraint(params->constraint_tree_file, aln->getSeqNames());
+            nni_workers.push_back(worker);
+        }
+        PhyloTree *worker = nni_workers[id];
+        // model may have been replaced since the last call
+        worker->setModelFactory(model_factory);
+        worker->setModel(model);
+        worker->setRate(site_rate);
+        worker->optimize_by_newton = optimize_by_newton;
+        worker->setLikelihoodKernel(sse, worker_threads);
+
+        // topology and parameters may have changed since the last round
+        if (copyTopologyToNNIWorker(id))
+            worker->initializeAllPartialLh();
+        worker->clearAllPartialLH();
+        worker->setCurScore(curScore);
+    }
+}
+
+bool IQTree::copyTopologyToNNIWorker(int id) {
+    PhyloTree *worker = nni_workers[id];
+    vector<PhyloNode*> &worker_nodes = nni_worker_nodes[id];
+    NodeVector nodes;
+    getTaxa(nodes);
+    getInternalNodes(nodes);
+    bool same_nodes = (worker->root && worker_nodes.size() == nodeNum);
+    for (NodeVector::iterator it = nodes.begin(); same_nodes && it != nodes.end(); it++)
+        same_nodes = worker_nodes[(*it)->id] && worker_nodes[(*it)->id]->degree() == (*it)->degree();
+
+    if (!same_nodes) {
+        // copy nodes with the same IDs and neighbor order, so that NNI moves
+        // and their branch lengths translate back one to one
+        if (worker->root)
+            worker->freeNode();
+        worker_nodes.assign(nodeNum, NULL);
+        for (NodeVector::iterator it = nodes.begin(); it != nodes.end(); it++)
+            worker_nodes[(*it)->id] = (PhyloNode*)worker->newNode((*it)->id, (*it)->name.c_str());
+        for (NodeVector::iterator it = nodes.begin(); it != nodes.end(); it++)
+            FOR_NEIGHBOR_IT(*it, NULL, nit)
+                worker_nodes[(*it)->id]->addNeighbor(worker_nodes[(*nit)->node->id], (*nit)->length, (*nit)->id);
+        worker->root = worker_nodes[root->id];
+        worker->leafNum = leafNum;
+        worker->nodeNum = nodeNum;
+        worker->branchNum = branchNum;
+        worker->rooted = rooted;
+        return true;
+    }
+
+    // reconnect the existing neighbors in place
+    bool changed = (worker->root != worker_nodes[root->id]);
+    worker->root = worker_nodes[root->id];
+    for (NodeVector::iterator it = nodes.begin(); it != nodes.end(); it++) {
+        NeighborVec &neighbors = worker_nodes[(*it)->id]->neighbors;
+        for (int i = 0; i < neighbors.size(); i++) {
+            Neighbor *nei = (*it)->neighbors[i];
+            PhyloNeighbor *worker_nei = (PhyloNeighbor*)neighbors[i];
+            if (worker_nei->node != worker_nodes[nei->node->id]) {
+                worker_nei->node = worker_nodes[nei->node->id];
+                worker_nei->size = 0;
+                changed = true;
+            }
+            worker_nei->length = nei->length;
+            worker_nei->id = nei->id;
+        }
+    }
+    return changed;
+}
+
+void IQTree::deleteNNIWorkers() {
+    for (vector<PhyloTree*>::reverse_iterator it = nni_workers.rbegin(); it != nni_workers.rend(); it++) {
+        // model is owned by this tree
+        (*it)->setModelFactory(NULL);
+        (*it)->setModel(NULL);
+        (*it)->setRate(NULL);
+        delete (*it);
+    }
+    nni_workers.clear();
+    nni_worker_nodes.clear();
+}
+
 //Branches IQTree::getReducedListOfNNIBranches(Branches &previousNNIBranches) {
 //    Branches resBranches;
 //    for (Branches::iterator it = previousNNIBranches.begin(); it != previousNNIBranches.end(); it++) {
@@ -3172,20 +3742,15 @@ void IQTree::saveCurrentTree(double cur_logl) {
 //        int ptn;
 //        int updated = 0;
 //        int nsamples = boot_samples.size();
-        ostringstream ostr;
-        string tree_str, tree_str_brlen;
+        string tree_str_brlen;
         setRootNode(params->root);
-        printTree(ostr, WT_TAXON_ID + WT_SORT_TAXA);
-        tree_str = ostr.str();
-        if (params->print_ufboot_trees == 2) {
-            ostringstream ostr_brlen;
-			printTree(ostr_brlen, WT_BR_LEN);
-			tree_str_brlen = ostr_brlen.str();
-        }
         double rand_double = random_double();
+        // samples replaced by this tree; the tree is converted into a string only if there are any
+        CharVector updated(sample_end, 0);
+        bool any_updated = false;
 
         #ifdef _OPENMP
-        #pragma omp parallel for
+        #pragma omp parallel for reduction(||: any_updated)
         #endif
         for (int sample = sample_start; sample < sample_end; sample++) {
             double rell = 0.0;
@@ -3211,11 +3776,31 @@ void IQTree::saveCurrentTree(double cur_logl) {
                 }
                 boot_logl[sample] = max(boot_logl[sample], rell);
                 boot_orig_logl[sample] = cur_logl;
-                boot_trees[sample] = tree_str;
-                if (params->print_ufboot_trees == 2) {
-                	boot_trees_brlen[sample] = tree_str_brlen;
-                }
+                updated[sample] = 1;
+                any_updated = true;
+            }
+        }
+
+        if (any_updated) {
+            // NNI rounds save the same topology many times, print it only once
+            uint64_t fingerprint = getTopologyFingerprint();
+            if (fingerprint != boot_tree_fingerprint || boot_tree_string.empty()) {
+                ostringstream ostr;
+                printTree(ostr, WT_TAXON_ID + WT_SORT_TAXA);
+                boot_tree_string = ostr.str();
+                boot_tree_fingerprint = fingerprint;
+            }
+            if (params->print_ufboot_trees == 2) {
+                ostringstream ostr_brlen;
+                printTree(ostr_brlen, WT_BR_LEN);
+                tree_str_brlen = ostr_brlen.str();
             }
+            for (int sample = sample_start; sample < sample_end; sample++)
+                if (updated[sample]) {
+                    boot_trees[sample] = boot_tree_string;
+                    if (params->print_ufboot_trees == 2)
+                        boot_trees_brlen[sample] = tree_str_brlen;
+                }
         }
     }
     if (Params::getInstance().print_tree_lh) {
@@ -3561,6 +4146,45 @@ void IQTree::printBestCandidateTree() {
         cout << "Best tree printed to " << tree_file_name << endl;
 }
 
+void IQTree::printBestTreeString(string tree_string) {
+    if (MPIHelper::getInstance().isWorker() || (params->suppress_output_flags & OUT_TREEFILE))
+        return;
+    string tree_file_name = params->out_prefix;
+    tree_file_name += ".treefile";
+    PhyloTree tree(aln);
+    stringstream str(tree_string);
+    tree.readTree(str, tree.rooted);
+    tree.assignLeafNames();
+    tree.setRootNode(params->root);
+    tree.printTree(tree_file_name.c_str(), WT_BR_LEN | WT_BR_LEN_FIXED_WIDTH | WT_SORT_TAXA | WT_NEWLINE);
+    if (verbose_mode >= VB_MED)
+        cout << "Best tree printed to " << tree_file_name << endl;
+}
+
+void IQTree::printInterimConsensusTree(SplitGraph &sg) {
+    // as in computeConsensusTree(): greedy consensus of the splits above -minsup
+    SplitGraph maxsg;
+    sg.findMaxCompatibleSplits(maxsg);
+    double min_count = params->split_threshold * boot_trees.size();
+    for (SplitGraph::iterator it = maxsg.begin(); it != maxsg.end(); )
+        if ((*it)->getWeight() <= min_count && (*it)->trivial() < 0) {
+            delete *it;
+            it = maxsg.erase(it);
+        } else
+            it++;
+    maxsg.scaleWeight(100.0 / boot_trees.size(), true);
+    MTree mytree;
+    mytree.convertToTree(maxsg);
+    string taxname = (params->root) ? params->root : maxsg.getTaxa()->GetTaxonLabel(0);
+    Node *node = mytree.findLeafName(taxname);
+    if (node)
+        mytree.root = node;
+    string out_file = params->out_prefix;
+    out_file += ".contree";
+    mytree.printTree(out_file.c_str(), WT_BR_CLADE);
+    if (verbose_mode >= VB_MED)
+        cout << "Interim consensus tree printed to " << out_file << endl;
+}
 
 void IQTree::printPhylolibTree(const char* suffix) {
     pllTreeToNewick(pllInst->tree_string, pllInst, pllPartitions, pllInst->start->back, PLL_TRUE, 1, 0, 0, 0,
@@ -3827,6 +4451,7 @@ int IQTree::testNumThreads() {
     for (int proc = 1; proc <= max_procs; proc++) {
 
         omp_set_num_threads(proc);
+        ThreadPool::getInstance().init(proc);
         setLikelihoodKernel(sse, proc);
         initializeAllPartialLh();
 
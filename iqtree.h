@@ -151,6 +151,20 @@ public:
 
     void printBestCandidateTree();
 
+    /**
+            print \a tree_string to .treefile without changing the current tree,
+            used with -deadline to keep the best tree found so far on disk
+            @param tree_string tree with taxon IDs
+     */
+    void printBestTreeString(string tree_string);
+
+    /**
+            print the consensus of the bootstrap trees found so far to .contree,
+            used with -deadline until the final consensus tree replaces it
+            @param sg splits of the bootstrap trees weighted by their counts
+     */
+    void printInterimConsensusTree(SplitGraph &sg);
+
     /**
      * print phylolib tree to a file.
      * @param suffix suffix string for the tree file
@@ -246,9 +260,10 @@ public:
 
     /**
      * 		Perform a series of random NNI moves
+     * 		@param rstream random number stream, NULL for the global stream
      * 		@return the perturbed newick string
      */
-    string doRandomNNIs(bool storeTabu = false);
+    string doRandomNNIs(bool storeTabu = false, int *rstream = NULL);
 
     /**
      *  Do a random NNI on splits that are shared among all the candidate trees.
@@ -317,6 +332,36 @@ public:
      */
     double doTreeSearch();
 
+    /**
+     *  @return TRUE if the search iterations are done by several searcher threads (-nsearch option)
+     */
+    bool useSearchers();
+
+    /**
+     *  Do one search iteration per searcher: each searcher perturbs a tree drawn from the
+     *  candidate set and optimizes it by NNI, all in parallel. The resulting trees are then
+     *  added to the candidate set in searcher order, so that runs are reproducible.
+     *  @param cur_correlation current bootstrap correlation coefficient for the stop rule
+     */
+    void doSearcherRound(double cur_correlation);
+
+    /**
+     *  optimize one tree per searcher by NNI in parallel
+     *  @param trees (IN/OUT) start trees, at most one per searcher, replaced by the optimized trees
+     *  @param scores (OUT) log-likelihoods of the optimized trees
+     *  @param perturb TRUE to perturb the start trees by random NNIs first
+     */
+    void runSearchers(StrVector &trees, DoubleVector &scores, bool perturb);
+
+    /**
+     *  add the trees of the searchers to the candidate set in searcher order,
+     *  re-optimizing the model parameters whenever a better tree is found
+     *  @param trees trees of the searchers
+     *  @param scores log-likelihoods of the trees
+     *  @param cur_correlation current bootstrap correlation coefficient for the stop rule, NULL to add all trees
+     */
+    void addSearcherTrees(StrVector &trees, DoubleVector &scores, double *cur_correlation = NULL);
+
     /**
      *  Wrapper function that uses either PLL or IQ-TREE to optimize the branch length
      *  @param maxTraversal
@@ -350,6 +395,33 @@ public:
      */
     pair<int, int> optimizeNNI(bool speedNNI = true);
 
+    /**
+     *  Optimize current tree using NNI, alternated with likelihood SPR rounds (-lspr)
+     *  until neither of them improves the tree
+     *
+     *  @return
+     *      <number of NNI steps, number of NNIs> done
+     */
+    pair<int, int> optimizeNNISPR(bool speedNNI = true);
+
+    /**
+     *  One round of SPR moves on the current tree: every subtree is tentatively regrafted to all
+     *  branches within params->lh_spr_radius, each position is scored with the current branch lengths
+     *  reusing the partial likelihoods of the subtree, and only the params->lh_spr_top best positions
+     *  get their branch lengths optimized. The first improving position is applied.
+     *
+     *  @return number of SPR moves applied
+     */
+    int optimizeLazySPR();
+
+    /**
+     *  Move the subtree rooted at node to the best position within params->lh_spr_radius
+     *  @param node root of the subtree
+     *  @param dad the node connecting the subtree to the rest of the tree
+     *  @return TRUE if a better tree was found and the move was applied, FALSE if the tree is unchanged
+     */
+    bool regraftLazySPR(PhyloNode *node, PhyloNode *dad);
+
     /**
      *  Return the current best score found
      */
@@ -411,6 +483,15 @@ public:
      */
     void filterNNIBranches(vector<NNIMove> &appliedNNIs, Branches &outBranches);
 
+    /**
+     *  @brief evaluate the NNIs selected for applying whose score was taken from the -nniinc cache
+     *  @param appliedNNIs NNIs selected for applying
+     *  @param positiveNNIs [IN/OUT] all positive NNIs, re-evaluated NNIs are updated or removed
+     *  @param cachedBranches [IN/OUT] branches with cached scores, re-evaluated ones are removed
+     *  @return TRUE if any NNI was re-evaluated, so that the selection has to be redone
+     */
+    bool reevaluateCachedNNIs(vector<NNIMove> &appliedNNIs, vector<NNIMove> &positiveNNIs, set<int> &cachedBranches);
+
     
     /**
      * @brief get branches that correspond to the splits in \a nniSplits
@@ -449,6 +530,14 @@ public:
      */
     void evaluateNNIs(Branches &nniBranches, vector<NNIMove> &outNNIMoves);
 
+    /**
+     * @brief Evaluate NNIs on several branches concurrently, each on its own copy of the tree (-nnipar option)
+     *
+     * @param nniBranches [IN] branches the branches on which NNIs will be evaluated
+     * @param positiveNNIs [OUT] positive NNIs in the order of nniBranches
+     */
+    void evaluateNNIsParallel(Branches &nniBranches, vector<NNIMove> &positiveNNIs);
+
     double optimizeNNIBranches(Branches &nniBranches);
 
     /**
@@ -558,6 +647,23 @@ public:
      */
     SearchInfo searchinfo;
 
+    /**
+     *  number of top candidate trees from which the tree to perturb is drawn,
+     *  adapted during the search with -adapt
+     */
+    int perturb_pool_size;
+
+    /**
+     *  1 for each recent iteration whose tree entered the perturbation pool, 0 otherwise
+     */
+    IntVector search_successes;
+
+    /**
+     *  adapt the perturbation strength, the perturbation pool size and the number of
+     *  unsuccessful iterations to stop to the success rate of the recent iterations
+     */
+    void adaptSearchParameters();
+
     /**
      *  Vector contains number of NNIs used at each iterations
      */
@@ -637,6 +743,59 @@ protected:
      */
     vector<double> vecImpProNNI;
 
+    /**
+     *  Copies of this tree for concurrent NNI evaluation, sharing alignment and model
+     */
+    vector<PhyloTree*> nni_workers;
+
+    /**
+     *  nodes of each NNI worker indexed by node ID
+     */
+    vector<vector<PhyloNode*> > nni_worker_nodes;
+
+    /**
+     *  partial likelihood and scale_num sizes the NNI workers were allocated for
+     */
+    size_t nni_worker_lh_size, nni_worker_scale_size;
+
+    /**
+     *  create NNI workers if needed and copy topology, branch lengths and model of this tree to them
+     */
+    void initNNIWorkers();
+
+    /**
+     *  copy topology and branch lengths of this tree to an NNI worker, reusing its nodes
+     *  @param id worker ID
+     *  @return TRUE if the topology of the worker changed
+     */
+    bool copyTopologyToNNIWorker(int id);
+
+    /**
+     *  delete all NNI workers
+     */
+    void deleteNNIWorkers();
+
+    /**
+     *  Copies of this tree doing perturbation and NNI search in parallel threads, sharing alignment and model
+     */
+    vector<IQTree*> searchers;
+
+    /**
+     *  random number streams of the searchers
+     */
+    vector<int*> searcher_rstreams;
+
+    /**
+     *  create the searchers with the current tree and divide the threads among them
+     *  @param seed_offset the random stream of searcher i is seeded with ran_seed + seed_offset + i + 1
+     */
+    void initSearchers(int seed_offset);
+
+    /**
+     *  delete all searchers
+     */
+    void deleteSearchers();
+
     /**
         Optimal branch lengths
      */
@@ -689,6 +848,13 @@ public:
      */
     int addTreeToCandidateSet(string treeString, double score, bool updateStopRule, int sourceProcID);
 
+    /**
+     *  same as above for a tree whose topology fingerprint is already known,
+     *  e.g. the current tree, saves parsing \a treeString
+     *  @param topology fingerprint of \a treeString (see MTree::getTopologyFingerprint)
+     */
+    int addTreeToCandidateSet(string treeString, double score, bool updateStopRule, int sourceProcID, uint64_t topology);
+
     /**
         MPI: synchronize candidate trees between all processes
         @param nTrees number of trees to broadcast
@@ -783,6 +949,12 @@ public:
     /** bootstrap tree strings with branch lengths, for -wbtl option */
     StrVector boot_trees_brlen;
 
+    /** topology fingerprint of boot_tree_string */
+    uint64_t boot_tree_fingerprint;
+
+    /** newick string of the last tree assigned to a bootstrap sample, reused while its topology stays the same */
+    string boot_tree_string;
+
 	/** number of multiple optimal trees per replicate */
 	IntVector boot_counts;
 
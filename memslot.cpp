@@ -21,13 +21,35 @@
 
 #include "phylotree.h"
 #include "memslot.h"
+#if !defined(_WIN32) && !defined(WIN32)
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 const int MEM_LOCKED = 1;
 const int MEM_SPECIAL = 2;
 
+MemSlotVector::MemSlotVector() : vector<MemSlot>() {
+    free_count = 0;
+    use_clock = 0;
+    tree = NULL;
+    spill_fd = -1;
+    spill_map = NULL;
+    spill_capacity = 0;
+    spill_lh_bytes = spill_scale_bytes = 0;
+    num_allocs = num_evictions = num_recomputes = 0;
+    num_hits = num_spills = 0;
+}
+
+MemSlotVector::~MemSlotVector() {
+    releaseSpill();
+}
+
 void MemSlotVector::init(PhyloTree *tree, int num_slot) {
     if (Params::getInstance().lh_mem_save != LM_MEM_SAVE)
         return;
+    this->tree = tree;
     reserve(num_slot+2);
     resize(num_slot);
     size_t lh_size = tree->getPartialLhSize();
@@ -37,6 +59,172 @@ void MemSlotVector::init(PhyloTree *tree, int num_slot) {
         it->partial_lh = tree->central_partial_lh + lh_size*(it-begin());
         it->scale_num = tree->central_scale_num + scale_size*(it-begin());
     }
+    if (Params::getInstance().lh_mem_spill)
+        initSpill(tree);
+}
+
+void MemSlotVector::initSpill(PhyloTree *tree) {
+    releaseSpill();
+    spill_lh_bytes = tree->getPartialLhBytes();
+    spill_scale_bytes = tree->getScaleNumBytes();
+#if defined(_WIN32) || defined(WIN32)
+    outWarning("-spill is not supported on Windows, partial likelihoods will be recomputed");
+#else
+    string filename = string(Params::getInstance().out_prefix) + ".spill.XXXXXX";
+    spill_fd = mkstemp(&filename[0]);
+    if (spill_fd < 0)
+        outError("Cannot create spill file ", filename);
+    // the file is only accessed through spill_fd and removed once closed
+    unlink(filename.c_str());
+#endif
+}
+
+void MemSlotVector::releaseSpill() {
+#if !defined(_WIN32) && !defined(WIN32)
+    if (spill_map)
+        munmap(spill_map, spill_capacity*(spill_lh_bytes+spill_scale_bytes));
+    if (spill_fd >= 0)
+        close(spill_fd);
+#endif
+    spill_map = NULL;
+    spill_fd = -1;
+    spill_capacity = 0;
+    spill_id_map.clear();
+}
+
+char *MemSlotVector::getSpillRecord(PhyloNeighbor *nei) {
+    size_t record_bytes = spill_lh_bytes+spill_scale_bytes;
+    auto it = spill_id_map.find(nei);
+    if (it != spill_id_map.end())
+        return spill_map + it->second*record_bytes;
+    size_t id = spill_id_map.size();
+#if !defined(_WIN32) && !defined(WIN32)
+    if (id >= spill_capacity) {
+        // double the file size
+        size_t new_capacity = max(spill_capacity*2, size()+2);
+        if (spill_map)
+            munmap(spill_map, spill_capacity*record_bytes);
+        if (ftruncate(spill_fd, new_capacity*record_bytes) != 0)
+            outError("Cannot enlarge spill file, check free disk space");
+        void *map = mmap(NULL, new_capacity*record_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, spill_fd, 0);
+        if (map == MAP_FAILED)
+            outError("Cannot map spill file into memory");
+        spill_map = (char*)map;
+        spill_capacity = new_capacity;
+    }
+#endif
+    spill_id_map[nei] = id;
+    return spill_map + id*record_bytes;
+}
+
+void MemSlotVector::evict(iterator it) {
+    PhyloNeighbor *nei = it->nei;
+    if ((nei->partial_lh_computed & 1) == 0 || nei->partial_lh != it->partial_lh) {
+        nei->clearPartialLh();
+        return;
+    }
+    // a neighbor of the current traversal is not computed yet
+    for (auto info = tree->traversal_info.begin(); info != tree->traversal_info.end(); info++)
+        if (info->dad_branch == nei) {
+            nei->clearPartialLh();
+            return;
+        }
+    num_evictions++;
+    // any later change of the subtree resets partial_lh_computed to 0, which also invalidates the record
+    if (spill_fd < 0) {
+        nei->partial_lh_computed = LH_EVICTED;
+        return;
+    }
+    // write only if the file does not have these partial likelihoods yet
+    if ((nei->partial_lh_computed & LH_SPILLED) == 0) {
+        char *record = getSpillRecord(nei);
+        memcpy(record, it->partial_lh, spill_lh_bytes);
+        memcpy(record+spill_lh_bytes, it->scale_num, spill_scale_bytes);
+        num_spills++;
+    }
+    nei->partial_lh_computed = LH_EVICTED + LH_SPILLED;
+}
+
+bool MemSlotVector::needPageIn(PhyloNeighbor *nei, Node *dad) {
+    if ((nei->partial_lh_computed & LH_EVICTED) == 0)
+        return false;
+    if (spill_fd >= 0 && (nei->partial_lh_computed & LH_SPILLED)) {
+        // recompute if all children are available
+        FOR_NEIGHBOR_IT(nei->node, dad, it)
+            if (!(*it)->node->isLeaf() && (((PhyloNeighbor*)*it)->partial_lh_computed & 1) == 0) {
+                num_hits++;
+                return true;
+            }
+    }
+    num_recomputes++;
+    return false;
+}
+
+void MemSlotVector::setFocus(Node *node1, Node *node2) {
+    if (Params::getInstance().mem_evict_policy != MEM_EVICT_NNI)
+        return;
+    focus_nei.clear();
+    // partial likelihoods at the branch ends and their adjacent nodes, in both directions
+    Node *ends[2] = {node1, node2};
+    for (int i = 0; i < 2; i++)
+        FOR_NEIGHBOR_IT(ends[i], NULL, it) {
+            Node *node = (*it)->node;
+            FOR_NEIGHBOR_IT(node, NULL, it2) {
+                focus_nei.push_back((PhyloNeighbor*)*it2);
+                focus_nei.push_back((PhyloNeighbor*)(*it2)->node->findNeighbor(node));
+            }
+        }
+}
+
+void MemSlotVector::getSpillRecord(PhyloNeighbor *nei, double* &partial_lh, UBYTE* &scale_num) {
+    auto it = spill_id_map.find(nei);
+    assert(it != spill_id_map.end());
+    char *record = spill_map + it->second*(spill_lh_bytes+spill_scale_bytes);
+    partial_lh = (double*)record;
+    scale_num = (UBYTE*)(record+spill_lh_bytes);
+}
+
+void MemSlotVector::report(ostream &out) {
+    if (Params::getInstance().lh_mem_save != LM_MEM_SAVE || empty())
+        return;
+    out << "Memory saving mode: " << size() << " slots, " << num_allocs << " allocations, "
+        << num_evictions << " evictions, " << num_recomputes << " recomputations" << endl;
+    if (spill_fd < 0)
+        return;
+    out << "Spill file of memory saving mode: " << num_hits << " hits, " << num_spills << " spills" << endl;
+}
+
+MemSlotVector::iterator MemSlotVector::findVictim(bool skip_focus) {
+    MemEvictPolicy policy = Params::getInstance().mem_evict_policy;
+    double min_cost = DBL_MAX;
+    iterator best = end();
+    for (iterator it = begin(); it != end(); it++) {
+        if ((it->status & MEM_LOCKED) || (it->status & MEM_SPECIAL))
+            continue;
+        if (skip_focus && find(focus_nei.begin(), focus_nei.end(), it->nei) != focus_nei.end())
+            continue;
+        double cost;
+        switch (policy) {
+        case MEM_EVICT_LRU:
+            cost = it->last_used;
+            break;
+        case MEM_EVICT_WEIGHTED:
+            // recomputation cost grows with subtree size, discounted by the time since last use
+            cost = (double)it->nei->size / (use_clock - it->last_used + 1);
+            break;
+        default:
+            cost = it->nei->size;
+            break;
+        }
+        if (cost < min_cost) {
+            best = it;
+            min_cost = cost;
+            // 2 is the minimum size
+            if (policy != MEM_EVICT_LRU && policy != MEM_EVICT_WEIGHTED && cost == 2)
+                break;
+        }
+    }
+    return best;
 }
 
 void MemSlotVector::reset() {
@@ -63,6 +251,7 @@ void MemSlotVector::addNei(PhyloNeighbor *nei, iterator it) {
     nei->partial_lh = it->partial_lh;
     nei->scale_num = it->scale_num;
     it->nei = nei;
+    it->last_used = ++use_clock;
     nei_id_map[nei] = it-begin();
 }
 
@@ -75,6 +264,7 @@ void MemSlotVector::addSpecialNei(PhyloNeighbor *nei) {
     ms.nei = nei;
     ms.partial_lh = nei->partial_lh;
     ms.scale_num = nei->scale_num;
+    ms.last_used = ++use_clock;
     push_back(ms);
     nei_id_map[nei] = size()-1;
 }
@@ -99,6 +289,7 @@ bool MemSlotVector::lock(PhyloNeighbor *nei) {
         return false;
     assert((id->status & MEM_LOCKED) == 0);
     id->status |= MEM_LOCKED;
+    id->last_used = ++use_clock;
     return true;
 }
 
@@ -140,31 +331,24 @@ int MemSlotVector::allocate(PhyloNeighbor *nei) {
         assert(it->nei == NULL);
         addNei(nei, it);
         free_count++;
+        num_allocs++;
         return it-begin();
     }
 
-    int min_size = INT_MAX;
-    iterator best = end();
-
-
-    // no free slot found, find an unlocked slot with minimal size
-    for (iterator it = begin(); it != end(); it++)
-        if ((it->status & MEM_LOCKED) == 0 && (it->status & MEM_SPECIAL) == 0 && min_size > it->nei->size) {
-            best = it;
-            min_size = it->nei->size;
-            // 2 is the minimum size
-            if (min_size == 2)
-                break;
-        }
+    // no free slot found, find an unlocked slot to evict
+    iterator best = findVictim(Params::getInstance().mem_evict_policy == MEM_EVICT_NNI);
+    if (best == end() && !focus_nei.empty())
+        best = findVictim(false);
 
     if (best == end())
         return -1;
 
     // clear mem assigned to it->nei
-    best->nei->clearPartialLh();
+    evict(best);
 
     // assign mem to nei
     addNei(nei, best);
+    num_allocs++;
     return best-begin();
 
 }
@@ -178,10 +362,11 @@ void MemSlotVector::update(PhyloNeighbor *nei) {
 //        return;
     if (it->nei != nei) {
         // clear mem assigned to it->nei
-        it->nei->clearPartialLh();
+        evict(it);
 
         // assign mem to nei
         addNei(nei, it);
+        num_allocs++;
     }
 }
 
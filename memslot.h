@@ -26,6 +26,12 @@
 #error "Please #include phylotree.h before including this header file" 
 #endif
 
+/** bit of PhyloNeighbor::partial_lh_computed telling that the spill file holds its partial likelihoods */
+const int LH_SPILLED = 4;
+
+/** bit of PhyloNeighbor::partial_lh_computed telling that its partial likelihoods were evicted */
+const int LH_EVICTED = 8;
+
 /**
     one memory slot, used for memory saving technique
 */
@@ -34,6 +40,7 @@ struct MemSlot {
     PhyloNeighbor *nei; // neighbor assigned to this slot
     double *partial_lh; // partial_lh assigned to this slot
     UBYTE *scale_num; // scale_num assigned to this slot
+    int64_t last_used; // time stamp of the last allocation or lock
 
     PhyloNeighbor *saved_nei;
 };
@@ -44,6 +51,10 @@ struct MemSlot {
 class MemSlotVector : public vector<MemSlot> {
 public:
 
+    MemSlotVector();
+
+    ~MemSlotVector();
+
     /** initialize with a specified number of slots */
     void init(PhyloTree *tree, int num_slot);
 
@@ -93,8 +104,73 @@ public:
     /** restore neighbor, after calling replace */
     void restore(PhyloNeighbor *new_nei, PhyloNeighbor *old_nei);
 
+    /**
+        called for every nei whose partial_lh has to be computed: counts recomputations of evicted
+        partial likelihoods and checks if nei should be paged in from the spill file instead.
+        recomputing is preferred if it takes only one kernel pass over computed children
+        @param nei neighbor with partial_lh not computed
+        @param dad dad of nei
+        @return TRUE if nei has a valid spilled copy worth reading
+    */
+    bool needPageIn(PhyloNeighbor *nei, Node *dad);
+
+    /**
+        set the branch evaluated by NNI, its surrounding partial likelihoods are kept by -mem-evict nni
+        @param node1 one end of the branch
+        @param node2 the other end
+    */
+    void setFocus(Node *node1, Node *node2);
+
+    /**
+        get the spilled partial likelihoods of nei, safe to call from several threads
+        @param nei neighbor paged in
+        @param[out] partial_lh spilled partial_lh
+        @param[out] scale_num spilled scale_num
+    */
+    void getSpillRecord(PhyloNeighbor *nei, double* &partial_lh, UBYTE* &scale_num);
+
+    /** close the spill file */
+    void releaseSpill();
+
+    /** print allocation, eviction and recomputation counts, and those of the spill file */
+    void report(ostream &out);
+
+    /** number of slots allocated */
+    int64_t num_allocs;
+
+    /** number of computed partial likelihoods evicted */
+    int64_t num_evictions;
+
+    /** number of evicted partial likelihoods computed again */
+    int64_t num_recomputes;
+
+    /** number of partial likelihoods paged in from the spill file */
+    int64_t num_hits;
+
+    /** number of partial likelihoods written to the spill file */
+    int64_t num_spills;
+
 protected:
 
+    /**
+        evict the partial likelihoods of the neighbor assigned to a slot.
+        with -spill they are written to the spill file unless the file already has them
+    */
+    void evict(iterator it);
+
+    /**
+        find the slot to evict according to -mem-evict
+        @param skip_focus TRUE to keep slots around the NNI branch set by setFocus
+        @return unlocked slot, end() if none
+    */
+    iterator findVictim(bool skip_focus);
+
+    /** open the spill file, called by init() if -spill is used */
+    void initSpill(PhyloTree *tree);
+
+    /** @return spill record of nei, the file is enlarged if needed */
+    char *getSpillRecord(PhyloNeighbor *nei);
+
 
     /** 
         map from neighbor to slot ID for fast lookup
@@ -105,6 +181,30 @@ protected:
     /** counter of free slot ID */
     int free_count;
 
+    /** time stamp for last_used of the slots */
+    int64_t use_clock;
+
+    /** neighbors around the current NNI branch */
+    vector<PhyloNeighbor*> focus_nei;
+
+    /** tree owning the slots, to check its traversal_info when evicting */
+    PhyloTree *tree;
+
+    /** file descriptor of the spill file, -1 if not used */
+    int spill_fd;
+
+    /** memory mapping of the spill file */
+    char *spill_map;
+
+    /** number of records the spill file can hold */
+    size_t spill_capacity;
+
+    /** bytes of partial_lh and scale_num in one spill record */
+    size_t spill_lh_bytes, spill_scale_bytes;
+
+    /** map from neighbor to its record in the spill file */
+    unordered_map<PhyloNeighbor*, size_t> spill_id_map;
+
 };
 
 
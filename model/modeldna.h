@@ -91,6 +91,12 @@ public:
 	*/
 	bool setRateType(const char *rate_spec);
 
+	/**
+		@return rate parameter specification: entries with the same ID share one rate,
+		entries with ID 0 are fixed to 1
+	*/
+	const string &getRateType() { return param_spec; }
+
 	/**
 		return the number of dimensions
 	*/
@@ -14,7 +14,6 @@
 #include "modelmorphology.h"
 #include "modelset.h"
 #include "modelmixture.h"
-//#include "phylokernelmixture.h"
 
 using namespace std;
 
@@ -1828,6 +1828,40 @@ void MTree::assignLeafID(Node *node, Node *dad) {
     assignLeafID((*it)->node, node);
 }
 
+/**
+    64-bit mixing function (splitmix64 finalizer)
+*/
+inline uint64_t mixHash64(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+uint64_t MTree::getTopologyFingerprint() {
+    vector<uint64_t> subtrees;
+    uint64_t all_taxa = getSubtreeHashes(subtrees, root, NULL);
+    // a split is hashed by the smaller hash of its two sides, and splits are summed
+    // after mixing so that they do not cancel out like a plain XOR would
+    uint64_t fingerprint = mixHash64(leafNum);
+    for (vector<uint64_t>::iterator it = subtrees.begin(); it != subtrees.end(); it++)
+        fingerprint += mixHash64(min(*it, all_taxa ^ *it));
+    return fingerprint;
+}
+
+uint64_t MTree::getSubtreeHashes(vector<uint64_t> &subtrees, Node *node, Node *dad) {
+    if (node->isLeaf() && dad)
+        return mixHash64(node->id);
+    uint64_t hash = (node->isLeaf()) ? mixHash64(node->id) : 0;
+    FOR_NEIGHBOR_IT(node, dad, it) {
+        uint64_t child = getSubtreeHashes(subtrees, (*it)->node, node);
+        if (!node->isLeaf() && !(*it)->node->isLeaf())
+            subtrees.push_back(child);
+        hash ^= child;
+    }
+    return hash;
+}
+
 void MTree::getTaxa(Split &taxa, Node *node, Node *dad) {
 	if (!node) node = root;
 	if (node->isLeaf()) {
@@ -568,6 +568,23 @@ public:
      */
     void initializeSplitMap(Split *resp = NULL, Node *node = NULL, Node *dad = NULL);
 
+    /**
+            compute a 64-bit fingerprint of the tree topology from its splits, without
+            converting the tree into a string. Taxa are identified by leaf IDs; the result
+            does not depend on the root or on the order of neighbors.
+            @return topology fingerprint, equal for trees with the same split system
+     */
+    uint64_t getTopologyFingerprint();
+
+    /**
+            collect the taxon hashes below node and the subtree hashes of inner branches
+            @param subtrees (OUT) hashes of the taxa below each inner branch
+            @param node the starting node
+            @param dad dad of the node, used to direct the search
+            @return XOR of the taxon hashes below node
+     */
+    uint64_t getSubtreeHashes(vector<uint64_t> &subtrees, Node *node, Node *dad);
+
     /**
     *   Generate a split for each neighbor node
     */
@@ -285,6 +285,14 @@ double Optimization::brent_opt (double ax, double bx, double cx, double tol,
 #undef TINY
 
 
+void Optimization::computeFuncDervMulti(int num, double *values, double *fvalues, double *df, double *ddf) {
+	for (int i = 0; i < num; i++) {
+		fvalues[i] = computeFunction(values[i]);
+		if (df)
+			computeFuncDerv(values[i], df[i], ddf[i]);
+	}
+}
+
 double Optimization::minimizeOneDimen(double xmin, double xguess, double xmax, double tolerance, double *fx, double *f2x) {
 	double eps, optx, ax, bx, cx, fa, fb, fc;
 	//int    converged;	/* not converged error flag */
@@ -301,14 +309,21 @@ double Optimization::minimizeOneDimen(double xmin, double xguess, double xmax, d
 	
 	/* check if this works */
     // compute fb first to save some computation, if any
-	fb = computeFunction(bx);
-	fa = computeFunction(ax);
-	fc = computeFunction(cx);
+	double x3[3] = {bx, ax, cx}, f3[3];
+	computeFuncDervMulti(3, x3, f3, NULL, NULL);
+	fb = f3[0];
+	fa = f3[1];
+	fc = f3[2];
 
 	/* if it works use these borders else be conservative */
 	if ((fa < fb) || (fc < fb)) {
-		if (ax != xmin) fa = computeFunction(xmin);
-		if (cx != xmax) fc = computeFunction(xmax);
+		int num = 0;
+		if (ax != xmin) x3[num++] = xmin;
+		if (cx != xmax) x3[num++] = xmax;
+		computeFuncDervMulti(num, x3, f3, NULL, NULL);
+		num = 0;
+		if (ax != xmin) fa = f3[num++];
+		if (cx != xmax) fc = f3[num++];
 		ax = xmin;
 		cx = xmax;
 	}
@@ -342,15 +357,22 @@ double Optimization::minimizeOneDimenSafeMode(double xmin, double xguess, double
 {
 	double ferror;
 	double optx = minimizeOneDimen(xmin, xguess, xmax, tolerance, f, &ferror);
+	// check value at the boundary, both bounds are evaluated together
+	double xbound[2], fbound[2];
+	int num = 0;
+	bool check_max = (optx < xmax), check_min = (optx > xmin || check_max);
+	if (check_max) xbound[num++] = xmax;
+	if (check_min) xbound[num++] = xmin;
+	computeFuncDervMulti(num, xbound, fbound, NULL, NULL);
 	double fnew;
-	// check value at the boundary
-	if ((optx < xmax) && (fnew = computeFunction(xmax)) <= *f+tolerance) {
+	num = 0;
+	if (check_max && (fnew = fbound[num++]) <= *f+tolerance) {
 		//if (verbose_mode >= VB_MAX)
 			//cout << "Note from Newton safe mode: " << optx << " (" << f << ") -> " << xmax << " ("<< fnew << ")" << endl;
 		optx = xmax;
 		*f = fnew;
 	}
-	if ((optx > xmin) && (fnew = computeFunction(xmin)) <= *f+tolerance) {
+	if (check_min && (optx > xmin) && (fnew = fbound[num]) <= *f+tolerance) {
 		//if (verbose_mode >= VB_MAX)
 			//cout << "Note from Newton safe mode: " << optx << " -> " << xmin << endl;
 		optx = xmin;
@@ -443,6 +465,8 @@ double Optimization::minimizeNewton(double x1, double xguess, double x2, double
 		}
 //		fold = fm;
 //		fm = computeFuncDerv(rts,f,df);
+		// one point per step: probing a predicted next step together with rts in
+		// computeFuncDervMulti() saved only 3-6% of the steps and was slower overall
         computeFuncDerv(rts,f,df);
 		if (!isfinite(f) || !isfinite(df)) nrerror("Wrong computeFuncDerv");
 		if (df > 0.0 && fabs(f) < xacc) {
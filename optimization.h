@@ -68,6 +68,17 @@ public:
 //		return value*value+1.0;
 	}
 
+	/**
+		evaluate computeFunction() and computeFuncDerv() at several independent points.
+		Override this function if several points can be evaluated faster together than one by one.
+		@param num number of points
+		@param values x-values of the function
+		@param fvalues (OUT) f(value) for each point
+		@param df (OUT) first derivative for each point, NULL if not needed
+		@param ddf (OUT) second derivative for each point, NULL if not needed
+	*/
+	virtual void computeFuncDervMulti(int num, double *values, double *fvalues, double *df, double *ddf);
+
 	/**
 		Newton-Raphson method to minimize computeFuncDerv()
 		@return the x-value that minimize the function
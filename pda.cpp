@@ -2435,6 +2435,7 @@ int main(int argc, char *argv[]) {
 	if (Params::getInstance().num_threads >= 1) {
         omp_set_num_threads(Params::getInstance().num_threads);
         Params::getInstance().num_threads = omp_get_max_threads();
+        ThreadPool::getInstance().init(Params::getInstance().num_threads);
     }
 //	int max_threads = omp_get_max_threads();
 	int max_procs = countPhysicalCPUCores();
@@ -1360,7 +1360,9 @@ void initializeParams(Params &params, IQTree &iqtree, vector<ModelInfo> &model_i
         fmodel.precision(4);
         fmodel << fixed;
 
-        params.model_name = testModel(params, &iqtree, model_info, fmodel, models_block, params.num_threads, "", true);
+        // with -deadline, model selection may take a third of the remaining time, one budget for all partitions
+        double model_deadline = (params.deadline > 0) ? getRealTime() + (params.deadline - getRealTime())/3 : 0.0;
+        params.model_name = testModel(params, &iqtree, model_info, fmodel, models_block, params.num_threads, "", true, model_deadline);
         fmodel.close();
         params.startCPUTime = start_cpu_time;
         params.start_real_time = start_real_time;
@@ -1841,12 +1843,15 @@ void runTreeReconstruction(Params &params, string &original_model, IQTree &iqtre
         int bestThreads = iqtree.testNumThreads();
         iqtree.setLikelihoodKernel(iqtree.sse, bestThreads);
         omp_set_num_threads(bestThreads);
+        ThreadPool::getInstance().init(bestThreads);
         params.num_threads = bestThreads;
     }
 #endif
 
 
     iqtree.initializeAllPartialLh();
+    if (params.lk_float_storage && params.lk_float_tolerance > 0.0)
+        iqtree.checkFloatPartialLh();
 	double initEpsilon = params.min_iterations == 0 ? params.modelEps : (params.modelEps*10);
 
 
@@ -1865,6 +1870,8 @@ void runTreeReconstruction(Params &params, string &original_model, IQTree &iqtre
 
     // Optimize model parameters and branch lengths using ML for the initial tree
 	string initTree;
+    // duration of the initial model optimization, used to plan the final one with -deadline
+    double model_opt_time = 0.0;
 	iqtree.clearAllPartialLH();
 
     iqtree.getModelFactory()->restoreCheckpoint();
@@ -1876,7 +1883,9 @@ void runTreeReconstruction(Params &params, string &original_model, IQTree &iqtre
         initTree = iqtree.getTreeString();
         cout << "CHECKPOINT: Model parameters restored, LogL: " << iqtree.getCurScore() << endl;
     } else {
+        model_opt_time = getRealTime();
         initTree = iqtree.optimizeModelParameters(true, initEpsilon);
+        model_opt_time = getRealTime() - model_opt_time;
         iqtree.saveCheckpoint();
         iqtree.getModelFactory()->saveCheckpoint();
         iqtree.getCheckpoint()->putBool("finishedModelInit", true);
@@ -1914,7 +1923,7 @@ void runTreeReconstruction(Params &params, string &original_model, IQTree &iqtre
 
     // Update best tree
     if (!finishedInitTree) {
-        iqtree.addTreeToCandidateSet(initTree, iqtree.getCurScore(), false, MPIHelper::getInstance().getProcessID());
+        iqtree.addTreeToCandidateSet(initTree, iqtree.getCurScore(), false, MPIHelper::getInstance().getProcessID(), iqtree.getTopologyFingerprint());
         iqtree.printResultTree();
         iqtree.intermediateTrees.update(iqtree.getTreeString(), iqtree.getCurScore());
     }
@@ -1957,7 +1966,7 @@ void runTreeReconstruction(Params &params, string &original_model, IQTree &iqtre
                     initTree = iqtree.optimizeBranches();
                 }
                 cout << "Log-likelihood of BIONJ tree: " << iqtree.getCurScore() << endl;
-                iqtree.candidateTrees.update(initTree, iqtree.getCurScore());
+                iqtree.candidateTrees.update(initTree, iqtree.getCurScore(), iqtree.getTopologyFingerprint());
             }
         }
     }
@@ -1987,6 +1996,15 @@ void runTreeReconstruction(Params &params, string &original_model, IQTree &iqtre
 	pruneTaxa(params, iqtree, pattern_lh, pruned_taxa, linked_name);
 
 	/***************************************** DO STOCHASTIC TREE SEARCH *******************************************/
+	if (params.deadline > 0) {
+		// keep time for the final model optimization and for writing the results
+		double reserve_time = 2 * model_opt_time + 0.05 * (params.deadline - params.start_real_time);
+		// branch tests take about as long as one search iteration
+		bool branch_tests = params.aLRT_replicates > 0 || params.localbp_replicates > 0 || params.aLRT_test || params.aBayes_test;
+		iqtree.stop_rule.setDeadline(params.deadline - reserve_time, branch_tests ? 1 : 0);
+		cout << "Deadline mode: " << convert_time(max(params.deadline - getRealTime(), 0.0)) << " left, tree search stops "
+			<< reserve_time << " seconds before the deadline" << endl;
+	}
 	if (params.min_iterations > 0 && !params.tree_spr) {
 		iqtree.doTreeSearch();
 		iqtree.setAlignment(iqtree.aln);
@@ -2039,6 +2057,9 @@ void runTreeReconstruction(Params &params, string &original_model, IQTree &iqtre
         if (iqtree.getCheckpoint()->getBool("finishedModelFinal")) {
             iqtree.setCurScore(iqtree.computeLikelihood());
             cout << "CHECKPOINT: Final model parameters restored" << endl;
+        } else if (params.deadline > 0 && getRealTime() + model_opt_time > params.deadline) {
+            iqtree.setCurScore(iqtree.computeLikelihood());
+            cout << "NOTE: Final model parameters optimization skipped to meet the deadline" << endl;
         } else {
             cout << "Performs final model parameters optimization" << endl;
             string tree;
@@ -2047,7 +2068,7 @@ void runTreeReconstruction(Params &params, string &original_model, IQTree &iqtre
             // why doing NNI search here?
 //            iqtree.doNNISearch();
             tree = iqtree.optimizeModelParameters(true);
-            iqtree.addTreeToCandidateSet(tree, iqtree.getCurScore(), false, MPIHelper::getInstance().getProcessID());
+            iqtree.addTreeToCandidateSet(tree, iqtree.getCurScore(), false, MPIHelper::getInstance().getProcessID(), iqtree.getTopologyFingerprint());
             iqtree.getCheckpoint()->putBool("finishedModelFinal", true);
             iqtree.saveCheckpoint();
         }
@@ -2057,7 +2078,12 @@ void runTreeReconstruction(Params &params, string &original_model, IQTree &iqtre
 	if (iqtree.isSuperTree())
 		((PhyloSuperTree*) &iqtree)->computeBranchLengths();
 
+    // the search may drift into regions where single precision is less accurate
+    if (params.lk_float_storage && params.lk_float_tolerance > 0.0)
+        iqtree.checkFloatPartialLh();
+
 	cout << "BEST SCORE FOUND : " << iqtree.getCurScore() << endl;
+	iqtree.reportMemSlots(cout);
 
 	if (params.write_candidate_trees) {
 		printTrees(iqtree.getBestTrees(), params, ".imd_trees");
@@ -2080,6 +2106,11 @@ void runTreeReconstruction(Params &params, string &original_model, IQTree &iqtre
 	printMiscInfo(params, iqtree, pattern_lh);
 
 	/****** perform SH-aLRT test ******************/
+	if ((params.aLRT_replicates > 0 || params.localbp_replicates > 0 || params.aLRT_test || params.aBayes_test) && !params.pll
+		&& params.deadline > 0 && getRealTime() + iqtree.stop_rule.getIterationTime() > params.deadline) {
+		outWarning("Branch tests skipped to meet the deadline");
+		params.aLRT_replicates = params.localbp_replicates = params.aLRT_test = params.aBayes_test = 0;
+	}
 	if ((params.aLRT_replicates > 0 || params.localbp_replicates > 0 || params.aLRT_test || params.aBayes_test) && !params.pll) {
 		double mytime = getCPUTime();
 		params.aLRT_replicates = max(params.aLRT_replicates, params.localbp_replicates);
@@ -2118,6 +2149,7 @@ void runTreeReconstruction(Params &params, string &original_model, IQTree &iqtre
 	iqtree.printResultTree();
 
     if (params.upper_bound_NNI) {
+        cout << "NNIs skipped by likelihood upper bound: " << iqtree.skippedNNIub << " / " << iqtree.totalNNIub << endl;
         string out_file_UB = params.out_prefix;
         out_file_UB += ".UB.NNI.main";
         ofstream out_UB;
@@ -1432,6 +1432,29 @@ inline UINT fast_popcount(Vec8ui &x) {
 
 }
 
+#if MAX_VECTOR_SIZE >= 512
+inline UINT fast_popcount(Vec16ui &x) {
+#ifdef __AVX512VPOPCNTDQ__
+    // count the bits of all 8 quadwords in one instruction
+    return _mm512_reduce_add_epi64(_mm512_popcnt_epi64(x));
+#elif defined (__GNUC__) || defined(__clang__)
+    uint64_t vec[8];
+    uint64_t res = 0;
+    x.store(vec);
+    for (int i = 0; i < 8; i++)
+        res += __builtin_popcountll(vec[i]);
+    return res;
+#else
+    uint64_t vec[8];
+    uint64_t res = 0;
+    x.store(vec);
+    for (int i = 0; i < 8; i++)
+        res += _mm_popcnt_u64(vec[i]);
+    return res;
+#endif
+}
+#endif
+
 
 inline void horizontal_popcount(Vec4ui &x) {
     MEM_ALIGN_BEGIN UINT vec[4] MEM_ALIGN_END;
@@ -12,9 +12,6 @@
 #include "vectorclass/vectormath_exp.h"
 #include "phylokernel.h"
 //#include "phylokernelsafe.h"
-//#include "phylokernelmixture.h"
-//#include "phylokernelmixrate.h"
-//#include "phylokernelsitemodel.h"
 
 #include "phylokernelnew.h"
 #define KERNEL_FIX_STATES
@@ -25,6 +22,11 @@
 #error "You must compile this file with AVX512 enabled!"
 #endif
 
+void PhyloTree::setParsimonyKernelAVX512() {
+	computeParsimonyBranchPointer = &PhyloTree::computeParsimonyBranchFastSIMD<Vec16ui>;
+    computePartialParsimonyPointer = &PhyloTree::computePartialParsimonyFastSIMD<Vec16ui>;
+}
+
 void PhyloTree::setDotProductAVX512() {
 #ifdef BOOT_VAL_FLOAT
 		dotProduct = &PhyloTree::dotProductSIMD<float, Vec16f>;
@@ -35,24 +37,28 @@ void PhyloTree::setDotProductAVX512() {
 }
 
 void PhyloTree::setLikelihoodKernelAVX512() {
-//    setParsimonyKernelAVX();
+    vector_size = 8;
+    setParsimonyKernelAVX512();
     if (model_factory && model_factory->model->isSiteSpecificModel()) {
         switch (aln->num_states) {
         case 4:
             computeLikelihoodBranchPointer     = &PhyloTree::computeLikelihoodBranchSIMD    <Vec8d, NORM_LH, 4, true, true>;
             computeLikelihoodDervPointer       = &PhyloTree::computeLikelihoodDervSIMD      <Vec8d, NORM_LH, 4, true, true>;
+            computeLikelihoodDervMultiPointer  = &PhyloTree::computeLikelihoodDervMultiSIMD <Vec8d, NORM_LH, 4, true, true>;
             computePartialLikelihoodPointer    =  &PhyloTree::computePartialLikelihoodSIMD  <Vec8d, NORM_LH, 4, true, true>;
             computeLikelihoodFromBufferPointer = &PhyloTree::computeLikelihoodFromBufferSIMD<Vec8d, NORM_LH, 4, true, true>;
             break;
         case 20:
             computeLikelihoodBranchPointer     = &PhyloTree::computeLikelihoodBranchSIMD    <Vec8d, NORM_LH, 20, true, true>;
             computeLikelihoodDervPointer       = &PhyloTree::computeLikelihoodDervSIMD      <Vec8d, NORM_LH, 20, true, true>;
+            computeLikelihoodDervMultiPointer  = &PhyloTree::computeLikelihoodDervMultiSIMD <Vec8d, NORM_LH, 20, true, true>;
             computePartialLikelihoodPointer    = &PhyloTree::computePartialLikelihoodSIMD   <Vec8d, NORM_LH, 20, true, true>;
             computeLikelihoodFromBufferPointer = &PhyloTree::computeLikelihoodFromBufferSIMD<Vec8d, NORM_LH, 20, true, true>;
             break;
         default:
             computeLikelihoodBranchPointer = &PhyloTree::computeLikelihoodBranchGenericSIMD        <Vec8d, NORM_LH, true, true>;
             computeLikelihoodDervPointer = &PhyloTree::computeLikelihoodDervGenericSIMD            <Vec8d, NORM_LH, true, true>;
+            computeLikelihoodDervMultiPointer = &PhyloTree::computeLikelihoodDervMultiGenericSIMD       <Vec8d, NORM_LH, true, true>;
             computePartialLikelihoodPointer = &PhyloTree::computePartialLikelihoodGenericSIMD      <Vec8d, NORM_LH, true, true>;
             computeLikelihoodFromBufferPointer = &PhyloTree::computeLikelihoodFromBufferGenericSIMD<Vec8d, NORM_LH, true, true>;
             break;
@@ -65,24 +71,28 @@ void PhyloTree::setLikelihoodKernelAVX512() {
         case 2:
             computeLikelihoodBranchPointer = &PhyloTree::computeLikelihoodBranchSIMD<Vec8d, SAFE_LH, 2, true>;
             computeLikelihoodDervPointer = &PhyloTree::computeLikelihoodDervSIMD<Vec8d, SAFE_LH, 2, true>;
+            computeLikelihoodDervMultiPointer = &PhyloTree::computeLikelihoodDervMultiSIMD<Vec8d, SAFE_LH, 2, true>;
             computePartialLikelihoodPointer = &PhyloTree::computePartialLikelihoodSIMD<Vec8d, SAFE_LH, 2, true>;
             computeLikelihoodFromBufferPointer = &PhyloTree::computeLikelihoodFromBufferSIMD<Vec8d, SAFE_LH, 2, true>;
             break;
         case 4:
             computeLikelihoodBranchPointer = &PhyloTree::computeLikelihoodBranchSIMD<Vec8d, SAFE_LH, 4, true>;
             computeLikelihoodDervPointer = &PhyloTree::computeLikelihoodDervSIMD<Vec8d, SAFE_LH, 4, true>;
+            computeLikelihoodDervMultiPointer = &PhyloTree::computeLikelihoodDervMultiSIMD<Vec8d, SAFE_LH, 4, true>;
             computePartialLikelihoodPointer = &PhyloTree::computePartialLikelihoodSIMD<Vec8d, SAFE_LH, 4, true>;
             computeLikelihoodFromBufferPointer = &PhyloTree::computeLikelihoodFromBufferSIMD<Vec8d, SAFE_LH, 4, true>;
             break;
         case 20:
             computeLikelihoodBranchPointer = &PhyloTree::computeLikelihoodBranchSIMD<Vec8d, SAFE_LH, 20, true>;
             computeLikelihoodDervPointer = &PhyloTree::computeLikelihoodDervSIMD<Vec8d, SAFE_LH, 20, true>;
+            computeLikelihoodDervMultiPointer = &PhyloTree::computeLikelihoodDervMultiSIMD<Vec8d, SAFE_LH, 20, true>;
             computePartialLikelihoodPointer = &PhyloTree::computePartialLikelihoodSIMD<Vec8d, SAFE_LH, 20, true>;
             computeLikelihoodFromBufferPointer = &PhyloTree::computeLikelihoodFromBufferSIMD<Vec8d, SAFE_LH, 20, true>;
             break;
         default:
             computeLikelihoodBranchPointer = &PhyloTree::computeLikelihoodBranchGenericSIMD<Vec8d, SAFE_LH, true>;
             computeLikelihoodDervPointer = &PhyloTree::computeLikelihoodDervGenericSIMD<Vec8d, SAFE_LH, true>;
+            computeLikelihoodDervMultiPointer = &PhyloTree::computeLikelihoodDervMultiGenericSIMD<Vec8d, SAFE_LH, true>;
             computePartialLikelihoodPointer = &PhyloTree::computePartialLikelihoodGenericSIMD<Vec8d, SAFE_LH, true>;
             computeLikelihoodFromBufferPointer = &PhyloTree::computeLikelihoodFromBufferGenericSIMD<Vec8d, SAFE_LH, true>;
             break;
@@ -94,24 +104,28 @@ void PhyloTree::setLikelihoodKernelAVX512() {
 	case 2:
         computeLikelihoodBranchPointer = &PhyloTree::computeLikelihoodBranchSIMD<Vec8d, NORM_LH, 2, true>;
         computeLikelihoodDervPointer = &PhyloTree::computeLikelihoodDervSIMD<Vec8d, NORM_LH, 2, true>;
+        computeLikelihoodDervMultiPointer = &PhyloTree::computeLikelihoodDervMultiSIMD<Vec8d, NORM_LH, 2, true>;
         computePartialLikelihoodPointer = &PhyloTree::computePartialLikelihoodSIMD<Vec8d, NORM_LH, 2, true>;
         computeLikelihoodFromBufferPointer = &PhyloTree::computeLikelihoodFromBufferSIMD<Vec8d, NORM_LH, 2, true>;
 		break;
 	case 4:
         computeLikelihoodBranchPointer = &PhyloTree::computeLikelihoodBranchSIMD<Vec8d, NORM_LH, 4, true>;
         computeLikelihoodDervPointer = &PhyloTree::computeLikelihoodDervSIMD<Vec8d, NORM_LH, 4, true>;
+        computeLikelihoodDervMultiPointer = &PhyloTree::computeLikelihoodDervMultiSIMD<Vec8d, NORM_LH, 4, true>;
         computePartialLikelihoodPointer = &PhyloTree::computePartialLikelihoodSIMD<Vec8d, NORM_LH, 4, true>;
         computeLikelihoodFromBufferPointer = &PhyloTree::computeLikelihoodFromBufferSIMD<Vec8d, NORM_LH, 4, true>;
 		break;
 	case 20:
         computeLikelihoodBranchPointer = &PhyloTree::computeLikelihoodBranchSIMD<Vec8d, NORM_LH, 20, true>;
         computeLikelihoodDervPointer = &PhyloTree::computeLikelihoodDervSIMD<Vec8d, NORM_LH, 20, true>;
+        computeLikelihoodDervMultiPointer = &PhyloTree::computeLikelihoodDervMultiSIMD<Vec8d, NORM_LH, 20, true>;
         computePartialLikelihoodPointer = &PhyloTree::computePartialLikelihoodSIMD<Vec8d, NORM_LH, 20, true>;
         computeLikelihoodFromBufferPointer = &PhyloTree::computeLikelihoodFromBufferSIMD<Vec8d, NORM_LH, 20, true>;
 		break;
 	default:
         computeLikelihoodBranchPointer = &PhyloTree::computeLikelihoodBranchGenericSIMD<Vec8d, NORM_LH, true>;
         computeLikelihoodDervPointer = &PhyloTree::computeLikelihoodDervGenericSIMD<Vec8d, NORM_LH, true>;
+        computeLikelihoodDervMultiPointer = &PhyloTree::computeLikelihoodDervMultiGenericSIMD<Vec8d, NORM_LH, true>;
         computePartialLikelihoodPointer = &PhyloTree::computePartialLikelihoodGenericSIMD<Vec8d, NORM_LH, true>;
         computeLikelihoodFromBufferPointer = &PhyloTree::computeLikelihoodFromBufferGenericSIMD<Vec8d, NORM_LH, true>;
 		break;
@@ -554,6 +554,26 @@ inline void dotProductExp(VectorClass *A, VectorClass *B, Numeric D, VectorClass
         X = mul_add(exp(A[i]*D), B[i], X);
 }
 
+/**
+    SAFE_NUMERIC scaling of one category: multiply the underflown lanes of the nstates vectors
+    by SCALING_THRESHOLD_INVER and count one step for them, with a select instead of a branch per lane.
+    The counts stay per pattern and category: a count shared by the categories of a pattern is what
+    the normal mode does, and it lets the small categories underflow on large trees.
+    @param scale_num scale count of the first lane, the next lanes follow every ncat_mix entries
+*/
+#ifndef KERNEL_FIX_STATES
+template <class VectorClass, class BoolClass>
+inline void scaleUnderflownLanes(BoolClass underflown, VectorClass *partial_lh, size_t nstates,
+    UBYTE *scale_num, size_t ncat_mix)
+{
+    VectorClass factor = select(underflown, VectorClass(SCALING_THRESHOLD_INVER), VectorClass(1.0));
+    for (size_t i = 0; i < nstates; i++)
+        partial_lh[i] *= factor;
+    for (size_t x = 0; x < VectorClass::size(); x++)
+        scale_num[x*ncat_mix] += underflown[x];
+}
+#endif
+
 #ifdef KERNEL_FIX_STATES
 template <class VectorClass, const bool SAFE_NUMERIC, const size_t nstates>
 inline void scaleLikelihood(VectorClass &lh_max, double *invar, double *dad_partial_lh, UBYTE *dad_scale_num,
@@ -565,19 +585,10 @@ inline void scaleLikelihood(VectorClass &lh_max, double *invar, double *dad_part
 #endif
 {
     if (SAFE_NUMERIC) {
-        size_t x, i;
+        // BQM 2016-05-03: only scale for non-constant sites
         auto underflown = ((lh_max < SCALING_THRESHOLD) & (lh_max != 0.0) & (VectorClass().load_a(invar) == 0.0));
-        if (horizontal_or(underflown)) { // at least one site has numerical underflown
-            for (x = 0; x < VectorClass::size(); x++)
-            if (underflown[x]) {
-                // BQM 2016-05-03: only scale for non-constant sites
-                // now do the likelihood scaling
-                double *partial_lh = &dad_partial_lh[x];
-                for (i = 0; i < nstates; i++)
-                    partial_lh[i*VectorClass::size()] *= SCALING_THRESHOLD_INVER;
-                dad_scale_num[x*ncat_mix] += 1;
-            }
-        }
+        if (horizontal_or(underflown)) // at least one site has numerical underflown
+            scaleUnderflownLanes(underflown, (VectorClass*)dad_partial_lh, nstates, dad_scale_num, ncat_mix);
     } else {
         size_t x, i;
         auto underflown = (lh_max < SCALING_THRESHOLD) & (lh_max != 0.0) & (VectorClass().load_a(invar) == 0.0);
@@ -596,6 +607,370 @@ inline void scaleLikelihood(VectorClass &lh_max, double *invar, double *dad_part
     }
 }
 
+/**
+    partial sums of the tasks of ThreadPool::run(), added up in task order such that
+    the result does not depend on the order in which the tasks finish
+*/
+#ifndef KERNEL_FIX_STATES
+template <class VectorClass>
+class TaskReduction {
+public:
+    /**
+        @param num_tasks number of tasks
+        @param num_values number of sums per task
+    */
+    TaskReduction(int num_tasks, int num_values) :
+        num_tasks(num_tasks), num_values(num_values), sums(num_tasks*num_values*VectorClass::size(), 0.0) {}
+
+    /** set the value-th sum of a task */
+    void set(int task, int value, VectorClass sum) {
+        sum.store(&sums[(task*num_values + value)*VectorClass::size()]);
+    }
+
+    /** @return value-th sum over all tasks */
+    VectorClass sum(int value) {
+        VectorClass total(0.0);
+        for (int task = 0; task < num_tasks; task++)
+            total += VectorClass().load(&sums[(task*num_values + value)*VectorClass::size()]);
+        return total;
+    }
+
+private:
+    int num_tasks, num_values;
+    vector<double> sums;
+};
+#endif
+
+/*******************************************************
+ *
+ * Helper function for single-precision storage of partial_lh
+ *
+ ******************************************************/
+
+#ifndef KERNEL_FIX_STATES
+
+/** smallest binary exponent kept for single-precision partial_lh, below that values are flushed to zero */
+const int FLOAT_LH_MIN_EXP = -1000;
+
+/** @return 2^exponent for -1022 <= exponent <= 1023, without calling ldexp */
+inline double floatLhPow2(int exponent) {
+    union { uint64_t i; double d; } u;
+    u.i = (uint64_t)(exponent + 1023) << 52;
+    return u.d;
+}
+
+/** @return exponent e such that 2^(e-1) <= x < 2^e for normal x >= 0 (like frexp) */
+inline int floatLhExponent(double x) {
+    union { uint64_t i; double d; } u;
+    u.d = x;
+    return (int)((u.i >> 52) & 0x7ff) - 1022;
+}
+
+/**
+    conversion between single-precision partial_lh and VectorClass.
+    The generic version converts lane by lane, the specializations below convert
+    two VectorClass per single-precision register.
+*/
+template <class VectorClass>
+struct FloatLhVector {
+    /** dst[i] = src[i]*scale for n consecutive VectorClass */
+    static inline void expand(float *src, VectorClass scale, double *dst, size_t n) {
+        const size_t vsize = VectorClass::size();
+        double lane_scale[vsize];
+        scale.store(lane_scale);
+        for (size_t i = 0; i < n; i++)
+            for (size_t x = 0; x < vsize; x++)
+                dst[i*vsize+x] = src[i*vsize+x] * lane_scale[x];
+    }
+    /** dst[i] = src[i]*scale for n consecutive VectorClass, rounded to single precision */
+    static inline void narrow(double *src, VectorClass scale, float *dst, size_t n) {
+        const size_t vsize = VectorClass::size();
+        double lane_scale[vsize];
+        scale.store(lane_scale);
+        for (size_t i = 0; i < n; i++)
+            for (size_t x = 0; x < vsize; x++)
+                dst[i*vsize+x] = src[i*vsize+x] * lane_scale[x];
+    }
+};
+
+#if INSTRSET >= 2
+template <>
+struct FloatLhVector<Vec2d> {
+    static inline void expand(float *src, Vec2d scale, double *dst, size_t n) {
+        size_t i;
+        for (i = 0; i+1 < n; i += 2) {
+            Vec4f lh = Vec4f().load(src + i*2);
+            (extend_low(lh) * scale).store_a(dst + i*2);
+            (extend_high(lh) * scale).store_a(dst + i*2 + 2);
+        }
+        if (i < n)
+            (extend_low(Vec4f().load_partial(2, src + i*2)) * scale).store_a(dst + i*2);
+    }
+    static inline void narrow(double *src, Vec2d scale, float *dst, size_t n) {
+        size_t i;
+        for (i = 0; i+1 < n; i += 2)
+            compress(Vec2d().load_a(src + i*2) * scale, Vec2d().load_a(src + i*2 + 2) * scale).store(dst + i*2);
+        if (i < n)
+            compress(Vec2d().load_a(src + i*2) * scale, Vec2d(0.0)).store_partial(2, dst + i*2);
+    }
+};
+#endif
+
+#if INSTRSET >= 7
+template <>
+struct FloatLhVector<Vec4d> {
+    static inline void expand(float *src, Vec4d scale, double *dst, size_t n) {
+        size_t i;
+        for (i = 0; i+1 < n; i += 2) {
+            Vec8f lh = Vec8f().load(src + i*4);
+            (extend_low(lh) * scale).store_a(dst + i*4);
+            (extend_high(lh) * scale).store_a(dst + i*4 + 4);
+        }
+        if (i < n)
+            (Vec4d(_mm256_cvtps_pd(Vec4f().load(src + i*4))) * scale).store_a(dst + i*4);
+    }
+    static inline void narrow(double *src, Vec4d scale, float *dst, size_t n) {
+        size_t i;
+        for (i = 0; i+1 < n; i += 2)
+            compress(Vec4d().load_a(src + i*4) * scale, Vec4d().load_a(src + i*4 + 4) * scale).store(dst + i*4);
+        if (i < n)
+            Vec4f(_mm256_cvtpd_ps(Vec4d().load_a(src + i*4) * scale)).store(dst + i*4);
+    }
+};
+#endif
+
+#if INSTRSET >= 9
+template <>
+struct FloatLhVector<Vec8d> {
+    static inline void expand(float *src, Vec8d scale, double *dst, size_t n) {
+        size_t i;
+        for (i = 0; i+1 < n; i += 2) {
+            Vec16f lh = Vec16f().load(src + i*8);
+            (extend_low(lh) * scale).store_a(dst + i*8);
+            (extend_high(lh) * scale).store_a(dst + i*8 + 8);
+        }
+        if (i < n)
+            (Vec8d(_mm512_cvtps_pd(Vec8f().load(src + i*8))) * scale).store_a(dst + i*8);
+    }
+    static inline void narrow(double *src, Vec8d scale, float *dst, size_t n) {
+        size_t i;
+        for (i = 0; i+1 < n; i += 2)
+            compress(Vec8d().load_a(src + i*8) * scale, Vec8d().load_a(src + i*8 + 8) * scale).store(dst + i*8);
+        if (i < n)
+            Vec8f(_mm512_cvtpd_ps(Vec8d().load_a(src + i*8) * scale)).store(dst + i*8);
+    }
+};
+#endif
+
+template <class VectorClass>
+inline double *PhyloTree::loadFloatPartialLh(double *partial_lh, size_t ptn, size_t ncat_mix, size_t nstates, double *buffer) {
+    const size_t vsize = VectorClass::size();
+    float *lh = (float*)partial_lh + ptn*ncat_mix*nstates;
+    int16_t *lh_exp = (int16_t*)((float*)partial_lh + float_lh_exp_offset) + ptn*ncat_mix;
+    double scale[vsize];
+    size_t c, x;
+    for (c = 0; c < ncat_mix; c++) {
+        for (x = 0; x < vsize; x++)
+            scale[x] = floatLhPow2(lh_exp[x]);
+        FloatLhVector<VectorClass>::expand(lh, VectorClass().load(scale), buffer + c*nstates*vsize, nstates);
+        lh += nstates*vsize;
+        lh_exp += vsize;
+    }
+    return buffer;
+}
+
+template <class VectorClass>
+inline void PhyloTree::storeFloatPartialLh(double *buffer, double *partial_lh, size_t ptn, size_t ncat_mix, size_t nstates) {
+    const size_t vsize = VectorClass::size();
+    float *lh = (float*)partial_lh + ptn*ncat_mix*nstates;
+    int16_t *lh_exp = (int16_t*)((float*)partial_lh + float_lh_exp_offset) + ptn*ncat_mix;
+    double lane_max[vsize], scale[vsize];
+    size_t c, i, x;
+    for (c = 0; c < ncat_mix; c++) {
+        VectorClass lh_max = 0.0;
+        for (i = 0; i < nstates; i++)
+            lh_max = max(lh_max, abs(VectorClass().load_a(buffer + i*vsize)));
+        lh_max.store(lane_max);
+        // normalize each category to [0.5,1) so that float keeps full precision
+        for (x = 0; x < vsize; x++) {
+            int exponent = max(floatLhExponent(lane_max[x]), FLOAT_LH_MIN_EXP);
+            lh_exp[x] = exponent;
+            scale[x] = floatLhPow2(-exponent);
+        }
+        FloatLhVector<VectorClass>::narrow(buffer, VectorClass().load(scale), lh, nstates);
+        buffer += nstates*vsize;
+        lh += nstates*vsize;
+        lh_exp += vsize;
+    }
+}
+
+/**
+    get the next VectorClass::size() patterns to compute: consecutive patterns without repeats,
+    otherwise patterns whose representative is itself or lies before ptn_lower (computed by another thread).
+    Missing lanes at the end are filled with the last pattern.
+    @param ptn_repeat repeat representative of each pattern, NULL if none
+    @param[in,out] next_ptn first pattern not yet considered
+    @param[out] lane_ptn pattern of each vector lane
+    @return FALSE if there is no pattern left
+*/
+template <class VectorClass>
+inline bool nextRepeatPatterns(int *ptn_repeat, size_t ptn_lower, size_t ptn_upper, size_t &next_ptn, size_t *lane_ptn) {
+    const size_t vsize = VectorClass::size();
+    size_t x = 0;
+    if (!ptn_repeat) {
+        if (next_ptn >= ptn_upper)
+            return false;
+        for (x = 0; x < vsize; x++)
+            lane_ptn[x] = next_ptn+x;
+        next_ptn += vsize;
+        return true;
+    }
+    for (; next_ptn < ptn_upper && x < vsize; next_ptn++) {
+        size_t rep = ptn_repeat[next_ptn];
+        if (rep == next_ptn || rep < ptn_lower)
+            lane_ptn[x++] = next_ptn;
+    }
+    if (x == 0)
+        return false;
+    for (; x < vsize; x++)
+        lane_ptn[x] = lane_ptn[x-1];
+    return true;
+}
+
+/** @return vector of values[lane_ptn[0]], ..., values[lane_ptn[VectorClass::size()-1]] */
+template <class VectorClass>
+inline VectorClass gatherVec(double *values, size_t *lane_ptn) {
+    double buf[VectorClass::size()];
+    for (size_t x = 0; x < VectorClass::size(); x++)
+        buf[x] = values[lane_ptn[x]];
+    return VectorClass().load(buf);
+}
+
+/**
+    gather scale_num of VectorClass::size() arbitrary patterns
+    @param scale_num scaling vector of a subtree
+    @param lane_ptn pattern of each vector lane
+    @param ncat_mix number of rate categories times mixture classes
+    @param[out] buffer scale_num in the layout of one pattern vector
+*/
+template <class VectorClass, const bool SAFE_NUMERIC>
+inline void gatherScaleNum(UBYTE *scale_num, size_t *lane_ptn, size_t ncat_mix, UBYTE *buffer) {
+    for (size_t x = 0; x < VectorClass::size(); x++)
+        if (SAFE_NUMERIC) {
+            for (size_t c = 0; c < ncat_mix; c++)
+                buffer[x*ncat_mix+c] = scale_num[lane_ptn[x]*ncat_mix+c];
+        } else
+            buffer[x] = scale_num[lane_ptn[x]];
+}
+
+/** reverse of gatherScaleNum() */
+template <class VectorClass, const bool SAFE_NUMERIC>
+inline void scatterScaleNum(UBYTE *buffer, UBYTE *scale_num, size_t *lane_ptn, size_t ncat_mix) {
+    for (size_t x = 0; x < VectorClass::size(); x++)
+        if (SAFE_NUMERIC) {
+            for (size_t c = 0; c < ncat_mix; c++)
+                scale_num[lane_ptn[x]*ncat_mix+c] = buffer[x*ncat_mix+c];
+        } else
+            scale_num[lane_ptn[x]] = buffer[x];
+}
+
+template <class VectorClass>
+inline double *PhyloTree::gatherPartialLh(double *partial_lh, size_t *lane_ptn, size_t ncat_mix, size_t nstates, double *buffer) {
+    const size_t vsize = VectorClass::size();
+    size_t block = ncat_mix*nstates;
+    size_t c, i, x;
+    for (x = 0; x < vsize; x++) {
+        size_t ptn_x = lane_ptn[x] % vsize;
+        size_t ptn = lane_ptn[x] - ptn_x;
+        double *buf = buffer + x;
+        if (float_lh_buffer) {
+            float *lh = (float*)partial_lh + ptn*block + ptn_x;
+            int16_t *lh_exp = (int16_t*)((float*)partial_lh + float_lh_exp_offset) + ptn*ncat_mix + ptn_x;
+            for (c = 0; c < ncat_mix; c++) {
+                double scale = floatLhPow2(lh_exp[c*vsize]);
+                for (i = 0; i < nstates; i++) {
+                    *buf = (*lh) * scale;
+                    buf += vsize;
+                    lh += vsize;
+                }
+            }
+        } else {
+            double *lh = partial_lh + ptn*block + ptn_x;
+            for (i = 0; i < block; i++)
+                buf[i*vsize] = lh[i*vsize];
+        }
+    }
+    return buffer;
+}
+
+template <class VectorClass>
+inline void PhyloTree::scatterPartialLh(double *buffer, double *partial_lh, size_t *lane_ptn, size_t ncat_mix, size_t nstates) {
+    const size_t vsize = VectorClass::size();
+    size_t block = ncat_mix*nstates;
+    size_t c, i, x;
+    for (x = 0; x < vsize; x++) {
+        size_t ptn_x = lane_ptn[x] % vsize;
+        size_t ptn = lane_ptn[x] - ptn_x;
+        double *buf = buffer + x;
+        if (float_lh_buffer) {
+            // same normalization as storeFloatPartialLh()
+            float *lh = (float*)partial_lh + ptn*block + ptn_x;
+            int16_t *lh_exp = (int16_t*)((float*)partial_lh + float_lh_exp_offset) + ptn*ncat_mix + ptn_x;
+            for (c = 0; c < ncat_mix; c++) {
+                double lh_max = 0.0;
+                for (i = 0; i < nstates; i++)
+                    lh_max = max(lh_max, fabs(buf[i*vsize]));
+                int exponent = max(floatLhExponent(lh_max), FLOAT_LH_MIN_EXP);
+                lh_exp[c*vsize] = exponent;
+                double scale = floatLhPow2(-exponent);
+                for (i = 0; i < nstates; i++) {
+                    *lh = (*buf) * scale;
+                    buf += vsize;
+                    lh += vsize;
+                }
+            }
+        } else {
+            double *lh = partial_lh + ptn*block + ptn_x;
+            for (i = 0; i < block; i++)
+                lh[i*vsize] = buf[i*vsize];
+        }
+    }
+}
+
+template <class VectorClass, const bool SAFE_NUMERIC>
+inline void PhyloTree::copyRepeatPartialLh(PhyloNeighbor *dad_branch, int *ptn_repeat, size_t ptn_lower, size_t ptn_upper, size_t ncat_mix, size_t nstates) {
+    const size_t vsize = VectorClass::size();
+    size_t block = ncat_mix*nstates;
+    size_t ptn, c, i;
+    for (ptn = ptn_lower; ptn < ptn_upper; ptn++) {
+        size_t rep = ptn_repeat[ptn];
+        if (rep == ptn || rep < ptn_lower)
+            continue;
+        size_t ptn_x = ptn % vsize, rep_x = rep % vsize;
+        size_t addr = (ptn-ptn_x)*block + ptn_x, rep_addr = (rep-rep_x)*block + rep_x;
+        if (float_lh_buffer) {
+            float *lh = (float*)dad_branch->partial_lh;
+            for (i = 0; i < block; i++)
+                lh[addr + i*vsize] = lh[rep_addr + i*vsize];
+            int16_t *lh_exp = (int16_t*)(lh + float_lh_exp_offset);
+            addr = (ptn-ptn_x)*ncat_mix + ptn_x;
+            rep_addr = (rep-rep_x)*ncat_mix + rep_x;
+            for (c = 0; c < ncat_mix; c++)
+                lh_exp[addr + c*vsize] = lh_exp[rep_addr + c*vsize];
+        } else {
+            double *lh = dad_branch->partial_lh;
+            for (i = 0; i < block; i++)
+                lh[addr + i*vsize] = lh[rep_addr + i*vsize];
+        }
+        if (SAFE_NUMERIC) {
+            for (c = 0; c < ncat_mix; c++)
+                dad_branch->scale_num[ptn*ncat_mix + c] = dad_branch->scale_num[rep*ncat_mix + c];
+        } else
+            dad_branch->scale_num[ptn] = dad_branch->scale_num[rep];
+    }
+}
+
+#endif
 
 /*******************************************************
  *
@@ -619,6 +994,9 @@ inline bool PhyloTree::computeTraversalInfo(PhyloNeighbor *dad_branch, PhyloNode
     bool locked[node->degree()];
     memset(locked, 0, node->degree());
 
+    // read evicted partial likelihoods back from the spill file instead of recomputing the subtree
+    bool page_in = mem_slots.needPageIn(dad_branch, dad);
+
     // sort neighbor in desceding size order
     NeighborVec neivec = node->neighbors;
     NeighborVec::iterator it, i2;
@@ -632,13 +1010,15 @@ inline bool PhyloTree::computeTraversalInfo(PhyloNeighbor *dad_branch, PhyloNode
 
 
     // recursive
+    if (!page_in)
     for (it = neivec.begin(); it != neivec.end(); it++)
         if ((*it)->node != dad) {
             locked[it - neivec.begin()] = computeTraversalInfo((PhyloNeighbor*)(*it), node, buffer);
             if ((*it)->node->isLeaf())
                 num_leaves++;
         }
-    dad_branch->partial_lh_computed |= 1;
+    // a recomputed partial likelihood is no longer evicted
+    dad_branch->partial_lh_computed = (dad_branch->partial_lh_computed | 1) & ~LH_EVICTED;
 
     // prepare information for this branch
     TraversalInfo info(dad_branch, dad);
@@ -665,12 +1045,12 @@ inline bool PhyloTree::computeTraversalInfo(PhyloNeighbor *dad_branch, PhyloNode
                 else
                     cout << it->dad_branch->node->id;
                 if (params->lh_mem_save == LM_MEM_SAVE) {
-                    if (it->dad_branch->partial_lh_computed)
+                    if (it->dad_branch->partial_lh_computed & 1)
                         cout << " [";
                     else
                         cout << " (";
                     cout << mem_slots.findNei(it->dad_branch) - mem_slots.begin();
-                    if (it->dad_branch->partial_lh_computed)
+                    if (it->dad_branch->partial_lh_computed & 1)
                         cout << "]";
                     else
                         cout << ")";
@@ -697,6 +1077,13 @@ inline bool PhyloTree::computeTraversalInfo(PhyloNeighbor *dad_branch, PhyloNode
             }
     }
 
+    if (page_in) {
+        // copied by computePartialLikelihood in traversal order, as the slot may still be read before
+        info.page_in = true;
+        traversal_info.push_back(info);
+        return mem_slots.lock(dad_branch);
+    }
+
     if (!model->isSiteSpecificModel()) {
         //------- normal model -----
         info.echildren = buffer;
@@ -872,8 +1259,9 @@ inline void computeBounds(int threads, size_t elements, vector<size_t> &limits)
         rest_elem -= block_size;
     }
 
+    // fewer blocks than threads if there are only few elements
     limits.push_back(elements);
-    assert(limits.size() == threads+1);
+    assert(limits.size() >= 2 && limits.size() <= threads+1);
 }
 #endif
 
@@ -932,6 +1320,15 @@ void PhyloTree::computeTraversalInfo(PhyloNode *node, PhyloNode *dad, bool compu
     if (traversal_info.empty())
         return;
 
+    size_t orig_nptn = ((aln->size()+VectorClass::size()-1)/VectorClass::size())*VectorClass::size();
+    size_t nptn = ((orig_nptn+model_factory->unobserved_ptns.size()+VectorClass::size()-1)/VectorClass::size())*VectorClass::size();
+
+    // repeat classes of the children are always known here as traversal_info is in post-order
+    if (params->lk_site_repeats && !model->isSiteSpecificModel())
+        for (auto it = traversal_info.begin(); it != traversal_info.end(); it++)
+            if (!it->page_in)
+                computeSiteRepeats(*it, orig_nptn, nptn);
+
     if (!model->isSiteSpecificModel()) {
 
         int num_info = traversal_info.size();
@@ -950,12 +1347,12 @@ void PhyloTree::computeTraversalInfo(PhyloNode *node, PhyloNode *dad, bool compu
                 else
                     cout << it->dad_branch->node->id;
                 if (params->lh_mem_save == LM_MEM_SAVE) {
-                    if (it->dad_branch->partial_lh_computed)
+                    if (it->dad_branch->partial_lh_computed & 1)
                         cout << " [";
                     else
                         cout << " (";
                     cout << mem_slots.findNei(it->dad_branch) - mem_slots.begin();
-                    if (it->dad_branch->partial_lh_computed)
+                    if (it->dad_branch->partial_lh_computed & 1)
                         cout << "]";
                     else
                         cout << ")";
@@ -964,38 +1361,33 @@ void PhyloTree::computeTraversalInfo(PhyloNode *node, PhyloNode *dad, bool compu
             cout << endl;
         }
 
-#ifdef _OPENMP
-#pragma omp parallel if (num_info >= 3) num_threads(num_threads)
-        {
-            VectorClass *buffer_tmp = (VectorClass*)buffer + aln->num_states*omp_get_thread_num();
-#pragma omp for schedule(static)
-#else
-            VectorClass *buffer_tmp = (VectorClass*)buffer;
-#endif
-            for (int i = 0; i < num_info; i++) {
+        int num_chunks = (num_info >= 3) ? min(num_info, num_threads) : 1;
+        ThreadPool::getInstance().run(num_chunks, [&](int chunk) {
+            VectorClass *buffer_tmp = (VectorClass*)buffer + aln->num_states*chunk;
+            for (int i = chunk; i < num_info; i += num_chunks) {
+                if (traversal_info[i].page_in)
+                    continue;
             #ifdef KERNEL_FIX_STATES
                 computePartialInfo<VectorClass, nstates>(traversal_info[i], buffer_tmp);
             #else
                 computePartialInfo<VectorClass>(traversal_info[i], buffer_tmp);
             #endif
             }
-#ifdef _OPENMP
-        }
-#endif
+        });
     }
 
     if (compute_partial_lh) {
         vector<size_t> limits;
-        size_t orig_nptn = ((aln->size()+VectorClass::size()-1)/VectorClass::size())*VectorClass::size();
-        size_t nptn = ((orig_nptn+model_factory->unobserved_ptns.size()+VectorClass::size()-1)/VectorClass::size())*VectorClass::size();
         computeBounds<VectorClass>(num_threads, nptn, limits);
 
-        #ifdef _OPENMP
-        #pragma omp parallel for schedule(static, 1) num_threads(num_threads)
-        #endif
-        for (int thread_id = 0; thread_id < num_threads; thread_id++) {
-            for (vector<TraversalInfo>::iterator it = traversal_info.begin(); it != traversal_info.end(); it++)
-                computePartialLikelihood(*it, limits[thread_id], limits[thread_id+1], thread_id);
+        if (useTraversalDAG(nptn)) {
+            // few patterns per thread: also exploit parallelism between independent subtrees
+            computePartialLikelihoodDAG(limits);
+        } else {
+            ThreadPool::getInstance().run(limits.size()-1, [&](int thread_id) {
+                for (vector<TraversalInfo>::iterator it = traversal_info.begin(); it != traversal_info.end(); it++)
+                    computePartialLikelihood(*it, limits[thread_id], limits[thread_id+1], thread_id);
+            });
         }
         traversal_info.clear();
     }
@@ -1061,6 +1453,26 @@ void PhyloTree::computePartialLikelihoodGenericSIMD(TraversalInfo &info, size_t
 //    size_t scale_size = SAFE_NUMERIC ? max_nptn * ncat_mix : max_nptn;
     size_t scale_size = SAFE_NUMERIC ? (ptn_upper-ptn_lower) * ncat_mix : (ptn_upper-ptn_lower);
 
+    if (info.page_in) {
+        // read back from the spill file of memory saving mode, only the patterns of this thread
+        double *spill_lh;
+        UBYTE *spill_scale;
+        mem_slots.getSpillRecord(dad_branch, spill_lh, spill_scale);
+        if (float_lh_buffer) {
+            memcpy((float*)dad_branch->partial_lh + ptn_lower*block, (float*)spill_lh + ptn_lower*block,
+                (ptn_upper-ptn_lower)*block*sizeof(float));
+            memcpy((int16_t*)((float*)dad_branch->partial_lh + float_lh_exp_offset) + ptn_lower*ncat_mix,
+                (int16_t*)((float*)spill_lh + float_lh_exp_offset) + ptn_lower*ncat_mix,
+                (ptn_upper-ptn_lower)*ncat_mix*sizeof(int16_t));
+        } else {
+            memcpy(dad_branch->partial_lh + ptn_lower*block, spill_lh + ptn_lower*block,
+                (ptn_upper-ptn_lower)*block*sizeof(double));
+        }
+        size_t scale_lower = SAFE_NUMERIC ? ptn_lower*ncat_mix : ptn_lower;
+        memcpy(dad_branch->scale_num + scale_lower, spill_scale + scale_lower, scale_size*sizeof(UBYTE));
+        return;
+    }
+
 	double *evec = model->getEigenvectors();
 	double *inv_evec = model->getInverseEigenvectors();
 	assert(inv_evec && evec);
@@ -1077,6 +1489,8 @@ void PhyloTree::computePartialLikelihoodGenericSIMD(TraversalInfo &info, size_t
 
     // precomputed buffer to save times
     double *buffer_partial_lh_ptr = buffer_partial_lh + (getBufferPartialLhSize() - (2*block+nstates)*VectorClass::size()*num_threads);
+    // single-precision storage: dad and children are computed in double on one pattern block at a time
+    double *float_buffer = float_lh_buffer ? float_lh_buffer + 3*block*VectorClass::size()*thread_id : NULL;
     double *echildren = NULL;
     double *partial_lh_leaves = NULL;
 
@@ -1105,6 +1519,16 @@ void PhyloTree::computePartialLikelihoodGenericSIMD(TraversalInfo &info, size_t
 
     double *eleft = echildren, *eright = echildren + block*nstates;
 
+    // patterns repeated within the subtree are computed only once: unique patterns are
+    // gathered into vectors, the repeats are copied from their representatives afterwards
+    int *ptn_repeat = (SITE_MODEL || node->degree() > 3) ? NULL : info.ptn_repeat;
+    double *lane_buffer = float_buffer;
+    if (ptn_repeat && !lane_buffer)
+        lane_buffer = repeat_lh_buffer + 3*block*VectorClass::size()*thread_id;
+    size_t lane_ptn[VectorClass::size()], next_ptn = ptn_lower;
+    UBYTE lane_scale[3*VectorClass::size()*ncat_mix];
+    bool gathered = false;
+
 	if (!left->node->isLeaf() && right->node->isLeaf()) {
 		PhyloNeighbor *tmp = left;
 		left = right;
@@ -1164,7 +1588,9 @@ void PhyloTree::computePartialLikelihoodGenericSIMD(TraversalInfo &info, size_t
                     } else {
                         // internal node
                         VectorClass *partial_lh = partial_lh_all;
-                        VectorClass *partial_lh_child = (VectorClass*)(child->partial_lh + ptn*block);
+                        VectorClass *partial_lh_child = (VectorClass*)(float_buffer ?
+                            loadFloatPartialLh<VectorClass>(child->partial_lh, ptn, ncat_mix, nstates, float_buffer + block*VectorClass::size()) :
+                            child->partial_lh + ptn*block);
                         if (!SAFE_NUMERIC) {
                             for (i = 0; i < VectorClass::size(); i++)
                                 dad_branch->scale_num[ptn+i] += child->scale_num[ptn+i];
@@ -1230,7 +1656,9 @@ void PhyloTree::computePartialLikelihoodGenericSIMD(TraversalInfo &info, size_t
                     } else {
                         // internal node
                         VectorClass *partial_lh = partial_lh_all;
-                        VectorClass *partial_lh_child = (VectorClass*)(child->partial_lh + ptn*block);
+                        VectorClass *partial_lh_child = (VectorClass*)(float_buffer ?
+                            loadFloatPartialLh<VectorClass>(child->partial_lh, ptn, ncat_mix, nstates, float_buffer + block*VectorClass::size()) :
+                            child->partial_lh + ptn*block);
                         if (!SAFE_NUMERIC) {
                             for (i = 0; i < VectorClass::size(); i++)
                                 dad_branch->scale_num[ptn+i] += child->scale_num[ptn+i];
@@ -1263,7 +1691,8 @@ void PhyloTree::computePartialLikelihoodGenericSIMD(TraversalInfo &info, size_t
         
             // compute dot-product with inv_eigenvector
             VectorClass *partial_lh_tmp = partial_lh_all;
-            VectorClass *partial_lh = (VectorClass*)(dad_branch->partial_lh + ptn*block);
+            double *dad_partial_lh = float_buffer ? float_buffer : dad_branch->partial_lh + ptn*block;
+            VectorClass *partial_lh = (VectorClass*)dad_partial_lh;
             VectorClass lh_max = 0.0;
             double *inv_evec_ptr = SITE_MODEL ? &inv_evec[ptn*states_square] : NULL;
             for (c = 0; c < ncat_mix; c++) {
@@ -1286,18 +1715,11 @@ void PhyloTree::computePartialLikelihoodGenericSIMD(TraversalInfo &info, size_t
                 }
                 // check if one should scale partial likelihoods
                 if (SAFE_NUMERIC) {
+                    // BQM 2016-05-03: only scale for non-constant sites
                     auto underflown = ((lh_max < SCALING_THRESHOLD) & (lh_max != 0.0) & (VectorClass().load_a(&ptn_invar[ptn]) == 0.0));
-                    if (horizontal_or(underflown)) { // at least one site has numerical underflown
-                        for (x = 0; x < VectorClass::size(); x++)
-                        if (underflown[x]) {
-                            // BQM 2016-05-03: only scale for non-constant sites
-                            // now do the likelihood scaling
-                            double *partial_lh = dad_branch->partial_lh + (ptn*block + c*nstates*VectorClass::size() + x);
-                            for (i = 0; i < nstates; i++)
-                                partial_lh[i*VectorClass::size()] *= SCALING_THRESHOLD_INVER;
-                            dad_branch->scale_num[(ptn+x)*ncat_mix+c] += 1;
-                        }
-                    }
+                    if (horizontal_or(underflown)) // at least one site has numerical underflown
+                        scaleUnderflownLanes(underflown, (VectorClass*)(dad_partial_lh + c*nstates*VectorClass::size()), nstates,
+                            dad_branch->scale_num + ptn*ncat_mix + c, ncat_mix);
                 }
                 partial_lh += nstates;
                 partial_lh_tmp += nstates;
@@ -1308,7 +1730,7 @@ void PhyloTree::computePartialLikelihoodGenericSIMD(TraversalInfo &info, size_t
                 if (horizontal_or(underflown)) { // at least one site has numerical underflown
                     for (x = 0; x < VectorClass::size(); x++)
                     if (underflown[x]) {
-                        double *partial_lh = dad_branch->partial_lh + (ptn*block + x);
+                        double *partial_lh = dad_partial_lh + x;
                         // now do the likelihood scaling
                         for (i = 0; i < block; i++) {
                             partial_lh[i*VectorClass::size()] *= SCALING_THRESHOLD_INVER;
@@ -1319,6 +1741,9 @@ void PhyloTree::computePartialLikelihoodGenericSIMD(TraversalInfo &info, size_t
                 }
             }
 
+            if (float_buffer)
+                storeFloatPartialLh<VectorClass>(float_buffer, dad_branch->partial_lh, ptn, ncat_mix, nstates);
+
         } // for ptn
 
         // end multifurcating treatment
@@ -1336,8 +1761,10 @@ void PhyloTree::computePartialLikelihoodGenericSIMD(TraversalInfo &info, size_t
         double *vec_right =  SITE_MODEL ? &vec_left[nstates*VectorClass::size()] : &vec_left[block*VectorClass::size()];
         VectorClass *partial_lh_tmp = SITE_MODEL ? (VectorClass*)vec_right+nstates : (VectorClass*)vec_right+block;
 
-		for (ptn = ptn_lower; ptn < ptn_upper; ptn+=VectorClass::size()) {
-			VectorClass *partial_lh = (VectorClass*)(dad_branch->partial_lh + ptn*block);
+		while (nextRepeatPatterns<VectorClass>(ptn_repeat, ptn_lower, ptn_upper, next_ptn, lane_ptn)) {
+            ptn = lane_ptn[0];
+            gathered = (ptn % VectorClass::size() != 0 || lane_ptn[VectorClass::size()-1] != ptn+VectorClass::size()-1);
+			VectorClass *partial_lh = (VectorClass*)((float_buffer || gathered) ? lane_buffer : dad_branch->partial_lh + ptn*block);
 
             if (SITE_MODEL) {
                 VectorClass* expleft = (VectorClass*) vec_left;
@@ -1376,15 +1803,16 @@ void PhyloTree::computePartialLikelihoodGenericSIMD(TraversalInfo &info, size_t
                 // load data for tip
                 for (x = 0; x < VectorClass::size(); x++) {
                     double *tip_left, *tip_right;
-                    if (ptn+x < orig_nptn) {
-                        tip_left  = partial_lh_left  + block * (aln->at(ptn+x))[left->node->id];
-                        tip_right = partial_lh_right + block * (aln->at(ptn+x))[right->node->id];
-                    } else if (ptn+x < max_orig_nptn) {
+                    size_t ptn_x = lane_ptn[x];
+                    if (ptn_x < orig_nptn) {
+                        tip_left  = partial_lh_left  + block * (aln->at(ptn_x))[left->node->id];
+                        tip_right = partial_lh_right + block * (aln->at(ptn_x))[right->node->id];
+                    } else if (ptn_x < max_orig_nptn) {
                         tip_left  = partial_lh_left  + block * aln->STATE_UNKNOWN;
                         tip_right = partial_lh_right + block * aln->STATE_UNKNOWN;
-                    } else if (ptn+x < nptn) {
-                        tip_left  = partial_lh_left  + block * model_factory->unobserved_ptns[ptn+x-max_orig_nptn];
-                        tip_right = partial_lh_right + block * model_factory->unobserved_ptns[ptn+x-max_orig_nptn];
+                    } else if (ptn_x < nptn) {
+                        tip_left  = partial_lh_left  + block * model_factory->unobserved_ptns[ptn_x-max_orig_nptn];
+                        tip_right = partial_lh_right + block * model_factory->unobserved_ptns[ptn_x-max_orig_nptn];
                     } else {
                         tip_left  = partial_lh_left  + block * aln->STATE_UNKNOWN;
                         tip_right = partial_lh_right + block * aln->STATE_UNKNOWN;
@@ -1420,8 +1848,16 @@ void PhyloTree::computePartialLikelihoodGenericSIMD(TraversalInfo &info, size_t
                     partial_lh += nstates;
                 } // FOR category
             } // IF SITE_MODEL
+
+            if (gathered)
+                scatterPartialLh<VectorClass>(lane_buffer, dad_branch->partial_lh, lane_ptn, ncat_mix, nstates);
+            else if (float_buffer)
+                storeFloatPartialLh<VectorClass>(float_buffer, dad_branch->partial_lh, ptn, ncat_mix, nstates);
 		} // FOR LOOP
 
+        if (ptn_repeat)
+            copyRepeatPartialLh<VectorClass, SAFE_NUMERIC>(dad_branch, ptn_repeat, ptn_lower, ptn_upper, ncat_mix, nstates);
+
 
 	} else if (left->node->isLeaf() && !right->node->isLeaf()) {
 
@@ -1439,9 +1875,26 @@ void PhyloTree::computePartialLikelihoodGenericSIMD(TraversalInfo &info, size_t
         double *vec_left = buffer_partial_lh_ptr + (2*block+nstates)*VectorClass::size()*thread_id;
         VectorClass *partial_lh_tmp = SITE_MODEL ? (VectorClass*)vec_left+2*nstates : (VectorClass*)vec_left+block;
 
-		for (ptn = ptn_lower; ptn < ptn_upper; ptn+=VectorClass::size()) {
-			VectorClass *partial_lh = (VectorClass*)(dad_branch->partial_lh + ptn*block);
-			VectorClass *partial_lh_right = (VectorClass*)(right->partial_lh + ptn*block);
+		while (nextRepeatPatterns<VectorClass>(ptn_repeat, ptn_lower, ptn_upper, next_ptn, lane_ptn)) {
+            ptn = lane_ptn[0];
+            gathered = (ptn % VectorClass::size() != 0 || lane_ptn[VectorClass::size()-1] != ptn+VectorClass::size()-1);
+            double *dad_partial_lh = (float_buffer || gathered) ? lane_buffer : dad_branch->partial_lh + ptn*block;
+			VectorClass *partial_lh = (VectorClass*)dad_partial_lh;
+			VectorClass *partial_lh_right;
+            UBYTE *scale_dad = dad_branch->scale_num + (SAFE_NUMERIC ? ptn*ncat_mix : ptn);
+            VectorClass vc_invar;
+            if (gathered) {
+                partial_lh_right = (VectorClass*)gatherPartialLh<VectorClass>(right->partial_lh, lane_ptn, ncat_mix, nstates, lane_buffer + 2*block*VectorClass::size());
+                // scale_num was taken from the right subtree above
+                scale_dad = lane_scale;
+                gatherScaleNum<VectorClass, SAFE_NUMERIC>(right->scale_num, lane_ptn, ncat_mix, scale_dad);
+                vc_invar = gatherVec<VectorClass>(ptn_invar, lane_ptn);
+            } else {
+                partial_lh_right = (VectorClass*)(float_buffer ?
+                    loadFloatPartialLh<VectorClass>(right->partial_lh, ptn, ncat_mix, nstates, float_buffer + 2*block*VectorClass::size()) :
+                    right->partial_lh + ptn*block);
+                vc_invar.load_a(&ptn_invar[ptn]);
+            }
 //            memset(partial_lh, 0, sizeof(VectorClass)*block);
             VectorClass lh_max = 0.0;
 
@@ -1474,18 +1927,11 @@ void PhyloTree::computePartialLikelihoodGenericSIMD(TraversalInfo &info, size_t
 #endif
                     // check if one should scale partial likelihoods
                     if (SAFE_NUMERIC) {
-                        auto underflown = ((lh_max < SCALING_THRESHOLD) & (lh_max != 0.0) & (VectorClass().load_a(&ptn_invar[ptn]) == 0.0));
-                        if (horizontal_or(underflown)) { // at least one site has numerical underflown
-                            for (x = 0; x < VectorClass::size(); x++)
-                            if (underflown[x]) {
-                                // BQM 2016-05-03: only scale for non-constant sites
-                                // now do the likelihood scaling
-                                double *partial_lh = dad_branch->partial_lh + (ptn*block + c*nstates*VectorClass::size() + x);
-                                for (i = 0; i < nstates; i++)
-                                    partial_lh[i*VectorClass::size()] *= SCALING_THRESHOLD_INVER;
-                                dad_branch->scale_num[(ptn+x)*ncat_mix+c] += 1;
-                            }
-                        }
+                        // BQM 2016-05-03: only scale for non-constant sites
+                        auto underflown = ((lh_max < SCALING_THRESHOLD) & (lh_max != 0.0) & (vc_invar == 0.0));
+                        if (horizontal_or(underflown)) // at least one site has numerical underflown
+                            scaleUnderflownLanes(underflown, (VectorClass*)(dad_partial_lh + c*nstates*VectorClass::size()), nstates,
+                                scale_dad + c, ncat_mix);
                     }
                     partial_lh_right += nstates;
                     partial_lh += nstates;
@@ -1496,12 +1942,13 @@ void PhyloTree::computePartialLikelihoodGenericSIMD(TraversalInfo &info, size_t
                 // load data for tip
                 for (x = 0; x < VectorClass::size(); x++) {
                     double *tip;
-                    if (ptn+x < orig_nptn) {
-                        tip = partial_lh_left + block*(aln->at(ptn+x))[left->node->id];
-                    } else if (ptn+x < max_orig_nptn) {
+                    size_t ptn_x = lane_ptn[x];
+                    if (ptn_x < orig_nptn) {
+                        tip = partial_lh_left + block*(aln->at(ptn_x))[left->node->id];
+                    } else if (ptn_x < max_orig_nptn) {
                         tip = partial_lh_left + block*aln->STATE_UNKNOWN;
-                    } else if (ptn+x < nptn) {
-                        tip = partial_lh_left + block*model_factory->unobserved_ptns[ptn+x-max_orig_nptn];
+                    } else if (ptn_x < nptn) {
+                        tip = partial_lh_left + block*model_factory->unobserved_ptns[ptn_x-max_orig_nptn];
                     } else {
                         tip = partial_lh_left + block*aln->STATE_UNKNOWN;
                     }
@@ -1537,18 +1984,11 @@ void PhyloTree::computePartialLikelihoodGenericSIMD(TraversalInfo &info, size_t
     #endif
                     // check if one should scale partial likelihoods
                     if (SAFE_NUMERIC) {
-                        auto underflown = ((lh_max < SCALING_THRESHOLD) & (lh_max != 0.0) & (VectorClass().load_a(&ptn_invar[ptn]) == 0.0));
-                        if (horizontal_or(underflown)) { // at least one site has numerical underflown
-                            for (x = 0; x < VectorClass::size(); x++)
-                            if (underflown[x]) {
-                                // BQM 2016-05-03: only scale for non-constant sites
-                                // now do the likelihood scaling
-                                double *partial_lh = dad_branch->partial_lh + (ptn*block + c*nstates*VectorClass::size() + x);
-                                for (i = 0; i < nstates; i++)
-                                    partial_lh[i*VectorClass::size()] *= SCALING_THRESHOLD_INVER;
-                                dad_branch->scale_num[(ptn+x)*ncat_mix+c] += 1;
-                            }
-                        }
+                        // BQM 2016-05-03: only scale for non-constant sites
+                        auto underflown = ((lh_max < SCALING_THRESHOLD) & (lh_max != 0.0) & (vc_invar == 0.0));
+                        if (horizontal_or(underflown)) // at least one site has numerical underflown
+                            scaleUnderflownLanes(underflown, (VectorClass*)(dad_partial_lh + c*nstates*VectorClass::size()), nstates,
+                                scale_dad + c, ncat_mix);
                     }
                     vleft += nstates;
                     partial_lh_right += nstates;
@@ -1557,36 +1997,69 @@ void PhyloTree::computePartialLikelihoodGenericSIMD(TraversalInfo &info, size_t
             } // IF SITE_MODEL
 
             if (!SAFE_NUMERIC) {
-                auto underflown = (lh_max < SCALING_THRESHOLD) & (lh_max != 0.0) & (VectorClass().load_a(&ptn_invar[ptn]) == 0.0);
+                auto underflown = (lh_max < SCALING_THRESHOLD) & (lh_max != 0.0) & (vc_invar == 0.0);
                 if (horizontal_or(underflown)) { // at least one site has numerical underflown
                     for (x = 0; x < VectorClass::size(); x++)
                     if (underflown[x]) {
-                        double *partial_lh = dad_branch->partial_lh + (ptn*block + x);
+                        double *partial_lh = dad_partial_lh + x;
                         // now do the likelihood scaling
                         for (i = 0; i < block; i++) {
                             partial_lh[i*VectorClass::size()] *= SCALING_THRESHOLD_INVER;
                         }
 //                        sum_scale += LOG_SCALING_THRESHOLD * ptn_freq[ptn+x];
-                        dad_branch->scale_num[ptn+x] += 1;
+                        scale_dad[x] += 1;
                     }
                 }
             }
 
+            if (gathered) {
+                scatterPartialLh<VectorClass>(lane_buffer, dad_branch->partial_lh, lane_ptn, ncat_mix, nstates);
+                scatterScaleNum<VectorClass, SAFE_NUMERIC>(scale_dad, dad_branch->scale_num, lane_ptn, ncat_mix);
+            } else if (float_buffer)
+                storeFloatPartialLh<VectorClass>(float_buffer, dad_branch->partial_lh, ptn, ncat_mix, nstates);
+
 		} // big for loop over ptn
 
+        if (ptn_repeat)
+            copyRepeatPartialLh<VectorClass, SAFE_NUMERIC>(dad_branch, ptn_repeat, ptn_lower, ptn_upper, ncat_mix, nstates);
+
 	} else {
 
         /*--------------------- INTERNAL-INTERNAL NODE case ------------------*/
 
         VectorClass *partial_lh_tmp = (VectorClass*)buffer_partial_lh_ptr + (2*block+nstates)*thread_id;
-		for (ptn = ptn_lower; ptn < ptn_upper; ptn+=VectorClass::size()) {
-			VectorClass *partial_lh = (VectorClass*)(dad_branch->partial_lh + ptn*block);
-			VectorClass *partial_lh_left = (VectorClass*)(left->partial_lh + ptn*block);
-			VectorClass *partial_lh_right = (VectorClass*)(right->partial_lh + ptn*block);
+		while (nextRepeatPatterns<VectorClass>(ptn_repeat, ptn_lower, ptn_upper, next_ptn, lane_ptn)) {
+            ptn = lane_ptn[0];
+            gathered = (ptn % VectorClass::size() != 0 || lane_ptn[VectorClass::size()-1] != ptn+VectorClass::size()-1);
+            double *dad_partial_lh = (float_buffer || gathered) ? lane_buffer : dad_branch->partial_lh + ptn*block;
+			VectorClass *partial_lh = (VectorClass*)dad_partial_lh;
+			VectorClass *partial_lh_left, *partial_lh_right;
+            if (gathered) {
+                partial_lh_left = (VectorClass*)gatherPartialLh<VectorClass>(left->partial_lh, lane_ptn, ncat_mix, nstates, lane_buffer + block*VectorClass::size());
+                partial_lh_right = (VectorClass*)gatherPartialLh<VectorClass>(right->partial_lh, lane_ptn, ncat_mix, nstates, lane_buffer + 2*block*VectorClass::size());
+            } else if (float_buffer) {
+                partial_lh_left = (VectorClass*)loadFloatPartialLh<VectorClass>(left->partial_lh, ptn, ncat_mix, nstates, float_buffer + block*VectorClass::size());
+                partial_lh_right = (VectorClass*)loadFloatPartialLh<VectorClass>(right->partial_lh, ptn, ncat_mix, nstates, float_buffer + 2*block*VectorClass::size());
+            } else {
+                partial_lh_left = (VectorClass*)(left->partial_lh + ptn*block);
+                partial_lh_right = (VectorClass*)(right->partial_lh + ptn*block);
+            }
             VectorClass lh_max = 0.0;
+            VectorClass vc_invar = gathered ? gatherVec<VectorClass>(ptn_invar, lane_ptn) : VectorClass().load_a(&ptn_invar[ptn]);
             UBYTE *scale_dad, *scale_left, *scale_right;
 
-            if (SAFE_NUMERIC) {
+            if (gathered) {
+                size_t scale_block = SAFE_NUMERIC ? VectorClass::size()*ncat_mix : VectorClass::size();
+                scale_dad = lane_scale;
+                scale_left = lane_scale + scale_block;
+                scale_right = lane_scale + 2*scale_block;
+                gatherScaleNum<VectorClass, SAFE_NUMERIC>(left->scale_num, lane_ptn, ncat_mix, scale_left);
+                gatherScaleNum<VectorClass, SAFE_NUMERIC>(right->scale_num, lane_ptn, ncat_mix, scale_right);
+                if (!SAFE_NUMERIC) {
+                    for (i = 0; i < VectorClass::size(); i++)
+                        scale_dad[i] = scale_left[i] + scale_right[i];
+                }
+            } else if (SAFE_NUMERIC) {
                 size_t addr = ptn*ncat_mix;
                 scale_dad = dad_branch->scale_num + addr;
                 scale_left = left->scale_num + addr;
@@ -1660,17 +2133,11 @@ void PhyloTree::computePartialLikelihoodGenericSIMD(TraversalInfo &info, size_t
 
                 // check if one should scale partial likelihoods
                 if (SAFE_NUMERIC) {
-                    auto underflown = ((lh_max < SCALING_THRESHOLD) & (lh_max != 0.0) & (VectorClass().load_a(&ptn_invar[ptn]) == 0.0));
-                    if (horizontal_or(underflown))
-                        for (x = 0; x < VectorClass::size(); x++)
-                        if (underflown[x]) {
-                            // BQM 2016-05-03: only scale for non-constant sites
-                            // now do the likelihood scaling
-                            double *partial_lh = dad_branch->partial_lh + (ptn*block + c*nstates*VectorClass::size() + x);
-                            for (i = 0; i < nstates; i++)
-                                partial_lh[i*VectorClass::size()] *= SCALING_THRESHOLD_INVER;
-                            scale_dad[x*ncat_mix] += 1;
-                        }
+                    // BQM 2016-05-03: only scale for non-constant sites
+                    auto underflown = ((lh_max < SCALING_THRESHOLD) & (lh_max != 0.0) & (vc_invar == 0.0));
+                    if (horizontal_or(underflown)) // at least one site has numerical underflown
+                        scaleUnderflownLanes(underflown, (VectorClass*)(dad_partial_lh + c*nstates*VectorClass::size()), nstates,
+                            scale_dad, ncat_mix);
                     scale_dad++;
                     scale_left++;
                     scale_right++;
@@ -1682,23 +2149,32 @@ void PhyloTree::computePartialLikelihoodGenericSIMD(TraversalInfo &info, size_t
 
             if (!SAFE_NUMERIC) {
                 // check if one should scale partial likelihoods
-                auto underflown = (lh_max < SCALING_THRESHOLD) & (lh_max != 0.0) & (VectorClass().load_a(&ptn_invar[ptn]) == 0.0);
+                auto underflown = (lh_max < SCALING_THRESHOLD) & (lh_max != 0.0) & (vc_invar == 0.0);
                 if (horizontal_or(underflown)) { // at least one site has numerical underflown
                     for (x = 0; x < VectorClass::size(); x++)
                     if (underflown[x]) {
-                        double *partial_lh = dad_branch->partial_lh + (ptn*block + x);
+                        double *partial_lh = dad_partial_lh + x;
                         // now do the likelihood scaling
                         for (i = 0; i < block; i++) {
                             partial_lh[i*VectorClass::size()] *= SCALING_THRESHOLD_INVER;
                         }
 //                        sum_scale += LOG_SCALING_THRESHOLD * ptn_freq[ptn+x];
-                        dad_branch->scale_num[ptn+x] += 1;
+                        scale_dad[x] += 1;
                     }
                 }
             }
 
+            if (gathered) {
+                scatterPartialLh<VectorClass>(lane_buffer, dad_branch->partial_lh, lane_ptn, ncat_mix, nstates);
+                scatterScaleNum<VectorClass, SAFE_NUMERIC>(lane_scale, dad_branch->scale_num, lane_ptn, ncat_mix);
+            } else if (float_buffer)
+                storeFloatPartialLh<VectorClass>(float_buffer, dad_branch->partial_lh, ptn, ncat_mix, nstates);
+
 		} // big for loop over ptn
 
+        if (ptn_repeat)
+            copyRepeatPartialLh<VectorClass, SAFE_NUMERIC>(dad_branch, ptn_repeat, ptn_lower, ptn_upper, ncat_mix, nstates);
+
 	}
 }
 
@@ -1753,8 +2229,12 @@ void PhyloTree::computeLikelihoodBufferGenericSIMD(PhyloNeighbor *dad_branch, Ph
 
         double *vec_tip = buffer_partial_lh_ptr + tip_block*VectorClass::size()*thread_id;
 
+        double *float_buffer = float_lh_buffer ? float_lh_buffer + 3*block*VectorClass::size()*thread_id : NULL;
+
         for (ptn = ptn_lower; ptn < ptn_upper; ptn+=VectorClass::size()) {
-            VectorClass *partial_lh_dad = (VectorClass*)(dad_branch->partial_lh + ptn*block);
+            VectorClass *partial_lh_dad = (VectorClass*)(float_buffer ?
+                loadFloatPartialLh<VectorClass>(dad_branch->partial_lh, ptn, ncat_mix, nstates, float_buffer) :
+                dad_branch->partial_lh + ptn*block);
             VectorClass *theta = (VectorClass*)(theta_all + ptn*block);
             //load tip vector
             if (!SITE_MODEL)
@@ -1826,11 +2306,19 @@ void PhyloTree::computeLikelihoodBufferGenericSIMD(PhyloNeighbor *dad_branch, Ph
     } else {
         //------- both dad and node are internal nodes  --------//
 
+        double *float_buffer = float_lh_buffer ? float_lh_buffer + 3*block*VectorClass::size()*thread_id : NULL;
+
         // now compute theta
         for (ptn = ptn_lower; ptn < ptn_upper; ptn+=VectorClass::size()) {
             VectorClass *theta = (VectorClass*)(theta_all + ptn*block);
-            VectorClass *partial_lh_node = (VectorClass*)(node_branch->partial_lh + ptn*block);
-            VectorClass *partial_lh_dad = (VectorClass*)(dad_branch->partial_lh + ptn*block);
+            VectorClass *partial_lh_node, *partial_lh_dad;
+            if (float_buffer) {
+                partial_lh_node = (VectorClass*)loadFloatPartialLh<VectorClass>(node_branch->partial_lh, ptn, ncat_mix, nstates, float_buffer);
+                partial_lh_dad = (VectorClass*)loadFloatPartialLh<VectorClass>(dad_branch->partial_lh, ptn, ncat_mix, nstates, float_buffer + block*VectorClass::size());
+            } else {
+                partial_lh_node = (VectorClass*)(node_branch->partial_lh + ptn*block);
+                partial_lh_dad = (VectorClass*)(dad_branch->partial_lh + ptn*block);
+            }
             for (i = 0; i < block; i++)
                 theta[i] = partial_lh_node[i] * partial_lh_dad[i];
 
@@ -1940,6 +2428,13 @@ void PhyloTree::computeLikelihoodDervGenericSIMD(PhyloNeighbor *dad_branch, Phyl
     double *buffer_partial_lh_ptr = buffer_partial_lh;
     vector<size_t> limits;
     computeBounds<VectorClass>(num_threads, nptn, limits);
+    TaskReduction<VectorClass> reduction(limits.size()-1, 5);
+
+    if (useTraversalDAG(nptn)) {
+        // few patterns per thread: compute partial likelihoods over independent subtrees beforehand
+        computePartialLikelihoodDAG(limits);
+        traversal_info.clear();
+    }
 
 	assert(theta_all);
 
@@ -2008,10 +2503,8 @@ void PhyloTree::computeLikelihoodDervGenericSIMD(PhyloNeighbor *dad_branch, Phyl
     VectorClass all_df = 0.0, all_ddf = 0.0, all_prob_const = 0.0, all_df_const = 0.0, all_ddf_const = 0.0;
 //    double tree_lh = node_branch->lh_scale_factor + dad_branch->lh_scale_factor;
 
-#ifdef _OPENMP
-#pragma omp parallel for schedule(static, 1) private(ptn, i, c) num_threads(num_threads)
-#endif
-    for (int thread_id = 0; thread_id < num_threads; thread_id++) {
+    ThreadPool::getInstance().run(limits.size()-1, [&](int thread_id) {
+        size_t ptn, i, c;
         VectorClass my_df(0.0), my_ddf(0.0), vc_prob_const(0.0), vc_df_const(0.0), vc_ddf_const(0.0);
         size_t ptn_lower = limits[thread_id];
         size_t ptn_upper = limits[thread_id+1];
@@ -2080,19 +2573,22 @@ void PhyloTree::computeLikelihoodDervGenericSIMD(PhyloNeighbor *dad_branch, Phyl
                 vc_ddf_const += ddf_ptn;
             }
         } // FOR ptn
-    #ifdef _OPENMP
-    #pragma omp critical
-    #endif
-        {
-            all_df += my_df;
-            all_ddf += my_ddf;
-            if (isASC) {
-                all_prob_const += vc_prob_const;
-                all_df_const += vc_df_const;
-                all_ddf_const += vc_ddf_const;
-            }
+        reduction.set(thread_id, 0, my_df);
+        reduction.set(thread_id, 1, my_ddf);
+        if (isASC) {
+            reduction.set(thread_id, 2, vc_prob_const);
+            reduction.set(thread_id, 3, vc_df_const);
+            reduction.set(thread_id, 4, vc_ddf_const);
         }
-    } // FOR thread
+    }); // FOR thread
+
+    all_df = reduction.sum(0);
+    all_ddf = reduction.sum(1);
+    if (isASC) {
+        all_prob_const = reduction.sum(2);
+        all_df_const = reduction.sum(3);
+        all_ddf_const = reduction.sum(4);
+    }
 
     // mark buffer as computed
     theta_computed = true;
@@ -2121,6 +2617,226 @@ void PhyloTree::computeLikelihoodDervGenericSIMD(PhyloNeighbor *dad_branch, Phyl
 
 }
 
+/**
+    number of branch lengths evaluated per pass over theta_all in computeLikelihoodDervMultiSIMD
+*/
+#ifndef KERNEL_FIX_STATES
+const int LH_DERV_MULTI_BATCH = 4;
+#endif
+
+#ifdef KERNEL_FIX_STATES
+template <class VectorClass, const bool SAFE_NUMERIC, const int nstates, const bool FMA, const bool SITE_MODEL>
+void PhyloTree::computeLikelihoodDervMultiSIMD(PhyloNeighbor *dad_branch, PhyloNode *dad, int num_len, double *len, double *lh, double *df, double *ddf)
+#else
+template <class VectorClass, const bool SAFE_NUMERIC, const bool FMA, const bool SITE_MODEL>
+void PhyloTree::computeLikelihoodDervMultiGenericSIMD(PhyloNeighbor *dad_branch, PhyloNode *dad, int num_len, double *len, double *lh, double *df, double *ddf)
+#endif
+{
+    PhyloNode *node = (PhyloNode*) dad_branch->node;
+    PhyloNeighbor *node_branch = (PhyloNeighbor*) node->findNeighbor(dad);
+    if (!central_partial_lh)
+        initializeAllPartialLh();
+    if (node->isLeaf()) {
+    	PhyloNode *tmp_node = dad;
+    	dad = node;
+    	node = tmp_node;
+    	PhyloNeighbor *tmp_nei = dad_branch;
+    	dad_branch = node_branch;
+    	node_branch = tmp_nei;
+    }
+
+#ifdef KERNEL_FIX_STATES
+    computeTraversalInfo<VectorClass, nstates>(node, dad, false);
+#else
+    computeTraversalInfo<VectorClass>(node, dad, false);
+#endif
+
+#ifndef KERNEL_FIX_STATES
+    size_t nstates = aln->num_states;
+#endif
+    size_t ncat = site_rate->getNRate();
+    size_t ncat_mix = (model_factory->fused_mix_rate) ? ncat : ncat*model->getNMixtures();
+
+    size_t block = ncat_mix * nstates;
+    size_t c, i;
+    int k;
+    size_t orig_nptn = aln->size();
+    size_t max_orig_nptn = ((orig_nptn+VectorClass::size()-1)/VectorClass::size())*VectorClass::size();
+    size_t nptn = max_orig_nptn+model_factory->unobserved_ptns.size();
+    bool isASC = model_factory->unobserved_ptns.size() > 0;
+    size_t denom = (model_factory->fused_mix_rate) ? 1 : ncat;
+
+    double *eval = model->getEigenvalues();
+    assert(eval);
+	assert(theta_all);
+
+    // val0, val1, val2 of each branch length as in computeLikelihoodDervSIMD
+    vector<double> vals;
+    double cat_rate[ncat];
+    double cat_prop[ncat];
+    if (SITE_MODEL) {
+        for (c = 0; c < ncat; c++) {
+            cat_rate[c] = site_rate->getRate(c);
+            cat_prop[c] = site_rate->getProp(c);
+        }
+    } else {
+        vals.resize(3*block*num_len);
+        for (k = 0; k < num_len; k++) {
+            double *val0 = &vals[3*block*k], *val1 = val0 + block, *val2 = val1 + block;
+            for (c = 0; c < ncat_mix; c++) {
+                size_t m = c/denom;
+                double *eval_ptr = eval + m*nstates;
+                size_t mycat = c%ncat;
+                double prop = site_rate->getProp(mycat) * model->getMixtureWeight(m);
+                size_t addr = c*nstates;
+                for (i = 0; i < nstates; i++) {
+                    double cof = eval_ptr[i]*site_rate->getRate(mycat);
+                    double val = exp(cof*len[k]) * prop;
+                    double val1_ = cof*val;
+                    val0[addr+i] = val;
+                    val1[addr+i] = val1_;
+                    val2[addr+i] = cof*val1_;
+                }
+            }
+        }
+    }
+
+    vector<double> all_lh(num_len, 0.0), all_df(num_len, 0.0), all_ddf(num_len, 0.0);
+    vector<double> all_prob_const(num_len, 0.0), all_df_const(num_len, 0.0), all_ddf_const(num_len, 0.0);
+
+    vector<size_t> limits;
+    computeBounds<VectorClass>(num_threads, nptn, limits);
+    TaskReduction<VectorClass> reduction(limits.size()-1, 6*num_len);
+
+    if (useTraversalDAG(nptn)) {
+        // few patterns per thread: compute partial likelihoods over independent subtrees beforehand
+        computePartialLikelihoodDAG(limits);
+        traversal_info.clear();
+    }
+
+    ThreadPool::getInstance().run(limits.size()-1, [&](int thread_id) {
+        size_t ptn, i, c;
+        int k, j;
+        size_t ptn_lower = limits[thread_id];
+        size_t ptn_upper = limits[thread_id+1];
+
+        if (!theta_computed)
+        #ifdef KERNEL_FIX_STATES
+            computeLikelihoodBufferSIMD<VectorClass, SAFE_NUMERIC, nstates, FMA, SITE_MODEL>(dad_branch, dad, ptn_lower, ptn_upper, thread_id);
+        #else
+            computeLikelihoodBufferGenericSIMD<VectorClass, SAFE_NUMERIC, FMA, SITE_MODEL>(dad_branch, dad, ptn_lower, ptn_upper, thread_id);
+        #endif
+
+        // each theta block is loaded once for a batch of branch lengths
+        for (k = 0; k < num_len; k += LH_DERV_MULTI_BATCH) {
+            int batch = min(LH_DERV_MULTI_BATCH, num_len-k);
+            VectorClass my_lh[LH_DERV_MULTI_BATCH], my_df[LH_DERV_MULTI_BATCH], my_ddf[LH_DERV_MULTI_BATCH];
+            VectorClass vc_prob_const[LH_DERV_MULTI_BATCH], vc_df_const[LH_DERV_MULTI_BATCH], vc_ddf_const[LH_DERV_MULTI_BATCH];
+            for (j = 0; j < batch; j++)
+                my_lh[j] = my_df[j] = my_ddf[j] = vc_prob_const[j] = vc_df_const[j] = vc_ddf_const[j] = 0.0;
+
+            for (ptn = ptn_lower; ptn < ptn_upper; ptn+=VectorClass::size()) {
+                VectorClass vc_invar = VectorClass().load_a(&ptn_invar[ptn]);
+                for (j = 0; j < batch; j++) {
+                    VectorClass *theta = (VectorClass*)(theta_all + ptn*block);
+                    VectorClass lh_ptn, df_ptn, ddf_ptn;
+                    if (SITE_MODEL) {
+                        VectorClass* eval_ptr = (VectorClass*) &eval[ptn*nstates];
+                        lh_ptn = 0.0; df_ptn = 0.0; ddf_ptn = 0.0;
+                        for (c = 0; c < ncat; c++) {
+                            VectorClass lh_cat(0.0), df_cat(0.0), ddf_cat(0.0);
+                            for (i = 0; i < nstates; i++) {
+                                VectorClass cof = eval_ptr[i] * cat_rate[c];
+                                VectorClass val = exp(cof*len[k+j])*theta[i];
+                                VectorClass val1 = cof*val;
+                                lh_cat += val;
+                                df_cat += val1;
+                                ddf_cat = mul_add(cof, val1, ddf_cat);
+                            }
+                            lh_ptn = mul_add(cat_prop[c], lh_cat, lh_ptn);
+                            df_ptn = mul_add(cat_prop[c], df_cat, df_ptn);
+                            ddf_ptn = mul_add(cat_prop[c], ddf_cat, ddf_ptn);
+                            theta += nstates;
+                        }
+                    } else {
+                        double *val0 = &vals[3*block*(k+j)];
+                #ifdef KERNEL_FIX_STATES
+                        dotProductTriple<VectorClass, double, nstates, FMA>(val0, val0+block, val0+2*block, theta, lh_ptn, df_ptn, ddf_ptn, block);
+                #else
+                        dotProductTriple<VectorClass, double, FMA>(val0, val0+block, val0+2*block, theta, lh_ptn, df_ptn, ddf_ptn, block, nstates);
+                #endif
+                    }
+                    lh_ptn = abs(lh_ptn + vc_invar);
+
+                    if (ptn < orig_nptn) {
+                        VectorClass freq = VectorClass().load_a(&ptn_freq[ptn]);
+                        my_lh[j] = mul_add(log(lh_ptn) + VectorClass().load_a(&buffer_scale_all[ptn]), freq, my_lh[j]);
+                        lh_ptn = 1.0 / lh_ptn;
+                        VectorClass df_frac = df_ptn * lh_ptn;
+                        VectorClass ddf_frac = ddf_ptn * lh_ptn;
+                        VectorClass tmp1 = df_frac * freq;
+                        VectorClass tmp2 = ddf_frac * freq;
+                        my_df[j] += tmp1;
+                        my_ddf[j] += nmul_add(tmp1, df_frac, tmp2);
+                    } else {
+                        // ascertainment bias correction
+                        if (ptn+VectorClass::size() > nptn) {
+                            // cutoff the last entries if going beyond
+                            lh_ptn.cutoff(nptn-ptn);
+                            df_ptn.cutoff(nptn-ptn);
+                            ddf_ptn.cutoff(nptn-ptn);
+                        }
+                        vc_prob_const[j] += lh_ptn;
+                        vc_df_const[j] += df_ptn;
+                        vc_ddf_const[j] += ddf_ptn;
+                    }
+                }
+            } // FOR ptn
+
+            for (j = 0; j < batch; j++) {
+                reduction.set(thread_id, k+j, my_lh[j]);
+                reduction.set(thread_id, num_len+k+j, my_df[j]);
+                reduction.set(thread_id, 2*num_len+k+j, my_ddf[j]);
+                if (isASC) {
+                    reduction.set(thread_id, 3*num_len+k+j, vc_prob_const[j]);
+                    reduction.set(thread_id, 4*num_len+k+j, vc_df_const[j]);
+                    reduction.set(thread_id, 5*num_len+k+j, vc_ddf_const[j]);
+                }
+            }
+        }
+    }); // FOR thread
+
+    // mark buffer as computed
+    theta_computed = true;
+
+    for (k = 0; k < num_len; k++) {
+        all_lh[k] = horizontal_add(reduction.sum(k));
+        all_df[k] = horizontal_add(reduction.sum(num_len+k));
+        all_ddf[k] = horizontal_add(reduction.sum(2*num_len+k));
+        if (isASC) {
+            all_prob_const[k] = horizontal_add(reduction.sum(3*num_len+k));
+            all_df_const[k] = horizontal_add(reduction.sum(4*num_len+k));
+            all_ddf_const[k] = horizontal_add(reduction.sum(5*num_len+k));
+        }
+        if (!SAFE_NUMERIC && (std::isnan(all_lh[k]) || std::isinf(all_lh[k]) || std::isnan(all_df[k]) || std::isinf(all_df[k])))
+            outError("Numerical underflow (lh-derivative). Run again with the safe likelihood kernel via `-safe` option");
+        assert(!std::isnan(all_df[k]) && !std::isinf(all_df[k]) && "Numerical underflow for lh-derivative");
+        lh[k] = all_lh[k];
+        df[k] = all_df[k];
+        ddf[k] = all_ddf[k];
+        if (isASC) {
+            // ascertainment bias correction
+            double prob_const = 1.0 - all_prob_const[k];
+            double df_frac = all_df_const[k] / prob_const;
+            double ddf_frac = all_ddf_const[k] / prob_const;
+            int nsites = aln->getNSite();
+            lh[k] -= nsites * log(prob_const);
+            df[k] += nsites * df_frac;
+            ddf[k] += nsites *(ddf_frac + df_frac*df_frac);
+        }
+    }
+}
+
 
 
 
@@ -2234,6 +2950,13 @@ double PhyloTree::computeLikelihoodBranchGenericSIMD(PhyloNeighbor *dad_branch,
 
     vector<size_t> limits;
     computeBounds<VectorClass>(num_threads, nptn, limits);
+    TaskReduction<VectorClass> reduction(limits.size()-1, 2);
+
+    if (useTraversalDAG(nptn)) {
+        // few patterns per thread: compute partial likelihoods over independent subtrees beforehand
+        computePartialLikelihoodDAG(limits);
+        traversal_info.clear();
+    }
 
     if (dad->isLeaf()) {
     	// special treatment for TIP-INTERNAL NODE case
@@ -2284,10 +3007,8 @@ double PhyloTree::computeLikelihoodBranchGenericSIMD(PhyloNeighbor *dad_branch,
         }
 
     	// now do the real computation
-#ifdef _OPENMP
-#pragma omp parallel for private(ptn, i, c) schedule(static, 1) num_threads(num_threads)
-#endif
-        for (int thread_id = 0; thread_id < num_threads; thread_id++) {
+        ThreadPool::getInstance().run(limits.size()-1, [&](int thread_id) {
+            size_t ptn, i, c;
 
             VectorClass vc_tree_lh(0.0), vc_prob_const(0.0);
 
@@ -2302,12 +3023,15 @@ double PhyloTree::computeLikelihoodBranchGenericSIMD(PhyloNeighbor *dad_branch,
                 computePartialLikelihood(*it, ptn_lower, ptn_upper, thread_id);
 
             double *vec_tip = buffer_partial_lh_ptr + block*VectorClass::size()*thread_id;
+            double *float_buffer = float_lh_buffer ? float_lh_buffer + 3*block*VectorClass::size()*thread_id : NULL;
 
             for (ptn = ptn_lower; ptn < ptn_upper; ptn+=VectorClass::size()) {
                 VectorClass lh_ptn;
                 lh_ptn.load_a(&ptn_invar[ptn]);
                 VectorClass *lh_cat = (VectorClass*)(_pattern_lh_cat + ptn*ncat_mix);
-                VectorClass *partial_lh_dad = (VectorClass*)(dad_branch->partial_lh + ptn*block);
+                VectorClass *partial_lh_dad = (VectorClass*)(float_buffer ?
+                    loadFloatPartialLh<VectorClass>(dad_branch->partial_lh, ptn, ncat_mix, nstates, float_buffer) :
+                    dad_branch->partial_lh + ptn*block);
                 VectorClass *lh_node = SITE_MODEL ? (VectorClass*)&partial_lh_node[ptn*nstates] : (VectorClass*)vec_tip;
 
                 if (SITE_MODEL) {
@@ -2418,25 +3142,18 @@ double PhyloTree::computeLikelihoodBranchGenericSIMD(PhyloNeighbor *dad_branch,
                     vc_prob_const += lh_ptn;
                 }
             } // FOR PTN
-#ifdef _OPENMP
-#pragma omp critical
-#endif
-            {
-                all_tree_lh += vc_tree_lh;
-                if (isASC)
-                    all_prob_const += vc_prob_const;
-            }
-        } // FOR thread
+            reduction.set(thread_id, 0, vc_tree_lh);
+            if (isASC)
+                reduction.set(thread_id, 1, vc_prob_const);
+        }); // FOR thread
 
     } else {
 
 //        assert(0 && "Don't compute tree log-likelihood from internal branch!");
     	//-------- both dad and node are internal nodes -----------/
 
-#ifdef _OPENMP
-#pragma omp parallel for private(ptn, i, c) schedule(static, 1) num_threads(num_threads)
-#endif
-        for (int thread_id = 0; thread_id < num_threads; thread_id++) {
+        ThreadPool::getInstance().run(limits.size()-1, [&](int thread_id) {
+            size_t ptn, i, c;
 
             size_t ptn_lower = limits[thread_id];
             size_t ptn_upper = limits[thread_id+1];
@@ -2450,12 +3167,20 @@ double PhyloTree::computeLikelihoodBranchGenericSIMD(PhyloNeighbor *dad_branch,
             for (vector<TraversalInfo>::iterator it = traversal_info.begin(); it != traversal_info.end(); it++)
                 computePartialLikelihood(*it, ptn_lower, ptn_upper, thread_id);
 
+            double *float_buffer = float_lh_buffer ? float_lh_buffer + 3*block*VectorClass::size()*thread_id : NULL;
+
             for (ptn = ptn_lower; ptn < ptn_upper; ptn+=VectorClass::size()) {
                 VectorClass lh_ptn;
                 lh_ptn.load_a(&ptn_invar[ptn]);
                 VectorClass *lh_cat = (VectorClass*)(_pattern_lh_cat + ptn*ncat_mix);
-                VectorClass *partial_lh_dad = (VectorClass*)(dad_branch->partial_lh + ptn*block);
-                VectorClass *partial_lh_node = (VectorClass*)(node_branch->partial_lh + ptn*block);
+                VectorClass *partial_lh_dad, *partial_lh_node;
+                if (float_buffer) {
+                    partial_lh_dad = (VectorClass*)loadFloatPartialLh<VectorClass>(dad_branch->partial_lh, ptn, ncat_mix, nstates, float_buffer);
+                    partial_lh_node = (VectorClass*)loadFloatPartialLh<VectorClass>(node_branch->partial_lh, ptn, ncat_mix, nstates, float_buffer + block*VectorClass::size());
+                } else {
+                    partial_lh_dad = (VectorClass*)(dad_branch->partial_lh + ptn*block);
+                    partial_lh_node = (VectorClass*)(node_branch->partial_lh + ptn*block);
+                }
 
                 // compute likelihood per category
                 if (SITE_MODEL) {
@@ -2549,17 +3274,14 @@ double PhyloTree::computeLikelihoodBranchGenericSIMD(PhyloNeighbor *dad_branch,
                     vc_prob_const += lh_ptn;
                 }
             } // FOR LOOP ptn
-#ifdef _OPENMP
-#pragma omp critical
-#endif
-            {
-                all_tree_lh += vc_tree_lh;
-                if (isASC)
-                    all_prob_const += vc_prob_const;
-            }
-        } // FOR thread
+            reduction.set(thread_id, 0, vc_tree_lh);
+            if (isASC)
+                reduction.set(thread_id, 1, vc_prob_const);
+        }); // FOR thread
     } // else
 
+    all_tree_lh = reduction.sum(0);
+    all_prob_const = reduction.sum(1);
     tree_lh += horizontal_add(all_tree_lh);
 
     if (!SAFE_NUMERIC && (std::isnan(tree_lh) || std::isinf(tree_lh)))
@@ -2684,15 +3406,14 @@ double PhyloTree::computeLikelihoodFromBufferGenericSIMD()
 
     VectorClass all_tree_lh(0.0), all_prob_const(0.0);
 
-#ifdef _OPENMP
-#pragma omp parallel private(ptn, i, c) num_threads(num_threads)
-    {
-#endif
+    vector<size_t> limits;
+    computeBounds<VectorClass>(num_threads, nptn, limits);
+    TaskReduction<VectorClass> reduction(limits.size()-1, 2);
+
+    ThreadPool::getInstance().run(limits.size()-1, [&](int thread_id) {
+        size_t ptn, c;
         VectorClass vc_tree_lh(0.0), vc_prob_const(0.0);
-#ifdef _OPENMP
-#pragma omp for schedule(static) nowait
-#endif
-    for (ptn = 0; ptn < nptn; ptn+=VectorClass::size()) {
+    for (ptn = limits[thread_id]; ptn < limits[thread_id+1]; ptn+=VectorClass::size()) {
 		VectorClass lh_ptn;
 		VectorClass *theta = (VectorClass*)(theta_all + ptn*block);
         if (SITE_MODEL) {
@@ -2730,18 +3451,13 @@ double PhyloTree::computeLikelihoodFromBufferGenericSIMD()
             vc_prob_const += lh_ptn;
         }
     }
-#ifdef _OPENMP
-#pragma omp critical
-        {
-            all_tree_lh += vc_tree_lh;
-            if (isASC)
-                all_prob_const += vc_prob_const;
-        }
-    }
-#else
-    all_tree_lh = vc_tree_lh;
-    all_prob_const = vc_prob_const;
-#endif
+        reduction.set(thread_id, 0, vc_tree_lh);
+        if (isASC)
+            reduction.set(thread_id, 1, vc_prob_const);
+    });
+
+    all_tree_lh = reduction.sum(0);
+    all_prob_const = reduction.sum(1);
 
     double tree_lh = horizontal_add(all_tree_lh);
 
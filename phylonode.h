@@ -16,6 +16,31 @@
 
 typedef unsigned short UBYTE;
 
+class PhyloNeighbor;
+
+/**
+    Patterns with identical states at all leaves of a subtree (and the same invariant status)
+    have identical partial likelihoods and form a repeat class, see PhyloTree::computeSiteRepeats()
+*/
+struct SiteRepeats {
+    /** class of each pattern, empty if (almost) all patterns are different */
+    vector<int> ptn_class;
+
+    /** first pattern of the class of each pattern (repeat representative) */
+    vector<int> ptn_repeat;
+
+    /** number of classes */
+    int num_class;
+
+    /** renewed whenever the classes are recomputed (0: not yet computed) */
+    int stamp;
+
+    /** children with their stamps (leaf: -1-id) from which the classes were computed */
+    vector<pair<PhyloNeighbor*, int> > children;
+
+    SiteRepeats() : num_class(0), stamp(0) {}
+};
+
 /**
 A neighbor in a phylogenetic tree
 
@@ -137,6 +162,9 @@ private:
     /** size of subtree below this neighbor in terms of number of taxa */
     int size;
 
+    /** repeat classes of patterns in the subtree below */
+    SiteRepeats site_repeats;
+
 };
 
 /**
@@ -550,11 +550,8 @@ PhyloSuperTree::PhyloSuperTree(Params &params) :  IQTree() {
 	cout << "Degree of missing data: " << ((SuperAlignment*)aln)->computeMissingData() << endl;
     
 #ifdef _OPENMP
-    if (params.num_threads > size()) {
-        cout << "Info: multi-threading strategy over alignment sites" << endl;
-    } else {
-        cout << "Info: multi-threading strategy over partitions" << endl;
-    }
+    if (params.num_threads > 1)
+        cout << "Info: multi-threading strategy over partitions and alignment sites" << endl;
 #endif
 	cout << endl;
 
@@ -569,19 +566,20 @@ void PhyloSuperTree::setParams(Params* params) {
 
 void PhyloSuperTree::initSettings(Params &params) {
 	IQTree::initSettings(params);
-    num_threads = (size() >= params.num_threads) ? params.num_threads : 1;
+    // partitions and their pattern blocks share the threads of the pool
+    num_threads = params.num_threads;
 	for (iterator it = begin(); it != end(); it++) {
 		(*it)->params = &params;
-		(*it)->setLikelihoodKernel(params.SSE, (size() >= params.num_threads) ? 1 : params.num_threads);
+		(*it)->setLikelihoodKernel(params.SSE, params.num_threads);
 		(*it)->optimize_by_newton = params.optimize_by_newton;
 	}
 
 }
 
 void PhyloSuperTree::setLikelihoodKernel(LikelihoodKernel lk, int num_threads) {
-    PhyloTree::setLikelihoodKernel(lk, (size() >= num_threads) ? num_threads : 1);
+    PhyloTree::setLikelihoodKernel(lk, num_threads);
     for (iterator it = begin(); it != end(); it++)
-        (*it)->setLikelihoodKernel(lk, (size() >= num_threads) ? 1 : num_threads);
+        (*it)->setLikelihoodKernel(lk, num_threads);
 }
 
 void PhyloSuperTree::changeLikelihoodKernel(LikelihoodKernel lk) {
@@ -956,14 +954,12 @@ double PhyloSuperTree::computeLikelihood(double *pattern_lh) {
 		}
 	} else {
         if (part_order.empty()) computePartitionOrder();
-		#ifdef _OPENMP
-		#pragma omp parallel for reduction(+: tree_lh) schedule(dynamic) if(num_threads > 1)
-		#endif
-		for (int j = 0; j < ntrees; j++) {
+		ThreadPool::getInstance().run(ntrees, [&](int j) {
             int i = part_order[j];
 			part_info[i].cur_score = at(i)->computeLikelihood();
+		});
+		for (int i = 0; i < ntrees; i++)
 			tree_lh += part_info[i].cur_score;
-		}
 	}
 	return tree_lh;
 }
@@ -1017,16 +1013,14 @@ double PhyloSuperTree::optimizeAllBranches(int my_iterations, double tolerance,
 	double tree_lh = 0.0;
 	int ntrees = size();
     if (part_order.empty()) computePartitionOrder();
-	#ifdef _OPENMP
-	#pragma omp parallel for reduction(+: tree_lh) schedule(dynamic) if(num_threads > 1)
-	#endif
-	for (int j = 0; j < ntrees; j++) {
+	ThreadPool::getInstance().run(ntrees, [&](int j) {
         int i = part_order[j];
 		part_info[i].cur_score = at(i)->optimizeAllBranches(my_iterations, tolerance/min(ntrees,10), maxNRStep);
-		tree_lh += part_info[i].cur_score;
 		if (verbose_mode >= VB_MAX)
 			at(i)->printTree(cout, WT_BR_LEN + WT_NEWLINE);
-	}
+	});
+	for (int i = 0; i < ntrees; i++)
+		tree_lh += part_info[i].cur_score;
 
 	if (my_iterations >= 100) computeBranchLengths();
 	return tree_lh;
@@ -1137,16 +1131,14 @@ NNIMove PhyloSuperTree::getBestNNIForBran(PhyloNode *node1, PhyloNode *node2, NN
 
 	int ntrees = size(), part;
 	double nni_score1 = 0.0, nni_score2 = 0.0;
-	int local_totalNNIs = 0, local_evalNNIs = 0;
+	int local_totalNNIs = ntrees, local_evalNNIs = 0;
+	DoubleVector part_score1(ntrees, 0.0), part_score2(ntrees, 0.0);
+	IntVector part_eval(ntrees, 0);
 
     if (part_order.empty()) computePartitionOrder();
-	#ifdef _OPENMP
-	#pragma omp parallel for reduction(+: nni_score1, nni_score2, local_totalNNIs, local_evalNNIs) private(part) schedule(dynamic) if(num_threads>1)
-	#endif
-	for (int treeid = 0; treeid < ntrees; treeid++) {
-        part = part_order_by_nptn[treeid];
+	ThreadPool::getInstance().run(ntrees, [&](int treeid) {
+        int part = part_order_by_nptn[treeid];
 		bool is_nni = true;
-		local_totalNNIs++;
 		FOR_NEIGHBOR_DECLARE(node1, NULL, nit) {
 			if (! ((SuperNeighbor*)*nit)->link_neighbors[part]) { is_nni = false; break; }
 		}
@@ -1159,12 +1151,12 @@ NNIMove PhyloSuperTree::getBestNNIForBran(PhyloNode *node1, PhyloNode *node2, NN
 				if (save_all_trees == 2 || nniMoves)
 					at(part)->computePatternLikelihood(part_info[part].cur_ptnlh, &part_info[part].cur_score);
 			}
-			nni_score1 += part_info[part].cur_score;
-			nni_score2 += part_info[part].cur_score;
-			continue;
+			part_score1[part] = part_info[part].cur_score;
+			part_score2[part] = part_info[part].cur_score;
+			return;
 		}
 
-		local_evalNNIs++;
+		part_eval[part] = 1;
 		part_info[part].evalNNIs++;
 
 		PhyloNeighbor *nei1_part = nei1->link_neighbors[part];
@@ -1198,8 +1190,8 @@ NNIMove PhyloSuperTree::getBestNNIForBran(PhyloNode *node1, PhyloNode *node2, NN
 			part_info[part].nniMoves[0] = part_info[part].nniMoves[1];
 			part_info[part].nniMoves[1] = tmp;
 		}
-		nni_score1 += part_info[part].nniMoves[0].newloglh;
-		nni_score2 += part_info[part].nniMoves[1].newloglh;
+		part_score1[part] = part_info[part].nniMoves[0].newloglh;
+		part_score2[part] = part_info[part].nniMoves[1].newloglh;
 		int numlen = 1;
 		if (params->nni5) numlen = 5;
 		for (int i = 0; i < numlen; i++) {
@@ -1207,6 +1199,12 @@ NNIMove PhyloSuperTree::getBestNNIForBran(PhyloNode *node1, PhyloNode *node2, NN
 			part_info[part].nni2_brlen[brid*numlen + i] = part_info[part].nniMoves[1].newLen[i];
 		}
 
+	});
+	for (part = 0; part < ntrees; part++) {
+		nni_score1 += part_score1[part];
+		nni_score2 += part_score2[part];
+		if (part_eval[part])
+			local_evalNNIs++;
 	}
 	totalNNIs += local_totalNNIs;
 	evalNNIs += local_evalNNIs;
@@ -128,16 +128,12 @@ double PartitionModelPlen::optimizeParameters(int fixed_len, bool write_info, do
     for(i = 1; i < tree->params->num_param_iterations; i++){
     	cur_lh = 0.0;
         if (tree->part_order.empty()) tree->computePartitionOrder();
-        #ifdef _OPENMP
-        #pragma omp parallel for reduction(+: cur_lh) schedule(dynamic) if(tree->num_threads > 1)
-        #endif
-    	for (int partid = 0; partid < ntrees; partid++) {
+    	ThreadPool::getInstance().run(ntrees, [&](int partid) {
             int part = tree->part_order[partid];
     		// Subtree model parameters optimization
         	tree->part_info[part].cur_score = tree->at(part)->getModelFactory()->optimizeParametersOnly(gradient_epsilon/min(min(i,ntrees),10));
             if (tree->part_info[part].cur_score == 0.0)
                 tree->part_info[part].cur_score = tree->at(part)->computeLikelihood();
-        	cur_lh += tree->part_info[part].cur_score;
             
 
         	// normalize rates s.t. branch lengths are #subst per site
@@ -150,7 +146,9 @@ double PartitionModelPlen::optimizeParameters(int fixed_len, bool write_info, do
         		tree->part_info[part].part_rate *= mean_rate;
         	}
 
-    	}
+    	});
+    	for (int part = 0; part < ntrees; part++)
+    		cur_lh += tree->part_info[part].cur_score;
         if (tree->params->link_alpha) {
             cur_lh = optimizeLinkedAlpha(write_info, gradient_epsilon);
         }
@@ -239,10 +237,7 @@ double PartitionModelPlen::optimizeGeneRate(double gradient_epsilon)
 
     if (tree->part_order.empty()) tree->computePartitionOrder();
 
-    #ifdef _OPENMP
-    #pragma omp parallel for reduction(+: score) private(i) schedule(dynamic) if(tree->num_threads > 1)
-    #endif    
-    for (int j = 0; j < tree->size(); j++) {
+    ThreadPool::getInstance().run(tree->size(), [&](int j) {
         int i = tree->part_order[j];
         double min_scaling = 1.0/tree->at(i)->getAlnNSite();
         double max_scaling = nsites / tree->at(i)->getAlnNSite();
@@ -251,8 +246,9 @@ double PartitionModelPlen::optimizeGeneRate(double gradient_epsilon)
         if (min_scaling > tree->part_info[i].part_rate)
             min_scaling = tree->part_info[i].part_rate;
         tree->part_info[i].cur_score = tree->at(i)->optimizeTreeLengthScaling(min_scaling, tree->part_info[i].part_rate, max_scaling, gradient_epsilon);
+    });
+    for (i = 0; i < tree->size(); i++)
         score += tree->part_info[i].cur_score;
-    }
     // now normalize the rates
     double sum = 0.0;
     size_t nsite = 0;
@@ -350,6 +346,9 @@ void PhyloSuperTreePlen::deleteAllPartialLh() {
 		(*it)->ptn_invar = NULL;
         (*it)->nni_partial_lh = NULL;
         (*it)->nni_scale_num = NULL;
+        if ((*it)->repeat_lh_buffer)
+            aligned_free((*it)->repeat_lh_buffer);
+        (*it)->repeat_lh_buffer = NULL;
 	}
     PhyloTree::deleteAllPartialLh();
 }
@@ -475,15 +474,12 @@ void PhyloSuperTreePlen::optimizeOneBranch(PhyloNode *node1, PhyloNode *node2, b
 
     if (part_order.empty()) computePartitionOrder();
 	// bug fix: assign cur_score into part_info
-    #ifdef _OPENMP
-    #pragma omp parallel for private(part) schedule(dynamic) if(num_threads > 1)
-    #endif    
-	for (int partid = 0; partid < size(); partid++) {
-        part = part_order_by_nptn[partid];
+	ThreadPool::getInstance().run(size(), [&](int partid) {
+        int part = part_order_by_nptn[partid];
 		if (((SuperNeighbor*)current_it)->link_neighbors[part]) {
 			part_info[part].cur_score = at(part)->computeLikelihoodFromBuffer();
 		}
-	}
+	});
 
 	if(clearLH && current_len != current_it->length){
 		for (int part = 0; part < size(); part++) {
@@ -515,10 +511,7 @@ double PhyloSuperTreePlen::computeFunction(double value) {
 	assert(nei1 && nei2);
 
     if (part_order.empty()) computePartitionOrder();
-    #ifdef _OPENMP
-    #pragma omp parallel for reduction(+: tree_lh) schedule(dynamic) if(num_threads > 1)
-    #endif    
-	for (int partid = 0; partid < ntrees; partid++) {
+	ThreadPool::getInstance().run(ntrees, [&](int partid) {
             int part = part_order_by_nptn[partid];
 			PhyloNeighbor *nei1_part = nei1->link_neighbors[part];
 			PhyloNeighbor *nei2_part = nei2->link_neighbors[part];
@@ -528,13 +521,13 @@ double PhyloSuperTreePlen::computeFunction(double value) {
 				nei1_part->length += lambda*part_info[part].part_rate;
 				nei2_part->length += lambda*part_info[part].part_rate;
 				part_info[part].cur_score = at(part)->computeLikelihoodBranch(nei2_part,(PhyloNode*)nei1_part->node);
-				tree_lh += part_info[part].cur_score;
 			} else {
 				if (part_info[part].cur_score == 0.0)
 					part_info[part].cur_score = at(part)->computeLikelihood();
-				tree_lh += part_info[part].cur_score;
 			}
-		}
+		});
+	for (int part = 0; part < ntrees; part++)
+		tree_lh += part_info[part].cur_score;
     return -tree_lh;
 }
 
@@ -573,10 +566,8 @@ void PhyloSuperTreePlen::computeFuncDerv(double value, double &df_ret, double &d
 	assert(nei1 && nei2);
 
     if (part_order.empty()) computePartitionOrder();
-    #ifdef _OPENMP
-    #pragma omp parallel for reduction(+: df, ddf) schedule(dynamic) if(num_threads > 1)
-    #endif    
-	for (int partid = 0; partid < ntrees; partid++) {
+    DoubleVector part_df(ntrees, 0.0), part_ddf(ntrees, 0.0);
+	ThreadPool::getInstance().run(ntrees, [&](int partid) {
         int part = part_order_by_nptn[partid];
         double df_aux, ddf_aux;
 			PhyloNeighbor *nei1_part = nei1->link_neighbors[part];
@@ -594,14 +585,18 @@ void PhyloSuperTreePlen::computeFuncDerv(double value, double &df_ret, double &d
 					outError("shit!!   ",__func__);
 				}
 				at(part)->computeLikelihoodDerv(nei2_part,(PhyloNode*)nei1_part->node, df_aux, ddf_aux);
-				df += part_info[part].part_rate*df_aux;
-				ddf += part_info[part].part_rate*part_info[part].part_rate*ddf_aux;
+				part_df[part] = part_info[part].part_rate*df_aux;
+				part_ddf[part] = part_info[part].part_rate*part_info[part].part_rate*ddf_aux;
 			}
 			else {
 				if (part_info[part].cur_score == 0.0)
 					part_info[part].cur_score = at(part)->computeLikelihood();
 			}
-		}
+		});
+	for (int part = 0; part < ntrees; part++) {
+		df += part_df[part];
+		ddf += part_ddf[part];
+	}
     df_ret = -df;
     ddf_ret = -ddf;
 }
@@ -1867,8 +1862,11 @@ void PhyloSuperTreePlen::initializeAllPartialLh() {
     }
     at(part_order[0])->ptn_freq = ptn_freq;
     at(part_order[0])->ptn_freq_computed = false;
-    if (!ptn_invar)
+    if (!ptn_invar) {
         ptn_invar = aligned_alloc<double>(total_mem_size);
+        // computePtnInvar() compares with the previous invariant sites
+        memset(ptn_invar, 0, total_mem_size*sizeof(double));
+    }
     at(part_order[0])->ptn_invar = ptn_invar;
 
 //    size_t IT_NUM = (params->nni5) ? 6 : 2;
@@ -1899,6 +1897,12 @@ void PhyloSuperTreePlen::initializeAllPartialLh() {
         (*it)->nni_scale_num = (*prev_it)->nni_scale_num + IT_NUM*scale_block_size[part];
 	}
 
+    // per-thread gather buffers for repeated patterns are private to each partition
+    if (params->lk_site_repeats)
+        for (it = begin(); it != end(); it++)
+            if (!(*it)->repeat_lh_buffer)
+                (*it)->repeat_lh_buffer = aligned_alloc<double>(3*(block_size[it-begin()]/mem_size[it-begin()])*8*(*it)->num_threads);
+
 	// compute total memory for all partitions
 	uint64_t total_partial_lh_entries = 0, total_scale_num_entries = 0, total_partial_pars_entries = 0;
 	partial_lh_entries.resize(ntrees);
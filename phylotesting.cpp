@@ -32,6 +32,7 @@
 #include "model/modelmorphology.h"
 #include "model/modelmixture.h"
 #include "timeutil.h"
+#include "threadpool.h"
 
 #include "phyloanalysis.h"
 #include "gsl/mygsl.h"
@@ -1017,6 +1018,7 @@ void mergePartitions(PhyloSuperTree* super_tree, vector<IntVector> &gene_sets, S
 		Alignment *aln = super_aln->concatenateAlignments(*it);
 		PhyloTree *tree = super_tree->extractSubtree(*it);
 		tree->setAlignment(aln);
+		tree->setParams(super_tree->params);
 		tree_vec.push_back(tree);
 	}
 
@@ -1081,9 +1083,11 @@ void printModelFile(ostream &fmodel, Params &params, PhyloTree *tree, ModelInfo
 /**
  * select models for all partitions
  * @param model_info (IN/OUT) all model information
+ * @param model_deadline time after which no more models are started, 0 for none
  * @return total number of parameters
  */
-void testPartitionModel(Params &params, PhyloSuperTree* in_tree, vector<ModelInfo> &model_info, ostream &fmodel, ModelsBlock *models_block ) {
+void testPartitionModel(Params &params, PhyloSuperTree* in_tree, vector<ModelInfo> &model_info, ostream &fmodel, ModelsBlock *models_block,
+    double model_deadline) {
 //    params.print_partition_info = true;
 //    params.print_conaln = true;
 	int i = 0;
@@ -1098,9 +1102,10 @@ void testPartitionModel(Params &params, PhyloSuperTree* in_tree, vector<ModelInf
     int total_num_model = in_tree->size();
 	if (params.model_name.find("LINK") != string::npos || params.model_name.find("MERGE") != string::npos) {
         double p = params.partfinder_rcluster/100.0;
-        total_num_model += round(in_tree->size()*(in_tree->size()-1)*p/2);
+        double max_pairs = (params.partfinder_rcluster_max > 0) ? params.partfinder_rcluster_max : DBL_MAX;
+        total_num_model += min(round(in_tree->size()*(in_tree->size()-1)*p/2), max_pairs);
         for (i = in_tree->size()-2; i > 0; i--)
-            total_num_model += max(round(i*p), 1.0);
+            total_num_model += min(max(round(i*p), 1.0), max_pairs);
     }
     
     double start_time = getRealTime();
@@ -1148,7 +1153,7 @@ void testPartitionModel(Params &params, PhyloSuperTree* in_tree, vector<ModelInf
         stringstream this_fmodel;
 		// do the computation
 //#ifdef _OPENMP
-		string model = testModel(params, this_tree, part_model_info, this_fmodel, models_block, 1, in_tree->part_info[i].name);
+		string model = testModel(params, this_tree, part_model_info, this_fmodel, models_block, 1, in_tree->part_info[i].name, false, model_deadline);
 //#else
 //		string model = testModel(params, this_tree, part_model_info, fmodel, in_tree->part_info[i].name);
 //#endif
@@ -1208,7 +1213,9 @@ void testPartitionModel(Params &params, PhyloSuperTree* in_tree, vector<ModelInf
 		greedy_model_trees[i] = in_tree->part_info[i].name;
 	}
 	cout << "Merging models to increase model fit (about " << total_num_model << " total partition schemes)..." << endl;
-	int prev_part = -1;
+	// best model of every merged pair fitted so far: pairs not involving the last merged set
+	// are never refitted in later rounds
+	map<string, ModelInfo> pair_models;
 	while (gene_sets.size() >= 2) {
 		// stepwise merging charsets
 		double new_score = DBL_MAX;
@@ -1231,82 +1238,107 @@ void testPartitionModel(Params &params, PhyloSuperTree* in_tree, vector<ModelInf
                 distID[num_pairs] = (part1 << 16) | part2;
                 num_pairs++;
             }
-        if (num_pairs > 0 && params.partfinder_rcluster < 100) {
+        if (num_pairs > 0 && (params.partfinder_rcluster < 100 || 
+            (params.partfinder_rcluster_max > 0 && num_pairs > params.partfinder_rcluster_max))) {
             // sort distance
             quicksort(dist, 0, num_pairs-1, distID);
             num_pairs = (int)round(num_pairs * (params.partfinder_rcluster/100.0));
+            if (params.partfinder_rcluster_max > 0)
+                num_pairs = min(num_pairs, params.partfinder_rcluster_max);
             if (num_pairs <= 0) num_pairs = 1;
         }
-        // sort partition by computational cost for OpenMP effciency
-        for (i = 0; i < num_pairs; i++) {
-            // computation cost is proportional to #sequences, #patterns, and #states
-            Alignment *this_aln = in_tree->at(distID[i] >> 16)->aln;
-            dist[i] = -((double)this_aln->getNSeq())*this_aln->getNPattern()*this_aln->num_states;
-            this_aln = in_tree->at(distID[i] & ((1<<16)-1))->aln;
-            dist[i] -= ((double)this_aln->getNSeq())*this_aln->getNPattern()*this_aln->num_states;
-        }
-        if (params.num_threads > 1 && num_pairs >= 1)
-            quicksort(dist, 0, num_pairs-1, distID);
 
-#ifdef _OPENMP
-#pragma omp parallel for private(i) schedule(dynamic) if(!params.model_test_and_tree)
-#endif
+        // pairs examined in previous rounds are taken from pair_models, only the others are fitted
+        vector<IntVector> merged_sets;
+        StrVector set_names;
+        IntVector pair_part1, pair_part2;
+        merged_sets.resize(num_pairs);
+        set_names.resize(num_pairs);
+        pair_part1.resize(num_pairs);
+        pair_part2.resize(num_pairs);
+        int num_fit_pairs = 0;
         for (int pair = 0; pair < num_pairs; pair++) {
             int part1 = distID[pair] >> 16;
             int part2 = distID[pair] & ((1<<16)-1);
             assert(part1 != part2);
-            IntVector merged_set;
+            pair_part1[pair] = part1;
+            pair_part2[pair] = part2;
+            IntVector &merged_set = merged_sets[pair];
             merged_set.insert(merged_set.end(), gene_sets[part1].begin(), gene_sets[part1].end());
             merged_set.insert(merged_set.end(), gene_sets[part2].begin(), gene_sets[part2].end());
-            string set_name = "";
+            string &set_name = set_names[pair];
             for (i = 0; i < merged_set.size(); i++) {
                 if (i > 0)
                     set_name += "+";
                 set_name += in_tree->part_info[merged_set[i]].name;
             }
+            map<string, ModelInfo>::iterator mit = pair_models.find(set_name);
+            if (mit != pair_models.end()) {
+                double lhnew = lhsum - lhvec[part1] - lhvec[part2] + mit->second.logl;
+                int dfnew = dfsum - dfvec[part1] - dfvec[part2] + mit->second.df;
+                double score = computeInformationScore(lhnew, dfnew, ssize, params.model_test_criterion);
+                if (score < new_score) {
+                    new_score = score;
+                    opt_part1 = part1;
+                    opt_part2 = part2;
+                    opt_lh = mit->second.logl;
+                    opt_df = mit->second.df;
+                    opt_treelen = mit->second.tree_len;
+                    opt_merged_set = merged_set;
+                    opt_set_name = set_name;
+                    opt_model_name = mit->second.name;
+                }
+                continue;
+            }
+            // computation cost is proportional to #sequences, #patterns, and #states
+            int nseq = 0;
+            double npattern = 0.0;
+            for (i = 0; i < merged_set.size(); i++) {
+                Alignment *this_aln = in_tree->at(merged_set[i])->aln;
+                nseq = max(nseq, this_aln->getNSeq());
+                npattern += this_aln->getNPattern();
+            }
+            dist[num_fit_pairs] = -((double)nseq)*npattern*in_tree->at(merged_set[0])->aln->num_states;
+            distID[num_fit_pairs] = pair;
+            num_fit_pairs++;
+        }
+        // sort pairs by computational cost for OpenMP effciency
+        if (params.num_threads > 1 && num_fit_pairs >= 1)
+            quicksort(dist, 0, num_fit_pairs-1, distID);
+
+#ifdef _OPENMP
+#pragma omp parallel for private(i) schedule(dynamic) if(!params.model_test_and_tree)
+#endif
+        for (int fit_pair = 0; fit_pair < num_fit_pairs; fit_pair++) {
+            int pair = distID[fit_pair];
+            int part1 = pair_part1[pair];
+            int part2 = pair_part2[pair];
+            IntVector &merged_set = merged_sets[pair];
+            string &set_name = set_names[pair];
             string model = "";
             double logl = 0.0;
             int df = 0;
             double treelen = 0.0;
-            bool done_before = false;
-            if (prev_part >= 0 && part1 != prev_part && part2 != prev_part) {
-                // if pairs previously examined, reuse the information
-                for (vector<ModelInfo>::iterator mit = model_info.begin(); mit != model_info.end(); mit++)
-                    if (mit->set_name == set_name) {
-                        model = mit->name;
-                        logl = mit->logl;
-                        df = mit->df;
-                        treelen = mit->tree_len;
-                        done_before = true;
-                        break;
-                    }
-            }
             vector<ModelInfo> part_model_info;
             stringstream this_fmodel;
-            if (!done_before) {
-                Alignment *aln = super_aln->concatenateAlignments(merged_set);
-                PhyloTree *tree = in_tree->extractSubtree(merged_set);
-                tree->setAlignment(aln);
-                extractModelInfo(set_name, model_info, part_model_info);
+            Alignment *aln = super_aln->concatenateAlignments(merged_set);
+            PhyloTree *tree = in_tree->extractSubtree(merged_set);
+            tree->setAlignment(aln);
+            extractModelInfo(set_name, model_info, part_model_info);
 //                TODO
-                tree->num_precision = in_tree->num_precision;
-                if (params.model_test_and_tree) {
-                    tree->setCheckpoint(new Checkpoint());
-                }
-//#ifdef _OPENMP
-                model = testModel(params, tree, part_model_info, this_fmodel, models_block, 1, set_name);
-//#else
-//                model = testModel(params, tree, part_model_info, fmodel, set_name);
-//#endif
-                logl = part_model_info[0].logl;
-                df = part_model_info[0].df;
-                treelen = part_model_info[0].tree_len;
-                if (params.model_test_and_tree) {
-                    delete tree->getCheckpoint();
-                }
-                delete tree;
-                delete aln;
+            tree->num_precision = in_tree->num_precision;
+            if (params.model_test_and_tree) {
+                tree->setCheckpoint(new Checkpoint());
+            }
+            model = testModel(params, tree, part_model_info, this_fmodel, models_block, 1, set_name, false, model_deadline);
+            logl = part_model_info[0].logl;
+            df = part_model_info[0].df;
+            treelen = part_model_info[0].tree_len;
+            if (params.model_test_and_tree) {
+                delete tree->getCheckpoint();
             }
+            delete tree;
+            delete aln;
             double lhnew = lhsum - lhvec[part1] - lhvec[part2] + logl;
             int dfnew = dfsum - dfvec[part1] - dfvec[part2] + df;
             double score = computeInformationScore(lhnew, dfnew, ssize, params.model_test_criterion);
@@ -1314,25 +1346,27 @@ void testPartitionModel(Params &params, PhyloSuperTree* in_tree, vector<ModelInf
 #pragma omp critical
 #endif
 			{
-				if (!done_before) {
-//#ifdef _OPENMP
-                    fmodel << this_fmodel.str();
-//#endif
-					replaceModelInfo(model_info, part_model_info);
-                    num_model++;
-					cout.width(4);
-					cout << right << num_model << " ";
-					cout.width(12);
-					cout << left << model << " ";
-					cout.width(11);
-					cout << score << " " << set_name;
-                    if (num_model >= 10) {
-                        double remain_time = max(total_num_model-num_model, 0)*(getRealTime()-start_time)/num_model;
-                        cout << "\t" << convert_time(getRealTime()-start_time) << " (" 
-                            << convert_time(remain_time) << " left)";
-                    }
-                    cout << endl;
-				}
+                fmodel << this_fmodel.str();
+                replaceModelInfo(model_info, part_model_info);
+                ModelInfo &pair_info = pair_models[set_name];
+                pair_info.set_name = set_name;
+                pair_info.name = model;
+                pair_info.logl = logl;
+                pair_info.df = df;
+                pair_info.tree_len = treelen;
+                num_model++;
+                cout.width(4);
+                cout << right << num_model << " ";
+                cout.width(12);
+                cout << left << model << " ";
+                cout.width(11);
+                cout << score << " " << set_name;
+                if (num_model >= 10) {
+                    double remain_time = max(total_num_model-num_model, 0)*(getRealTime()-start_time)/num_model;
+                    cout << "\t" << convert_time(getRealTime()-start_time) << " (" 
+                        << convert_time(remain_time) << " left)";
+                }
+                cout << endl;
 				if (score < new_score) {
 					new_score = score;
 					opt_part1 = part1;
@@ -1361,7 +1395,6 @@ void testPartitionModel(Params &params, PhyloSuperTree* in_tree, vector<ModelInf
 		model_names[opt_part1] = opt_model_name;
 		greedy_model_trees[opt_part1] = "(" + greedy_model_trees[opt_part1] + "," + greedy_model_trees[opt_part2] + ")" +
 				convertIntToString(in_tree->size()-gene_sets.size()+1) + ":" + convertDoubleToString(inf_score);
-		prev_part = opt_part1;
 
 		// delete entry opt_part2
 		lhvec.erase(lhvec.begin() + opt_part2);
@@ -1419,8 +1452,456 @@ bool isMixtureModel(ModelsBlock *models_block, string &model_str) {
     return false;
 }
 
+/**
+ * 64-bit FNV-1a hash, identical on all platforms unlike std::hash
+ */
+uint64_t hashFNV1a(const string &str) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (string::const_iterator it = str.begin(); it != str.end(); it++) {
+        hash ^= (unsigned char)(*it);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/**
+ * @return file of the model cache (-mcache) for the data of tree: the cache is addressed by a hash of
+ *   the site patterns, the taxon names, the topology of the starting tree and all options that change
+ *   the fit of a model without changing its name (initial parameters, optimizer, warm start mode)
+ */
+string getModelCacheFile(Params &params, PhyloTree *tree) {
+    Alignment *aln = tree->aln;
+    stringstream data;
+    data << aln->seq_type << " " << aln->num_states << " " << aln->getNSeq() << endl;
+    for (int i = 0; i < aln->getNSeq(); i++)
+        data << aln->getSeqName(i) << endl;
+    for (Alignment::iterator it = aln->begin(); it != aln->end(); it++)
+        data << it->frequency << " " << (string&)(*it) << endl;
+    // topology only, the branch lengths are re-estimated for every model
+    PhyloTree topology;
+    topology.copyPhyloTree(tree);
+    topology.setRootNode(NULL);
+    topology.printTree(data, WT_SORT_TAXA);
+    data << endl;
+    // options that change the starting values, the optimizer or the numerics of the fit
+    data.precision(10);
+    data << params.gamma_median << " " << params.model_test_and_tree << " " << params.mcat_type << endl;
+    data << params.gamma_shape << " " << params.min_gamma_shape << " " << params.p_invar_sites << " "
+         << params.no_rescale_gamma_invar << endl;
+    data << params.freq_type << " " << ((params.state_freq_set) ? params.state_freq_set : "") << endl;
+    data << params.optimize_alg << " " << params.optimize_alg_gammai << " " << params.opt_gammai_fast << " "
+         << params.opt_gammai_keep_bran << " " << params.optimize_model_rate_joint << " "
+         << params.optimize_by_newton << " " << params.optimize_mixmodel_weight << " "
+         << params.num_param_iterations << " " << params.fixed_branch_length << endl;
+    // -msep and -mpar change the warm starts of the models
+    data << params.model_test_separate_rate << " " << params.model_test_parallel << " "
+         << params.lk_float_storage << endl;
+
+    stringstream file;
+    file << params.model_cache_dir << "/" << hex << setw(16) << setfill('0') << hashFNV1a(data.str()) << ".model";
+    return file.str();
+}
+
+/**
+ * read the models of a cache file, lines have the format of the .model file without subset name
+ * @param[out] cache_info models in the cache
+ * @param[out] cache_lines corresponding lines of the cache file
+ */
+void readModelCache(string &cache_file, vector<ModelInfo> &cache_info, StrVector &cache_lines) {
+    if (!fileExists(cache_file))
+        return;
+    ifstream in(cache_file.c_str());
+    string line;
+    while (getline(in, line)) {
+        // skip lines not completely written by a concurrent run
+        if (line.empty() || *line.rbegin() != ';')
+            continue;
+        istringstream line_in(line);
+        ModelInfo info;
+        if (!(line_in >> info.name >> info.df >> info.logl >> info.tree_len))
+            continue;
+        info.tree = line.substr(line.rfind('\t') + 1);
+        cache_info.push_back(info);
+        cache_lines.push_back(line);
+    }
+    in.close();
+}
+
+/**
+ * fitted parameters of a candidate model, used to warm-start the models it is nested in
+ */
+struct FittedModelParams {
+    string matrix_name, rate_name;
+    double logl;
+    DoubleVector rates, state_freq;
+    StateFreqType freq_type;
+    double gamma_shape, p_invar;
+};
+
+/**
+ * record the parameters of the model just fitted on tree
+ */
+void saveFittedParams(PhyloTree *tree, string &matrix_name, string &rate_name, double logl, vector<FittedModelParams> &fitted) {
+    ModelSubst *model = tree->getModel();
+    FittedModelParams params;
+    params.matrix_name = matrix_name;
+    params.rate_name = rate_name;
+    params.logl = logl;
+    params.rates.resize(model->getNumRateEntries());
+    model->getRateMatrix(&params.rates[0]);
+    params.state_freq.resize(model->num_states);
+    model->getStateFrequency(&params.state_freq[0]);
+    params.freq_type = model->getFreqType();
+    params.gamma_shape = tree->getRate()->getGammaShape();
+    params.p_invar = tree->getRate()->getPInvar();
+    fitted.push_back(params);
+}
+
+/**
+ * @return TRUE if rates fulfill the rate constraints of a DNA model, i.e. the model they were fitted with
+ *   is nested in the DNA model
+ */
+bool isNestedRates(ModelDNA *model, DoubleVector &rates) {
+    const string &rate_type = model->getRateType();
+    if (rate_type.length() != rates.size())
+        return false;
+    for (int i = 0; i < rates.size(); i++) {
+        if (rate_type[i] == 0 && fabs(rates[i] - 1.0) > 1e-6)
+            return false;
+        for (int j = i+1; j < rates.size(); j++)
+            if (rate_type[i] == rate_type[j] && fabs(rates[i] - rates[j]) > 1e-6 * rates[i])
+                return false;
+    }
+    return true;
+}
+
+/**
+ * initialize the parameters of a candidate model from already fitted models it is nested in, instead of defaults:
+ * substitution rates and estimated frequencies from the same matrix or a nested DNA matrix,
+ * Gamma shape and proportion of invariable sites from a nested matrix with the same rate model or from
+ * +G and +I of the same matrix. FreeRate parameters are kept: +R(k+1) is seeded from +R(k) only if it
+ * ends up worse than +R(k), as seeding it first costs more iterations than starting from defaults.
+ * @return TRUE if any parameter was initialized
+ */
+bool warmStartModel(PhyloTree *tree, string &matrix_name, string &rate_name, vector<FittedModelParams> &fitted) {
+    ModelGTR *model = (ModelGTR*)tree->getModel();
+    RateHeterogeneity *site_rate = tree->getRate();
+    ModelDNA *model_dna = (tree->aln->seq_type == SEQ_DNA) ? (ModelDNA*)model : NULL;
+    FittedModelParams *rate_parent = NULL, *same_rate_parent = NULL, *gamma_parent = NULL, *invar_parent = NULL;
+    vector<FittedModelParams>::reverse_iterator it;
+    for (it = fitted.rbegin(); it != fitted.rend(); it++) {
+        if (it->matrix_name == matrix_name) {
+            // most recent fit of the same matrix with another rate model
+            if (!rate_parent)
+                rate_parent = &(*it);
+            if (!gamma_parent && it->rate_name.find("+G") == 0)
+                gamma_parent = &(*it);
+            if (!invar_parent && it->rate_name == "+I")
+                invar_parent = &(*it);
+        } else if (it->rate_name == rate_name && model_dna && isNestedRates(model_dna, it->rates)) {
+            // best fit of a nested matrix with the same rate model
+            if (!same_rate_parent || it->logl > same_rate_parent->logl)
+                same_rate_parent = &(*it);
+        }
+    }
+    FittedModelParams *subst_parent = (rate_parent) ? rate_parent : same_rate_parent;
+    bool changed = false;
+    // codon models derive their rates from kappa and omega
+    if (subst_parent && model->getNDim() > 0 && tree->aln->seq_type != SEQ_CODON) {
+        model->setRateMatrix(&subst_parent->rates[0]);
+        if (model->getFreqType() == FREQ_ESTIMATE && subst_parent->freq_type == FREQ_ESTIMATE)
+            model->setStateFrequency(&subst_parent->state_freq[0]);
+        model->decomposeRateMatrix();
+        changed = true;
+    }
+    if (rate_name.find("+R") != string::npos)
+        return changed;
+    if (same_rate_parent) {
+        gamma_parent = same_rate_parent;
+        invar_parent = same_rate_parent;
+    }
+    if (site_rate->getGammaShape() > 0.0 && gamma_parent && gamma_parent->gamma_shape > 0.0) {
+        site_rate->setGammaShape(gamma_parent->gamma_shape);
+        changed = true;
+    }
+    if (rate_name.find("+I") != string::npos && invar_parent && invar_parent->p_invar > 0.0) {
+        site_rate->setPInvar(invar_parent->p_invar);
+        changed = true;
+    }
+    return changed;
+}
+
+/**
+ * split a model name into substitution matrix with state frequencies and rate heterogeneity,
+ * e.g. LG+F+I+G4 into LG+F and +I+G4
+ */
+void splitRateHetName(const string &name, string &matrix_name, string &rate_name) {
+    const char *rate_types[] = {"+I", "+G", "+R"};
+    size_t pos = name.length();
+    for (int i = 0; i < sizeof(rate_types)/sizeof(char*); i++)
+        pos = min(pos, name.find(rate_types[i]));
+    matrix_name = name.substr(0, pos);
+    rate_name = name.substr(pos);
+}
+
+/**
+ * @return index of the model in infos with the same name and number of parameters as info, -1 if none
+ */
+int findModelInfo(vector<ModelInfo> &infos, ModelInfo &info) {
+    for (int i = 0; i < infos.size(); i++)
+        if (infos[i].name == info.name && infos[i].df == info.df)
+            return i;
+    return -1;
+}
+
+/**
+ * write the line of a fitted model to the .model file and append it to the model cache
+ * @param model_line line printed by printModelFile without subset name
+ * @param cache_file model cache file, empty if not used
+ */
+void writeModelLine(ostream &fmodel, string &set_name, string model_line, string &cache_file) {
+    if (set_name != "")
+        fmodel << set_name << "\t";
+    fmodel << model_line;
+    if (cache_file == "")
+        return;
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+    {
+        // one write per line, thus runs sharing the cache do not interleave lines
+        ofstream out(cache_file.c_str(), ios::app);
+        if (out.is_open()) {
+            out << model_line;
+            out.close();
+        } else
+            outWarning("Cannot write to model cache " + cache_file);
+    }
+}
+
+/**
+ * create the substitution model object that testModel re-initializes for every candidate
+ * @param seq_type data type
+ * @param tree tree the model belongs to
+ * @return new substitution model, NULL for unsupported data type
+ */
+ModelGTR *createTestSubstModel(SeqType seq_type, PhyloTree *tree) {
+	ModelGTR *subst_model = NULL;
+	if (seq_type == SEQ_BINARY)
+		subst_model = new ModelBIN("JC2", "", FREQ_UNKNOWN, "", tree);
+	else if (seq_type == SEQ_DNA)
+		subst_model = new ModelDNA("JC", "", FREQ_UNKNOWN, "", tree);
+	else if (seq_type == SEQ_PROTEIN)
+		subst_model = new ModelProtein("WAG", "", FREQ_UNKNOWN, "", tree);
+	else if (seq_type == SEQ_MORPH)
+		subst_model = new ModelMorphology("MK", "", FREQ_UNKNOWN, "", tree);
+	else if (seq_type == SEQ_CODON)
+		subst_model = new ModelCodon("GY", "", FREQ_UNKNOWN, "", tree, false);
+	return subst_model;
+}
+
+/**
+ * assign a candidate model of testModel to a tree
+ * @param model_name model name (without mixture components)
+ * @param subst_model substitution model to be initialized with model_name
+ * @param rate_class rate models without heterogeneity, +I, +G, +I+G
+ * @param rate_class_free FreeRate models +R2, +R3, ...
+ * @param rate_class_freeinvar FreeRate models with invariable sites +I+R2, +I+R3, ...
+ * @param model_fac model factory to hold the substitution and rate model
+ * @return number of rate categories given in model_name for +R or +G, 0 otherwise
+ */
+int initTestModel(Params &params, PhyloTree *tree, string &model_name, ModelGTR *subst_model, RateHeterogeneity **rate_class,
+    RateFree **rate_class_free, RateFreeInvar **rate_class_freeinvar, ModelFactory *model_fac)
+{
+    int ncat = 0;
+    subst_model->setTree(tree);
+    StateFreqType freq_type = FREQ_UNKNOWN;
+    if (model_name.find("+F1X4") != string::npos)
+        freq_type = FREQ_CODON_1x4;
+    else if (model_name.find("+F3X4C") != string::npos)
+        freq_type = FREQ_CODON_3x4C;
+    else if (model_name.find("+F3X4") != string::npos)
+        freq_type = FREQ_CODON_3x4;
+    else if (model_name.find("+FQ") != string::npos)
+        freq_type = FREQ_EQUAL;
+    else if (model_name.find("+FO") != string::npos)
+        freq_type = FREQ_ESTIMATE;
+    else if (model_name.find("+FU") != string::npos)
+        freq_type = FREQ_USER_DEFINED;
+    else if (model_name.find("+F") != string::npos)
+        freq_type = FREQ_EMPIRICAL;
+        
+    subst_model->init(model_name.substr(0, model_name.find('+')).c_str(), "", freq_type, "");
+    tree->params = &params;
+
+    tree->setModel(subst_model);
+    // initialize rate
+    size_t pos;
+    if (model_name.find("+I") != string::npos && (pos = model_name.find("+R")) != string::npos) {
+        ncat = params.num_rate_cats;
+        if (model_name.length() > pos+2 && isdigit(model_name[pos+2])) {
+            ncat = convert_int(model_name.c_str() + pos+2);
+    //                tree->getRate()->setNCategory(ncat);
+        }
+        if (ncat <= 1) outError("Number of rate categories for " + model_name + " is <= 1");
+        if (ncat > params.max_rate_cats)
+            outError("Number of rate categories for " + model_name + " exceeds " + convertIntToString(params.max_rate_cats));
+        tree->setRate(rate_class_freeinvar[ncat-2]);
+    } else if ((pos = model_name.find("+R")) != string::npos) {
+        ncat = params.num_rate_cats;
+        if (model_name.length() > pos+2 && isdigit(model_name[pos+2])) {
+            ncat = convert_int(model_name.c_str() + pos+2);
+    //                tree->getRate()->setNCategory(ncat);
+        }
+        if (ncat <= 1) outError("Number of rate categories for " + model_name + " is <= 1");
+        if (ncat > params.max_rate_cats)
+            outError("Number of rate categories for " + model_name + " exceeds " + convertIntToString(params.max_rate_cats));
+        tree->setRate(rate_class_free[ncat-2]);
+    } else if (model_name.find("+I") != string::npos && (pos = model_name.find("+G")) != string::npos) {
+        tree->setRate(rate_class[3]);
+        if (model_name.length() > pos+2 && isdigit(model_name[pos+2])) {
+            int ncat = convert_int(model_name.c_str() + pos+2);
+            if (ncat < 1) outError("Wrong number of category for +G in " + model_name);
+            tree->getRate()->setNCategory(ncat);
+        }
+    } else if ((pos = model_name.find("+G")) != string::npos) {
+        tree->setRate(rate_class[2]);
+        if (model_name.length() > pos+2 && isdigit(model_name[pos+2])) {
+            ncat = convert_int(model_name.c_str() + pos+2);
+            if (ncat < 1) outError("Wrong number of category for +G in " + model_name);
+            tree->getRate()->setNCategory(ncat);
+        }
+    } else if (model_name.find("+I") != string::npos)
+        tree->setRate(rate_class[1]);
+    else
+        tree->setRate(rate_class[0]);
+
+    tree->getRate()->setTree(tree);
+
+    // initialize model factory
+    model_fac->model = subst_model;
+    model_fac->site_rate = tree->getRate();
+    tree->setModelFactory(model_fac);
+
+    return ncat;
+}
+
+/**
+ * fit candidate models concurrently on pool threads, each on its own copy of in_tree over the
+ * shared alignment. Only models that do not depend on earlier results are considered: not
+ * the +R series, rate models tested after the substitution model (-msep), +ASC or mixture models.
+ * One task fits the rate models of one matrix in model_names order, each warm-started from the
+ * earlier fits of the same matrix. Warm starts from nested matrices of the serial path are not
+ * available, so the fitted parameters may differ slightly from a serial run.
+ * @param model_names candidate models of testModel
+ * @param model_info models already examined, they are not fitted again
+ * @param model_deadline time after which no more models are started, 0 for none
+ * @param[out] par_info fitted models indexed like model_names, empty name if not fitted
+ * @param[out] par_fmodel the .model file lines of the fitted models, without subset name
+ * @param[out] par_fitted parameters of the fitted models, to warm-start the serial models
+ */
+void fitModelsParallel(Params &params, PhyloTree *in_tree, StrVector &model_names, vector<ModelInfo> &model_info,
+    ModelsBlock *models_block, string &set_name, double model_deadline, vector<ModelInfo> &par_info, StrVector &par_fmodel,
+    vector<FittedModelParams> &par_fitted)
+{
+    // models grouped by matrix, in order of appearance
+    vector<IntVector> matrix_models;
+    StrVector matrix_names;
+    int num_models = 0;
+    for (int model = 0; model < model_names.size(); model++) {
+        string &name = model_names[model];
+        if (name[0] == '+' || name.find("+R") != string::npos || name.find("+ASC") != string::npos ||
+            isMixtureModel(models_block, name))
+            continue;
+        string matrix_name, rate_name;
+        splitRateHetName(name, matrix_name, rate_name);
+        int group = find(matrix_names.begin(), matrix_names.end(), matrix_name) - matrix_names.begin();
+        if (group == matrix_names.size()) {
+            matrix_names.push_back(matrix_name);
+            matrix_models.push_back(IntVector());
+        }
+        matrix_models[group].push_back(model);
+        num_models++;
+    }
+    par_info.resize(model_names.size());
+    par_fmodel.resize(model_names.size());
+    par_fitted.resize(model_names.size());
+    if (matrix_models.size() < 2)
+        return;
+
+    SeqType seq_type = in_tree->aln->seq_type;
+    // the seq_states are shared by all copies
+    in_tree->aln->buildSeqStates(false);
+    if (set_name == "")
+        cout << "Fitting " << num_models << " models in parallel on " << ThreadPool::getInstance().getNumThreads()
+            << " threads ..." << endl;
+
+    ThreadPool::getInstance().run(matrix_models.size(), [&](int group) {
+        vector<FittedModelParams> fitted;
+        for (IntVector::iterator mit = matrix_models[group].begin(); mit != matrix_models[group].end(); mit++) {
+            int model = *mit;
+            if (model_deadline > 0 && getRealTime() > model_deadline)
+                return;
+            PhyloTree *tree = new PhyloTree;
+            tree->copyPhyloTree(in_tree);
+            tree->setParams(&params);
+            tree->optimize_by_newton = params.optimize_by_newton;
+            tree->num_precision = in_tree->num_precision;
+            tree->setLikelihoodKernel(params.SSE, 1);
+
+            RateHeterogeneity *rate_class[4];
+            rate_class[0] = new RateHeterogeneity();
+            rate_class[1] = new RateInvar(params.p_invar_sites, tree);
+            rate_class[2] = new RateGamma(params.num_rate_cats, params.gamma_shape, params.gamma_median, tree);
+            rate_class[3] = new RateGammaInvar(params.num_rate_cats, params.gamma_shape, params.gamma_median, -1, params.optimize_alg_gammai, tree, false);
+            ModelGTR *subst_model = createTestSubstModel(seq_type, tree);
+            ModelFactory *model_fac = new ModelFactory();
+            model_fac->joint_optimize = params.optimize_model_rate_joint;
+            initTestModel(params, tree, model_names[model], subst_model, rate_class, NULL, NULL, model_fac);
+
+            ModelInfo &info = par_info[model];
+            info.set_name = set_name;
+            info.name = tree->getModelName();
+            info.df = model_fac->getNParameters();
+            bool done_before = false;
+            for (vector<ModelInfo>::iterator it = model_info.begin(); it != model_info.end(); it++)
+                if (it->name == info.name) {
+                    done_before = true;
+                    break;
+                }
+            if (done_before) {
+                info.name = "";
+            } else {
+                string matrix_name, rate_name;
+                splitRateHetName(info.name, matrix_name, rate_name);
+                tree->initializeAllPartialLh();
+                warmStartModel(tree, matrix_name, rate_name, fitted);
+                tree->clearAllPartialLH();
+                info.logl = model_fac->optimizeParameters(false, false, TOL_LIKELIHOOD_MODELTEST, TOL_GRADIENT_MODELTEST);
+                info.tree_len = tree->treeLength();
+                info.tree = tree->getTreeString();
+                saveFittedParams(tree, matrix_name, rate_name, info.logl, fitted);
+                par_fitted[model] = fitted.back();
+                stringstream this_fmodel;
+                string no_set_name = "";
+                printModelFile(this_fmodel, params, tree, info, no_set_name);
+                par_fmodel[model] = this_fmodel.str();
+            }
+
+            tree->setModelFactory(NULL);
+            tree->setModel(NULL);
+            tree->setRate(NULL);
+            delete tree;
+            delete model_fac;
+            delete subst_model;
+            for (int rate_type = 3; rate_type >= 0; rate_type--)
+                delete rate_class[rate_type];
+        }
+    });
+}
+
 string testModel(Params &params, PhyloTree* in_tree, vector<ModelInfo> &model_info, ostream &fmodel, ModelsBlock *models_block,
-    int num_threads, string set_name, bool print_mem_usage)
+    int num_threads, string set_name, bool print_mem_usage, double model_deadline)
 {
 	SeqType seq_type = in_tree->aln->seq_type;
 	if (in_tree->isSuperTree())
@@ -1457,7 +1938,7 @@ string testModel(Params &params, PhyloTree* in_tree, vector<ModelInfo> &model_in
 	if (in_tree->isSuperTree()) {
 		// select model for each partition
 		PhyloSuperTree *stree = (PhyloSuperTree*)in_tree;
-		testPartitionModel(params, stree, model_info, fmodel, models_block);
+		testPartitionModel(params, stree, model_info, fmodel, models_block, model_deadline);
 //        stree->linkTrees();
         stree->mapTrees();
 		string res_models = "";
@@ -1491,18 +1972,7 @@ string testModel(Params &params, PhyloTree* in_tree, vector<ModelInfo> &model_in
     }
         
         
-	ModelGTR *subst_model = NULL;
-	if (seq_type == SEQ_BINARY)
-		subst_model = new ModelBIN("JC2", "", FREQ_UNKNOWN, "", in_tree);
-	else if (seq_type == SEQ_DNA)
-		subst_model = new ModelDNA("JC", "", FREQ_UNKNOWN, "", in_tree);
-	else if (seq_type == SEQ_PROTEIN)
-		subst_model = new ModelProtein("WAG", "", FREQ_UNKNOWN, "", in_tree);
-	else if (seq_type == SEQ_MORPH)
-		subst_model = new ModelMorphology("MK", "", FREQ_UNKNOWN, "", in_tree);
-	else if (seq_type == SEQ_CODON)
-		subst_model = new ModelCodon("GY", "", FREQ_UNKNOWN, "", in_tree, false);
-
+	ModelGTR *subst_model = createTestSubstModel(seq_type, in_tree);
 	assert(subst_model);
 
 	ModelFactory *model_fac = new ModelFactory();
@@ -1538,9 +2008,40 @@ string testModel(Params &params, PhyloTree* in_tree, vector<ModelInfo> &model_in
     string prev_tree_string = "";
     int prev_model_id = -1;
     int skip_model = 0;
+    // with -mpar, independent models are fitted concurrently first and merged below in the order of model_names
+    // with -mcache, models fitted to identical data by earlier runs are taken from the cache
+    string cache_file = "";
+    vector<ModelInfo> cache_info;
+    StrVector cache_lines;
+    int num_cached = 0;
+    if (params.model_cache_dir && !params.print_site_lh) {
+        cache_file = getModelCacheFile(params, in_tree);
+        readModelCache(cache_file, cache_info, cache_lines);
+    }
+
+    // with -mprune, +I+G and +R variants of a matrix are skipped if its +G fit is far behind the best model
+    map<string, double> gamma_scores;
+    double best_score = DBL_MAX, max_rate_gain = 0.0;
+    StrVector pruned_models, skipped_models;
+    // parameters of the models fitted so far, to warm-start the models they are nested in
+    vector<FittedModelParams> fitted_params;
+
+    vector<ModelInfo> par_info;
+    StrVector par_fmodel;
+    vector<FittedModelParams> par_fitted;
+    if (params.model_test_parallel && num_threads > 1 && !params.model_test_and_tree && !params.print_site_lh) {
+        vector<ModelInfo> known_info = model_info;
+        known_info.insert(known_info.end(), cache_info.begin(), cache_info.end());
+        fitModelsParallel(params, in_tree, model_names, known_info, models_block, set_name, model_deadline, par_info, par_fmodel,
+            par_fitted);
+    }
 
 	for (model = 0; model < model_names.size(); model++) {
 		//cout << model_names[model] << endl;
+        if (model_deadline > 0 && model > 0 && getRealTime() > model_deadline) {
+            cout << "NOTE: " << model_names.size() - model << " remaining models not tested to meet the deadline" << endl;
+            break;
+        }
         if (model_names[model][0] == '+') {
             // now switching to test rate heterogeneity
             if (best_model == "")
@@ -1598,76 +2099,7 @@ string testModel(Params &params, PhyloTree* in_tree, vector<ModelInfo> &model_in
                 model_fac->unobserved_ptns = "";
                 tree->aln->buildSeqStates(false);
             }
-            // initialize tree
-            // initialize model
-            subst_model->setTree(tree);
-            StateFreqType freq_type = FREQ_UNKNOWN;
-            if (model_names[model].find("+F1X4") != string::npos)
-                freq_type = FREQ_CODON_1x4;
-            else if (model_names[model].find("+F3X4C") != string::npos)
-                freq_type = FREQ_CODON_3x4C;
-            else if (model_names[model].find("+F3X4") != string::npos)
-                freq_type = FREQ_CODON_3x4;
-            else if (model_names[model].find("+FQ") != string::npos)
-                freq_type = FREQ_EQUAL;
-            else if (model_names[model].find("+FO") != string::npos)
-                freq_type = FREQ_ESTIMATE;
-            else if (model_names[model].find("+FU") != string::npos)
-                freq_type = FREQ_USER_DEFINED;
-            else if (model_names[model].find("+F") != string::npos)
-                freq_type = FREQ_EMPIRICAL;
-                
-            subst_model->init(model_names[model].substr(0, model_names[model].find('+')).c_str(), "", freq_type, "");
-            tree->params = &params;
-
-            tree->setModel(subst_model);
-            // initialize rate
-            size_t pos;
-            if (model_names[model].find("+I") != string::npos && (pos = model_names[model].find("+R")) != string::npos) {
-                ncat = params.num_rate_cats;
-                if (model_names[model].length() > pos+2 && isdigit(model_names[model][pos+2])) {
-                    ncat = convert_int(model_names[model].c_str() + pos+2);
-    //                tree->getRate()->setNCategory(ncat);
-                }
-                if (ncat <= 1) outError("Number of rate categories for " + model_names[model] + " is <= 1");
-                if (ncat > params.max_rate_cats)
-                    outError("Number of rate categories for " + model_names[model] + " exceeds " + convertIntToString(params.max_rate_cats));
-                tree->setRate(rate_class_freeinvar[ncat-2]);
-            } else if ((pos = model_names[model].find("+R")) != string::npos) {
-                ncat = params.num_rate_cats;
-                if (model_names[model].length() > pos+2 && isdigit(model_names[model][pos+2])) {
-                    ncat = convert_int(model_names[model].c_str() + pos+2);
-    //                tree->getRate()->setNCategory(ncat);
-                }
-                if (ncat <= 1) outError("Number of rate categories for " + model_names[model] + " is <= 1");
-                if (ncat > params.max_rate_cats)
-                    outError("Number of rate categories for " + model_names[model] + " exceeds " + convertIntToString(params.max_rate_cats));
-                tree->setRate(rate_class_free[ncat-2]);
-            } else if (model_names[model].find("+I") != string::npos && (pos = model_names[model].find("+G")) != string::npos) {
-                tree->setRate(rate_class[3]);
-                if (model_names[model].length() > pos+2 && isdigit(model_names[model][pos+2])) {
-                    int ncat = convert_int(model_names[model].c_str() + pos+2);
-                    if (ncat < 1) outError("Wrong number of category for +G in " + model_names[model]);
-                    tree->getRate()->setNCategory(ncat);
-                }
-            } else if ((pos = model_names[model].find("+G")) != string::npos) {
-                tree->setRate(rate_class[2]);
-                if (model_names[model].length() > pos+2 && isdigit(model_names[model][pos+2])) {
-                    ncat = convert_int(model_names[model].c_str() + pos+2);
-                    if (ncat < 1) outError("Wrong number of category for +G in " + model_names[model]);
-                    tree->getRate()->setNCategory(ncat);
-                }
-            } else if (model_names[model].find("+I") != string::npos)
-                tree->setRate(rate_class[1]);
-            else
-                tree->setRate(rate_class[0]);
-
-            tree->getRate()->setTree(tree);
-
-            // initialize model factory
-            model_fac->model = subst_model;
-            model_fac->site_rate = tree->getRate();
-            tree->setModelFactory(model_fac);
+            ncat = initTestModel(params, tree, model_names[model], subst_model, rate_class, rate_class_free, rate_class_freeinvar, model_fac);
         }
         
         tree->clearAllPartialLH();
@@ -1681,7 +2113,7 @@ string testModel(Params &params, PhyloTree* in_tree, vector<ModelInfo> &model_in
             info.name = model_names[model];
         else
             info.name = tree->getModelName();
-		int model_id = -1;
+		int model_id = -1, cache_id;
         if (skip_model) {
             assert(prev_model_id>=0);
             size_t pos_r = info.name.find("+R");
@@ -1696,6 +2128,27 @@ string testModel(Params &params, PhyloTree* in_tree, vector<ModelInfo> &model_in
 					outError("Inconsistent model file " + fmodel_str + ", please rerun using -mredo option");
 				break;
 			}
+        string matrix_name, rate_name;
+        splitRateHetName(info.name, matrix_name, rate_name);
+        bool expensive_rate = rate_name.find("+R") != string::npos ||
+            (rate_name.find("+I") != string::npos && rate_name.find("+G") != string::npos);
+        if (params.model_prune_margin > 0 && expensive_rate && model_id < 0 && !skip_model && !mixture_model &&
+            gamma_scores.find(matrix_name) != gamma_scores.end() && findModelInfo(cache_info, info) < 0 &&
+            !(model < par_info.size() && par_info[model].name == info.name) &&
+            gamma_scores[matrix_name] - best_score > max(params.model_prune_margin, 2 * max_rate_gain))
+        {
+            // the margin is at least twice the largest gain of such a variant over +G seen so far
+            pruned_models.push_back(info.name);
+            in_tree->setModel(NULL);
+            in_tree->setModelFactory(NULL);
+            in_tree->setRate(NULL);
+            if (set_name != "") continue;
+            cout.width(3);
+            cout << right << model+1 << "  ";
+            cout.width(13);
+            cout << left << info.name << " Pruned" << endl;
+            continue;
+        }
 		if (model_id >= 0) {
 			info.logl = model_info[model_id].logl;
             info.tree_len = model_info[model_id].tree_len;
@@ -1710,6 +2163,22 @@ string testModel(Params &params, PhyloTree* in_tree, vector<ModelInfo> &model_in
 //            prev_tree_string = model_info[prev_model_id].tree;
 //            cout << "Skipped " << info.name << endl;
             }
+        } else if ((cache_id = findModelInfo(cache_info, info)) >= 0) {
+            info.logl = cache_info[cache_id].logl;
+            info.tree_len = cache_info[cache_id].tree_len;
+            info.tree = cache_info[cache_id].tree;
+            prev_tree_string = info.tree;
+            string no_cache = "";
+            writeModelLine(fmodel, set_name, cache_lines[cache_id] + "\n", no_cache);
+            num_cached++;
+        } else if (model < par_info.size() && par_info[model].name == info.name && par_info[model].df == info.df) {
+            // fitted by fitModelsParallel
+            info.logl = par_info[model].logl;
+            info.tree_len = par_info[model].tree_len;
+            info.tree = par_info[model].tree;
+            prev_tree_string = info.tree;
+            writeModelLine(fmodel, set_name, par_fmodel[model], cache_file);
+            fitted_params.push_back(par_fitted[model]);
 		} else {
             if (params.model_test_and_tree) {
                 string original_model = params.model_name;
@@ -1767,6 +2236,11 @@ string testModel(Params &params, PhyloTree* in_tree, vector<ModelInfo> &model_in
                     tree->fixNegativeBranch(true);
                     tree->clearAllPartialLH();
                 }
+                if (!mixture_model) {
+                    // start from the fitted models this model is nested in instead of default parameters
+                    warmStartModel(tree, matrix_name, rate_name, fitted_params);
+                    tree->clearAllPartialLH();
+                }
                 info.logl = tree->getModelFactory()->optimizeParameters(false, false, TOL_LIKELIHOOD_MODELTEST, TOL_GRADIENT_MODELTEST);
                 info.tree_len = tree->treeLength();
                 if (prev_model_id >= 0) {
@@ -1788,11 +2262,16 @@ string testModel(Params &params, PhyloTree* in_tree, vector<ModelInfo> &model_in
                         info.tree_len = tree->treeLength();                        
                     }
                 }
+                if (!mixture_model)
+                    saveFittedParams(tree, matrix_name, rate_name, info.logl, fitted_params);
 //                info.tree = tree->getTreeString();
             }
 			// print information to .model file
             info.tree = tree->getTreeString();
-            printModelFile(fmodel, params, tree, info, set_name);
+            stringstream this_fmodel;
+            string no_set_name = "";
+            printModelFile(this_fmodel, params, tree, info, no_set_name);
+            writeModelLine(fmodel, set_name, this_fmodel.str(), cache_file);
 		}
 		computeInformationScores(info.logl, info.df, ssize, info.AIC_score, info.AICc_score, info.BIC_score);
         if (prev_model_id >= 0) {
@@ -1832,6 +2311,14 @@ string testModel(Params &params, PhyloTree* in_tree, vector<ModelInfo> &model_in
         }
         if (skip_model > 1)
             info.AIC_score = DBL_MAX;
+        else {
+            double score = computeInformationScore(info.logl, info.df, ssize, params.model_test_criterion);
+            best_score = min(best_score, score);
+            if (rate_name.find("+G") == 0 && rate_name.find('+', 1) == string::npos)
+                gamma_scores[matrix_name] = score;
+            else if (expensive_rate && gamma_scores.find(matrix_name) != gamma_scores.end())
+                max_rate_gain = max(max_rate_gain, gamma_scores[matrix_name] - score);
+        }
         
 		if (model_id >= 0) {
 			model_info[model_id] = info;
@@ -1859,6 +2346,8 @@ string testModel(Params &params, PhyloTree* in_tree, vector<ModelInfo> &model_in
         in_tree->setRate(NULL);
 
         prev_model_id = model_id;
+        if (skip_model > 1)
+            skipped_models.push_back(info.name);
 
 		if (set_name != "") continue;
 
@@ -1887,6 +2376,23 @@ string testModel(Params &params, PhyloTree* in_tree, vector<ModelInfo> &model_in
 
 	}
 
+    if (num_cached > 0 && set_name == "")
+        cout << num_cached << " models taken from model cache " << cache_file << endl;
+    if (set_name == "" && !skipped_models.empty()) {
+        cout << "NOTE: " << skipped_models.size() << " FreeRate models skipped as " << criterionName(params.model_test_criterion)
+            << " did not improve with more categories:";
+        for (StrVector::iterator sit = skipped_models.begin(); sit != skipped_models.end(); sit++)
+            cout << " " << *sit;
+        cout << endl;
+    }
+    if (set_name == "" && !pruned_models.empty()) {
+        cout << "NOTE: " << pruned_models.size() << " models pruned as the +G model of their matrix was too far behind the best model (final margin: "
+            << max(params.model_prune_margin, 2 * max_rate_gain) << " " << criterionName(params.model_test_criterion) << " units):";
+        for (StrVector::iterator sit = pruned_models.begin(); sit != pruned_models.end(); sit++)
+            cout << " " << *sit;
+        cout << endl;
+    }
+
     if (model_bic < 0) 
         outError("No models were examined! Please check messages above");
 
@@ -2044,7 +2550,8 @@ string testModel(Params &params, PhyloTree* in_tree, vector<ModelInfo> &model_in
 }
 
 int countDistinctTrees(const char *filename, bool rooted, IQTree *tree, IntVector &distinct_ids, bool exclude_duplicate) {
-	StringIntMap treels;
+	// map from topology fingerprint to the first tree with this topology
+	unordered_map<uint64_t, int> treels;
 	try {
 		ifstream in;
 		in.exceptions(ios::failbit | ios::badbit);
@@ -2057,16 +2564,13 @@ int countDistinctTrees(const char *filename, bool rooted, IQTree *tree, IntVecto
 				tree->freeNode();
 				tree->readTree(in, rooted);
 				tree->setAlignment(tree->aln);
-				tree->setRootNode((char*)tree->aln->getSeqName(0).c_str());
-				StringIntMap::iterator it = treels.end();
-				ostringstream ostr;
-				tree->printTree(ostr, WT_TAXON_ID | WT_SORT_TAXA);
-				it = treels.find(ostr.str());
+				uint64_t topology = tree->getTopologyFingerprint();
+				unordered_map<uint64_t, int>::iterator it = treels.find(topology);
 				if (it != treels.end()) { // already in treels
 					distinct_ids.push_back(it->second);
 				} else {
 					distinct_ids.push_back(-1);
-					treels[ostr.str()] = tree_id;
+					treels[topology] = tree_id;
 				}
 			} else {
 				// ignore tree
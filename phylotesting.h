@@ -66,10 +66,12 @@ bool checkModelFile(string model_file, bool is_partitioned, vector<ModelInfo> &i
  @param model_info (IN/OUT) information for all models considered
  @param set_name for partition model selection
  @param print_mem_usage true to print RAM memory used (default: false) 
+ @param model_deadline time after which no more models are started, shared by all partitions, 0 for none
  @return name of best-fit-model
  */
 string testModel(Params &params, PhyloTree* in_tree, vector<ModelInfo> &model_info, ostream &fmodel,
-		ModelsBlock *models_block, int num_threads, string set_name = "", bool print_mem_usage = false);
+		ModelsBlock *models_block, int num_threads, string set_name = "", bool print_mem_usage = false,
+		double model_deadline = 0.0);
 
 /**
  * print site log likelihoods to a fileExists
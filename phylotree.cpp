@@ -90,8 +90,13 @@ void PhyloTree::init() {
     theta_all = NULL;
     buffer_scale_all = NULL;
     buffer_partial_lh = NULL;
+    float_lh_buffer = NULL;
+    repeat_lh_buffer = NULL;
+    float_lh_exp_offset = 0;
     ptn_freq = NULL;
     ptn_invar = NULL;
+    repeat_stamp = 0;
+    repeat_valid_stamp = 0;
     subTreeDistComputed = false;
     dist_matrix = NULL;
     var_matrix = NULL;
@@ -226,6 +231,12 @@ PhyloTree::~PhyloTree() {
     if (buffer_partial_lh)
         aligned_free(buffer_partial_lh);
     buffer_partial_lh = NULL;
+    if (float_lh_buffer)
+        aligned_free(float_lh_buffer);
+    float_lh_buffer = NULL;
+    if (repeat_lh_buffer)
+        aligned_free(repeat_lh_buffer);
+    repeat_lh_buffer = NULL;
     if (ptn_freq)
         aligned_free(ptn_freq);
     ptn_freq = NULL;
@@ -642,13 +653,23 @@ void PhyloTree::initializeAllPartialPars(int &index, PhyloNode *node, PhyloNode
     FOR_NEIGHBOR_IT(node, dad, it)initializeAllPartialPars(index, (PhyloNode*) (*it)->node, node);
 }
 
+// the AVX-512 parsimony kernel processes 512 bits at once
+#ifdef INCLUDE_AVX512
+#define SIMD_BITS 512
+#else
 #define SIMD_BITS 256
+#endif
 
 size_t PhyloTree::getBitsBlockSize() {
     // reserve the last entry for parsimony score
 //    return (aln->num_states * aln->size() + UINT_BITS - 1) / UINT_BITS + 1;
     size_t len = aln->getMaxNumStates() * ((max(aln->size(), (size_t)aln->num_informative_sites) + SIMD_BITS - 1) / UINT_BITS) + 4;
+#ifdef INCLUDE_AVX512
+    // keep every block aligned to 64 bytes
+    len = ((len+15)/16)*16;
+#else
     len = ((len+7)/8)*8;
+#endif
     return len;
 }
 
@@ -690,8 +711,12 @@ size_t PhyloTree::getBufferPartialLhSize() {
     const size_t VECTOR_SIZE = 8; // TODO, adjusted
     size_t ncat_mix = site_rate->getNRate() * ((model_factory->fused_mix_rate)? 1 : model->getNMixtures());
     size_t block = model->num_states * ncat_mix;
-    size_t buffer_size = get_safe_upper_limit(block * model->num_states * 2 * aln->getNSeq());
-    buffer_size += get_safe_upper_limit(block * (aln->getNSeq()+1) * (aln->STATE_UNKNOWN+1));
+    // echildren and partial_lh_leaves are rounded up separately for every traversed node
+    size_t buffer_size = get_safe_upper_limit(block * model->num_states * 2) * aln->getNSeq();
+    buffer_size += get_safe_upper_limit(block * (aln->STATE_UNKNOWN+1)) * (aln->getNSeq()+1);
+    // head of the buffer reserved by computeTraversalInfo
+    buffer_size += block*VECTOR_SIZE*num_threads + get_safe_upper_limit(block) * (aln->STATE_UNKNOWN+2);
+    // per-thread tail used by the likelihood and derivative kernels
     buffer_size += (block*2+model->num_states)*VECTOR_SIZE*num_threads;
     return buffer_size;
 }
@@ -716,12 +741,27 @@ void PhyloTree::initializeAllPartialLh() {
     if (!buffer_partial_lh) {
         buffer_partial_lh = aligned_alloc<double>(getBufferPartialLhSize());
     }
+    if (params->lk_float_storage) {
+        // exponents are stored behind the single-precision partial likelihoods
+        float_lh_exp_offset = block_size;
+        if (!float_lh_buffer) {
+            // one pattern block for dad and two children per thread, 8 = largest vector size
+            float_lh_buffer = aligned_alloc<double>(3*(block_size/mem_size)*8*num_threads);
+        }
+    }
+    if (params->lk_site_repeats && !repeat_lh_buffer) {
+        // same layout as float_lh_buffer
+        repeat_lh_buffer = aligned_alloc<double>(3*(block_size/mem_size)*8*num_threads);
+    }
     if (!ptn_freq) {
         ptn_freq = aligned_alloc<double>(mem_size);
         ptn_freq_computed = false;
     }
-    if (!ptn_invar)
+    if (!ptn_invar) {
         ptn_invar = aligned_alloc<double>(mem_size);
+        // computePtnInvar() compares with the previous invariant sites
+        memset(ptn_invar, 0, mem_size*sizeof(double));
+    }
     initializeAllPartialLh(index, indexlh);
     if (params->lh_mem_save == LM_MEM_SAVE)
         mem_slots.init(this, max_lh_slots);
@@ -737,6 +777,8 @@ void PhyloTree::initializeAllPartialLh() {
 
 void PhyloTree::deleteAllPartialLh() {
 
+    repeat_valid_stamp = repeat_stamp;
+
 	if (central_partial_lh) {
 		aligned_free(central_partial_lh);
 	}
@@ -763,6 +805,10 @@ void PhyloTree::deleteAllPartialLh() {
         aligned_free(buffer_scale_all);
     if (buffer_partial_lh)
         aligned_free(buffer_partial_lh);
+    if (float_lh_buffer)
+        aligned_free(float_lh_buffer);
+    if (repeat_lh_buffer)
+        aligned_free(repeat_lh_buffer);
 	if (_pattern_lh_cat)
 		aligned_free(_pattern_lh_cat);
 	if (_pattern_lh)
@@ -777,6 +823,8 @@ void PhyloTree::deleteAllPartialLh() {
 	theta_all = NULL;
     buffer_scale_all = NULL;
     buffer_partial_lh = NULL;
+    float_lh_buffer = NULL;
+    repeat_lh_buffer = NULL;
 	_pattern_lh_cat = NULL;
 	_pattern_lh = NULL;
 
@@ -814,6 +862,8 @@ uint64_t PhyloTree::getMemoryRequired(size_t ncategory, bool full_mem) {
     	mem_size += model->getMemoryRequired();
 
     int64_t lh_scale_size = block_size * sizeof(double) + scale_block_size * sizeof(UBYTE);
+    if (params->lk_float_storage)
+        lh_scale_size = block_size * sizeof(float) + scale_block_size * (sizeof(int16_t) + sizeof(UBYTE));
 
     max_lh_slots = leafNum-2;
 
@@ -876,7 +926,8 @@ void PhyloTree::initializeAllPartialLh(int &index, int &indexlh, PhyloNode *node
     size_t nptn = get_safe_upper_limit(aln->size())+ get_safe_upper_limit(aln->num_states);
     uint64_t block_size;
     uint64_t scale_block_size = nptn * site_rate->getNRate() * ((model_factory->fused_mix_rate)? 1 : model->getNMixtures());
-    block_size = scale_block_size * model->num_states;
+    // number of doubles per partial_lh vector, smaller with single-precision storage
+    block_size = getPartialLhSize();
 
     if (!node) {
         node = (PhyloNode*) root;
@@ -1006,7 +1057,14 @@ double *PhyloTree::newPartialLh() {
 size_t PhyloTree::getPartialLhSize() {
     // +num_states for ascertainment bias correction
     size_t block_size = get_safe_upper_limit(aln->size())+get_safe_upper_limit(aln->num_states);
-    block_size *= model->num_states * site_rate->getNRate() * ((model_factory->fused_mix_rate)? 1 : model->getNMixtures());
+    size_t scale_size = block_size * site_rate->getNRate() * ((model_factory->fused_mix_rate)? 1 : model->getNMixtures());
+    block_size = scale_size * model->num_states;
+    if (params && params->lk_float_storage) {
+        // single-precision entries followed by one 16-bit exponent per pattern and category,
+        // rounded up to a multiple of 8 doubles to keep every vector aligned
+        size_t bytes = block_size*sizeof(float) + scale_size*sizeof(int16_t);
+        return ((bytes + 8*sizeof(double) - 1) / (8*sizeof(double))) * 8;
+    }
 	return block_size;
 }
 
@@ -1015,6 +1073,43 @@ size_t PhyloTree::getPartialLhBytes() {
 	return getPartialLhSize() * sizeof(double);
 }
 
+void PhyloTree::checkFloatPartialLh() {
+    assert(params->lk_float_storage);
+    if (!central_partial_lh)
+        initializeAllPartialLh();
+    clearAllPartialLH();
+    double float_lh = computeLikelihood();
+
+    // recompute with double-precision storage within the same amount of RAM,
+    // memory saving mode will recompute partial likelihoods if needed
+    LhMemSave saved_mem_save = params->lh_mem_save;
+    int64_t saved_slots = max_lh_slots;
+    size_t float_size = getPartialLhSize();
+    deleteAllPartialLh();
+    params->lk_float_storage = false;
+    params->lh_mem_save = LM_MEM_SAVE;
+    int64_t min_lh_slots = log2(leafNum)+LH_MIN_CONST;
+    max_lh_slots = max(min_lh_slots, (int64_t)(saved_slots * float_size / getPartialLhSize()));
+    max_lh_slots = min(max_lh_slots, (int64_t)leafNum-2);
+    initializeAllPartialLh();
+    double double_lh = computeLikelihood();
+
+    // back to single-precision storage
+    deleteAllPartialLh();
+    params->lk_float_storage = true;
+    params->lh_mem_save = saved_mem_save;
+    max_lh_slots = saved_slots;
+    initializeAllPartialLh();
+    computeLikelihood();
+
+    double rel_diff = fabs(float_lh - double_lh) / fabs(double_lh);
+    if (verbose_mode >= VB_MED)
+        cout << "Single-precision partial likelihoods: LogL " << float_lh << " vs. " << double_lh
+             << " in double precision (difference " << fabs(float_lh - double_lh) << ")" << endl;
+    if (rel_diff > params->lk_float_tolerance)
+        outError("Single-precision partial likelihoods are not accurate enough, please rerun without -lhfloat or increase -lhfloat-eps");
+}
+
 size_t PhyloTree::getScaleNumSize() {
 	return (get_safe_upper_limit(aln->size())+get_safe_upper_limit(aln->num_states)) * site_rate->getNRate() * ((model_factory->fused_mix_rate)? 1 : model->getNMixtures());
 }
@@ -2332,6 +2427,25 @@ void PhyloTree::computeFuncDerv(double value, double &df, double &ddf) {
 //    return lh;
 }
 
+void PhyloTree::computeFuncDervMulti(int num, double *values, double *fvalues, double *df, double *ddf) {
+    if (is_opt_scaling || isSuperTree() || !computeLikelihoodDervMultiPointer || num <= 0) {
+        Optimization::computeFuncDervMulti(num, values, fvalues, df, ddf);
+        return;
+    }
+    double lh[num], lh_df[num], lh_ddf[num];
+    computeLikelihoodDervMulti(current_it, (PhyloNode*) current_it_back->node, num, values, lh, lh_df, lh_ddf);
+    for (int i = 0; i < num; i++) {
+        fvalues[i] = -lh[i];
+        if (df) {
+            df[i] = -lh_df[i];
+            ddf[i] = -lh_ddf[i];
+        }
+    }
+    // as if the values were evaluated one after another
+    current_it->length = values[num-1];
+    current_it_back->length = values[num-1];
+}
+
 void PhyloTree::optimizeOneBranch(PhyloNode *node1, PhyloNode *node2, bool clearLH, int maxNRStep) {
     double negative_lh;
     current_it = (PhyloNeighbor*) node1->findNeighbor(node2);
@@ -2351,10 +2465,13 @@ void PhyloTree::optimizeOneBranch(PhyloNode *node1, PhyloNode *node2, bool clear
         }
     	if (optx > params->max_branch_length*0.95 && !isSuperTree()) {
     		// newton raphson diverged, reset
-    	    double opt_lh = computeLikelihoodFromBuffer();
+            // compare the new and the original length in one pass over theta_all
+            double len[2] = {current_it->length, current_len}, lh[2], lh_df[2], lh_ddf[2];
+            computeLikelihoodDervMulti(current_it, (PhyloNode*) current_it_back->node, 2, len, lh, lh_df, lh_ddf);
+    	    double opt_lh = lh[0];
     	    current_it->length = current_len;
     	    current_it_back->length = current_len;
-    	    double orig_lh = computeLikelihoodFromBuffer();
+    	    double orig_lh = lh[1];
     	    if (orig_lh > opt_lh) {
     	    	optx = current_len;
     	    }
@@ -2940,7 +3057,7 @@ void PhyloTree::doOneRandomNNI(Branch branch) {
 }
 
     
-NNIMove PhyloTree::getRandomNNI(Branch &branch) {
+NNIMove PhyloTree::getRandomNNI(Branch &branch, int *rstream) {
     assert(isInnerBranch(branch.first, branch.second));
     NNIMove nni;
     nni.node1 = (PhyloNode*) branch.first;
@@ -2950,7 +3067,7 @@ NNIMove PhyloTree::getRandomNNI(Branch &branch) {
             nni.node1Nei_it = node1NeiIt;
             break;
         }
-    int randInt = random_int(branch.second->neighbors.size()-1);
+    int randInt = random_int(branch.second->neighbors.size()-1, rstream);
     int cnt = 0;
     FOR_NEIGHBOR_IT(branch.second, branch.first, node2NeiIt) {
             if (cnt == randInt) {
@@ -3089,27 +3206,9 @@ NNIMove PhyloTree::getBestNNIForBran(PhyloNode *node1, PhyloNode *node2, NNIMove
 	int IT_NUM = (params->nni5) ? 6 : 2;
     size_t partial_lh_size = getPartialLhBytes()/sizeof(double);
     size_t scale_num_size = getScaleNumBytes()/sizeof(UBYTE);
+    mem_slots.setFocus(node1, node2);
 
 
-    // Upper Bounds ---------------
-    /*
-    if(params->upper_bound_NNI){
-    	totalNNIub += 2;
-    	NNIMove resMove;
-    	resMove = getBestNNIForBranUB(node1,node2,this);
-    	// if UB is smaller than the current likelihood, then we don't recompute the likelihood of the swapped topology.
-        // Otherwise, follow the normal procedure: evaluate NNIs and compute the likelihood.
-
-    	// here, we skip NNI is its UB n times worse than the curLikelihood
-    	if( resMove.newloglh < (1+params->upper_bound_frac)*this->curScore){
-    		//cout << "Skipping Likelihood evaluation of NNIs for this branch :) ........................"<<endl;
-    		return resMove;
-    	}
-    }
-    */
-    
-    //-----------------------------
-
 	NeighborVec::iterator it;
 
 	NeighborVec::iterator saved_it[6];
@@ -3127,6 +3226,12 @@ NNIMove PhyloTree::getBestNNIForBran(PhyloNode *node1, PhyloNode *node2, NNIMove
 	}
 	assert(id == IT_NUM);
 
+	if (!params->nni5 && !isSuperTree()) {
+		// without the adjacent branches only the central branch can hold the partial_lh to save
+		reorientPartialLh((PhyloNeighbor*)*saved_it[0], node1);
+		reorientPartialLh((PhyloNeighbor*)*saved_it[1], node2);
+	}
+
 	Neighbor *saved_nei[6];
     int mem_id = 0;
 	// save Neighbor and allocate new Neighbor pointer
@@ -3217,47 +3322,64 @@ NNIMove PhyloTree::getBestNNIForBran(PhyloNode *node1, PhyloNode *node2, NNIMove
 		node12_it->clearPartialLh();
 		node21_it->clearPartialLh();
 
+        // Upper Bounds: skip the branch length optimization if the swapped topology cannot beat
+        // the current tree for any length of the central branch, which is exact only if the
+        // adjacent branches are not optimized as well (-nni1)
+        bool skip_nni = false;
+        if (params->upper_bound_NNI && !params->nni5 && !nniMoves[cnt].ptnlh && save_all_trees != 2) {
+            totalNNIub++;
+            double UB = UpperBoundBranch(node1, node2, this);
+            if (UB < (1+params->upper_bound_frac)*backupScore) {
+                skippedNNIub++;
+                skip_nni = true;
+                if (verbose_mode >= VB_DEBUG)
+                    cout << "NNI " << node1->id << " - " << node2->id << " skipped, upper bound: " << UB << endl;
+            }
+        }
+
 		// compute the score of the swapped topology
 //		double saved_len = node1_nei->length;
 
-		int i=1;
-        if (params->nni5) {
-			FOR_NEIGHBOR(node1, node2, it)
-			{
-				((PhyloNeighbor*) (*it)->node->findNeighbor(node1))->clearPartialLh();
-				optimizeOneBranch(node1, (PhyloNode*) (*it)->node, false, NNI_MAX_NR_STEP);
-				nniMoves[cnt].newLen[i] = node1->findNeighbor((*it)->node)->length;
-				i++;
-			}
-            node21_it->clearPartialLh();
-        }
+        if (!skip_nni) {
+            int i=1;
+            if (params->nni5) {
+				FOR_NEIGHBOR(node1, node2, it)
+				{
+					((PhyloNeighbor*) (*it)->node->findNeighbor(node1))->clearPartialLh();
+					optimizeOneBranch(node1, (PhyloNode*) (*it)->node, false, NNI_MAX_NR_STEP);
+					nniMoves[cnt].newLen[i] = node1->findNeighbor((*it)->node)->length;
+					i++;
+				}
+                node21_it->clearPartialLh();
+            }
 
-		optimizeOneBranch(node1, node2, false, NNI_MAX_NR_STEP);
-		nniMoves[cnt].newLen[0] = node1->findNeighbor(node2)->length;
+			optimizeOneBranch(node1, node2, false, NNI_MAX_NR_STEP);
+			nniMoves[cnt].newLen[0] = node1->findNeighbor(node2)->length;
 
 
-        if (params->nni5) {
-			FOR_NEIGHBOR(node2, node1, it)
-			{
-				((PhyloNeighbor*) (*it)->node->findNeighbor(node2))->clearPartialLh();
-				optimizeOneBranch(node2, (PhyloNode*) (*it)->node, false, NNI_MAX_NR_STEP);
-				//node2_lastnei = (PhyloNeighbor*) (*it);
-				nniMoves[cnt].newLen[i] = node2->findNeighbor((*it)->node)->length;
-				i++;
+            if (params->nni5) {
+				FOR_NEIGHBOR(node2, node1, it)
+				{
+					((PhyloNeighbor*) (*it)->node->findNeighbor(node2))->clearPartialLh();
+					optimizeOneBranch(node2, (PhyloNode*) (*it)->node, false, NNI_MAX_NR_STEP);
+					//node2_lastnei = (PhyloNeighbor*) (*it);
+					nniMoves[cnt].newLen[i] = node2->findNeighbor((*it)->node)->length;
+					i++;
+				}
+				node12_it->clearPartialLh();
 			}
-			node12_it->clearPartialLh();
-		}
-		double score = computeLikelihoodFromBuffer();
-        if (verbose_mode >= VB_DEBUG)
-            cout << "NNI " << node1->id << " - " << node2->id << ": " << score << endl;
-		nniMoves[cnt].newloglh = score;
-		// compute the pattern likelihoods if wanted
-		if (nniMoves[cnt].ptnlh)
-			computePatternLikelihood(nniMoves[cnt].ptnlh, &score);
-
-		if (save_all_trees == 2) {
-			saveCurrentTree(score); // BQM: for new bootstrap
-		}
+			double score = computeLikelihoodFromBuffer();
+            if (verbose_mode >= VB_DEBUG)
+                cout << "NNI " << node1->id << " - " << node2->id << ": " << score << endl;
+			nniMoves[cnt].newloglh = score;
+			// compute the pattern likelihoods if wanted
+			if (nniMoves[cnt].ptnlh)
+				computePatternLikelihood(nniMoves[cnt].ptnlh, &score);
+
+			if (save_all_trees == 2) {
+				saveCurrentTree(score); // BQM: for new bootstrap
+			}
+        }
 
         // reorient partial_lh before swap
         if (!isSuperTree()) {
@@ -3890,6 +4012,72 @@ void PhyloTree::regraftSubtree(PruningInfo &info, PhyloNode *in_node, PhyloNode
 
 }
 
+void PhyloTree::moveSubtree(PhyloNode *node, PhyloNode *dad, PhyloNode *node1, PhyloNode *node2,
+        double len1, double len2) {
+    assert(dad->degree() == 3);
+    NeighborVec::iterator dad_it1 = dad->neighbors.end(), dad_it2 = dad->neighbors.end();
+    FOR_NEIGHBOR_IT(dad, node, it)
+        if (dad_it1 == dad->neighbors.end())
+            dad_it1 = it;
+        else
+            dad_it2 = it;
+    PhyloNode *left = (PhyloNode*)(*dad_it1)->node;
+    PhyloNode *right = (PhyloNode*)(*dad_it2)->node;
+    assert(node1 != dad && node2 != dad);
+
+    NeighborVec::iterator left_it = left->findNeighborIt(dad);
+    NeighborVec::iterator right_it = right->findNeighborIt(dad);
+    NeighborVec::iterator node1_it = node1->findNeighborIt(node2);
+    NeighborVec::iterator node2_it = node2->findNeighborIt(node1);
+    PhyloNeighbor *left_dad = (PhyloNeighbor*)*left_it, *right_dad = (PhyloNeighbor*)*right_it;
+    PhyloNeighbor *dad_left = (PhyloNeighbor*)*dad_it1, *dad_right = (PhyloNeighbor*)*dad_it2;
+    PhyloNeighbor *node1_node2 = (PhyloNeighbor*)*node1_it, *node2_node1 = (PhyloNeighbor*)*node2_it;
+
+    // every neighbor keeps pointing to the same node, only its owner changes,
+    // thus the partial likelihood memory stays with the node it belongs to
+    *left_it = dad_right;
+    *right_it = dad_left;
+    *node1_it = left_dad;
+    *node2_it = right_dad;
+    *dad_it1 = node2_node1;
+    *dad_it2 = node1_node2;
+
+    double left_right_len = dad_left->length + dad_right->length;
+    double node12_len = node1_node2->length;
+    if (len1 < 0.0) len1 = node12_len / 2;
+    if (len2 < 0.0) len2 = node12_len - len1;
+
+    dad_right->id = dad_left->id;
+    dad_right->length = dad_left->length = left_right_len;
+    left_dad->id = node2_node1->id;
+    left_dad->length = node2_node1->length = len1;
+    node1_node2->id = right_dad->id;
+    node1_node2->length = right_dad->length = len2;
+
+    // subtrees at left, right, node1 and node2 are unchanged, the ones containing
+    // the old or the new position of dad must be recomputed
+    left_dad->clearPartialLh();
+    right_dad->clearPartialLh();
+    left_dad->size = right_dad->size = 0;
+    PhyloNeighbor *node_dad = (PhyloNeighbor*)node->findNeighbor(dad);
+    node_dad->clearPartialLh();
+    node_dad->size = 0;
+    node->clearReversePartialLh(dad);
+    left->clearReversePartialLh(right);
+    right->clearReversePartialLh(left);
+    node1->clearReversePartialLh(dad);
+    node2->clearReversePartialLh(dad);
+    current_it = current_it_back = NULL;
+}
+
+void PhyloTree::getSPRRegraftBranches(vector<Branch> &branches, int radius, PhyloNode *node, PhyloNode *dad) {
+    FOR_NEIGHBOR_IT(node, dad, it) {
+        branches.push_back(Branch(node, (*it)->node));
+        if (radius > 1)
+            getSPRRegraftBranches(branches, radius - 1, (PhyloNode*) (*it)->node, node);
+    }
+}
+
 /****************************************************************************
  Approximate Likelihood Ratio Test with SH-like interpretation
  ****************************************************************************/
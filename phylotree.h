@@ -45,6 +45,7 @@
 #include "checkpoint.h"
 #include "constrainttree.h"
 #include "memslot.h"
+#include "threadpool.h"
 
 #define BOOT_VAL_FLOAT
 #define BootValType float
@@ -329,10 +330,16 @@ public:
     PhyloNode *dad;
     double *echildren;
     double *partial_lh_leaves;
+    /** repeat representative of each pattern, NULL to compute all patterns */
+    int *ptn_repeat;
+    /** TRUE to read partial_lh back from the spill file instead of computing it */
+    bool page_in;
 
     TraversalInfo(PhyloNeighbor *dad_branch, PhyloNode *dad) {
         this->dad = dad;
         this->dad_branch = dad_branch;
+        ptn_repeat = NULL;
+        page_in = false;
     }
 };
 
@@ -634,6 +641,9 @@ public:
     virtual void setParsimonyKernelAVX() {}
 #else
     virtual void setParsimonyKernelAVX();
+#ifdef INCLUDE_AVX512
+    void setParsimonyKernelAVX512();
+#endif
 #endif
 
     virtual void setParsimonyKernelSSE();
@@ -688,6 +698,37 @@ public:
     size_t getPartialLhBytes();
     size_t getPartialLhSize();
 
+    /**
+        expand single-precision partial likelihoods of VectorClass::size() patterns into a double buffer (-lhfloat)
+        @param partial_lh single-precision partial likelihood vector
+        @param ptn first pattern of the block
+        @param ncat_mix number of rate categories times mixture classes
+        @param nstates number of states
+        @param[out] buffer double buffer of ncat_mix*nstates*VectorClass::size() entries
+        @return buffer
+    */
+    template <class VectorClass>
+    inline double *loadFloatPartialLh(double *partial_lh, size_t ptn, size_t ncat_mix, size_t nstates, double *buffer);
+
+    /**
+        store a double buffer of VectorClass::size() patterns into single-precision partial likelihoods (-lhfloat).
+        Each category of each pattern gets its own binary exponent so that no extra underflow occurs
+        @param buffer double buffer of ncat_mix*nstates*VectorClass::size() entries
+        @param[out] partial_lh single-precision partial likelihood vector
+        @param ptn first pattern of the block
+        @param ncat_mix number of rate categories times mixture classes
+        @param nstates number of states
+    */
+    template <class VectorClass>
+    inline void storeFloatPartialLh(double *buffer, double *partial_lh, size_t ptn, size_t ncat_mix, size_t nstates);
+
+    /**
+        compare the log-likelihood obtained with single-precision partial likelihoods (-lhfloat)
+        against double precision storage and abort if the relative difference exceeds -lhfloat-eps.
+        Called for the initial and the final tree unless -lhfloat-eps is 0, as it recomputes the tree log-likelihood twice.
+    */
+    void checkFloatPartialLh();
+
     /**
             allocate memory for a scale num vector
      */
@@ -740,6 +781,66 @@ public:
     template<class VectorClass>
     void computePartialInfo(TraversalInfo &info, VectorClass* buffer);
 
+    /**
+        compute partial likelihoods of traversal_info as a task graph over (subtree, pattern block),
+        such that independent subtrees are computed concurrently
+        @param limits bounds of pattern blocks
+    */
+    void computePartialLikelihoodDAG(vector<size_t> &limits);
+
+    /**
+        @param nptn number of patterns to compute
+        @return TRUE if there are few patterns per thread (-dag), such that traversal_info
+        should be computed by computePartialLikelihoodDAG()
+    */
+    bool useTraversalDAG(size_t nptn);
+
+    /**
+        compute repeat representatives of patterns for the subtree below info.dad_branch
+        by combining the repeat classes of its children. Two patterns are repeats if they have
+        identical states at all leaves of the subtree and the same invariant status, thus
+        identical partial likelihoods and scale_num.
+        @param info traversal information, info.ptn_repeat is set accordingly
+        @param max_orig_nptn number of alignment patterns padded to vector size
+        @param nptn number of all patterns padded to vector size
+    */
+    void computeSiteRepeats(TraversalInfo &info, size_t max_orig_nptn, size_t nptn);
+
+    /**
+        gather partial likelihoods of VectorClass::size() arbitrary patterns into a double buffer
+        @param partial_lh partial likelihood vector (single precision with -lhfloat)
+        @param lane_ptn pattern of each vector lane
+        @param ncat_mix number of rate categories times mixture classes
+        @param nstates number of states
+        @param[out] buffer double buffer of ncat_mix*nstates*VectorClass::size() entries
+        @return buffer
+    */
+    template <class VectorClass>
+    inline double *gatherPartialLh(double *partial_lh, size_t *lane_ptn, size_t ncat_mix, size_t nstates, double *buffer);
+
+    /**
+        reverse of gatherPartialLh()
+        @param buffer double buffer of ncat_mix*nstates*VectorClass::size() entries
+        @param[out] partial_lh partial likelihood vector (single precision with -lhfloat)
+        @param lane_ptn pattern of each vector lane
+        @param ncat_mix number of rate categories times mixture classes
+        @param nstates number of states
+    */
+    template <class VectorClass>
+    inline void scatterPartialLh(double *buffer, double *partial_lh, size_t *lane_ptn, size_t ncat_mix, size_t nstates);
+
+    /**
+        copy partial_lh and scale_num of repeated patterns from their representatives
+        @param dad_branch branch whose partial_lh was computed for the representatives
+        @param ptn_repeat repeat representative of each pattern
+        @param ptn_lower first pattern computed by the current thread
+        @param ptn_upper last pattern computed by the current thread (exclusive)
+        @param ncat_mix number of rate categories times mixture classes
+        @param nstates number of states
+    */
+    template <class VectorClass, const bool SAFE_NUMERIC>
+    inline void copyRepeatPartialLh(PhyloNeighbor *dad_branch, int *ptn_repeat, size_t ptn_lower, size_t ptn_upper, size_t ncat_mix, size_t nstates);
+
     /** 
         sort neighbor in descending order of subtree size (number of leaves within subree)
         @param node the starting node, NULL to start from the root
@@ -772,8 +873,6 @@ public:
     //template <const int nstates>
 //    void computePartialLikelihoodEigen(PhyloNeighbor *dad_branch, PhyloNode *dad = NULL);
 
-//    void computeSitemodelPartialLikelihoodEigen(PhyloNeighbor *dad_branch, PhyloNode *dad = NULL);
-
 //    template <class VectorClass, const int VCSIZE, const int nstates>
 //    void computePartialLikelihoodEigenSIMD(PhyloNeighbor *dad_branch, PhyloNode *dad = NULL);
 
@@ -783,17 +882,6 @@ public:
     template <class VectorClass, const bool SAFE_NUMERIC, const bool FMA = false, const bool SITE_MODEL = false>
     void computePartialLikelihoodGenericSIMD(TraversalInfo &info, size_t ptn_left, size_t ptn_right, int thread_id);
 
-    /*
-    template <class VectorClass, const int VCSIZE, const int nstates>
-    void computeMixratePartialLikelihoodEigenSIMD(PhyloNeighbor *dad_branch, PhyloNode *dad = NULL);
-
-    template <class VectorClass, const int VCSIZE, const int nstates>
-    void computeMixturePartialLikelihoodEigenSIMD(PhyloNeighbor *dad_branch, PhyloNode *dad = NULL);
-
-    template <class VectorClass, const int VCSIZE, const int nstates>
-    void computeSitemodelPartialLikelihoodEigenSIMD(PhyloNeighbor *dad_branch, PhyloNode *dad = NULL);
-    */
-
     /****************************************************************************
             computing likelihood on a branch
      ****************************************************************************/
@@ -819,8 +907,6 @@ public:
     //template <const int nstates>
 //    double computeLikelihoodBranchEigen(PhyloNeighbor *dad_branch, PhyloNode *dad);
 
-//    double computeSitemodelLikelihoodBranchEigen(PhyloNeighbor *dad_branch, PhyloNode *dad);
-
 //    template <class VectorClass, const int VCSIZE, const int nstates>
 //    double computeLikelihoodBranchEigenSIMD(PhyloNeighbor *dad_branch, PhyloNode *dad);
 
@@ -830,17 +916,6 @@ public:
     template <class VectorClass, const bool SAFE_NUMERIC, const bool FMA = false, const bool SITE_MODEL = false>
     double computeLikelihoodBranchGenericSIMD(PhyloNeighbor *dad_branch, PhyloNode *dad);
 
-    /*
-    template <class VectorClass, const int VCSIZE, const int nstates>
-    double computeMixrateLikelihoodBranchEigenSIMD(PhyloNeighbor *dad_branch, PhyloNode *dad);
-
-    template <class VectorClass, const int VCSIZE, const int nstates>
-    double computeMixtureLikelihoodBranchEigenSIMD(PhyloNeighbor *dad_branch, PhyloNode *dad);
-
-    template <class VectorClass, const int VCSIZE, const int nstates>
-    double computeSitemodelLikelihoodBranchEigenSIMD(PhyloNeighbor *dad_branch, PhyloNode *dad);
-    */
-
     /****************************************************************************
             computing likelihood on a branch using buffer
      ****************************************************************************/
@@ -865,19 +940,6 @@ public:
     template <class VectorClass, const bool SAFE_NUMERIC, const bool FMA = false, const bool SITE_MODEL = false>
     double computeLikelihoodFromBufferGenericSIMD();
 
-    /*
-    template <class VectorClass, const int VCSIZE, const int nstates>
-    double computeMixrateLikelihoodFromBufferEigenSIMD();
-
-    template <class VectorClass, const int VCSIZE, const int nstates>
-    double computeMixtureLikelihoodFromBufferEigenSIMD();
-
-    template <class VectorClass, const int VCSIZE, const int nstates>
-    double computeSitemodelLikelihoodFromBufferEigenSIMD();
-
-    double computeSitemodelLikelihoodFromBufferEigen();
-    */
-
     /**
             compute tree likelihood when a branch length collapses to zero
             @param dad_branch the branch leading to the subtree
@@ -1116,8 +1178,6 @@ public:
     //template <const int nstates>
 //    void computeLikelihoodDervEigen(PhyloNeighbor *dad_branch, PhyloNode *dad, double &df, double &ddf);
 
-//    void computeSitemodelLikelihoodDervEigen(PhyloNeighbor *dad_branch, PhyloNode *dad, double &df, double &ddf);
-
 //    template <class VectorClass, const int VCSIZE, const int nstates>
 //    void computeLikelihoodDervEigenSIMD(PhyloNeighbor *dad_branch, PhyloNode *dad, double &df, double &ddf);
 
@@ -1134,17 +1194,6 @@ public:
     template <class VectorClass, const bool SAFE_NUMERIC, const bool FMA = false, const bool SITE_MODEL = false>
     void computeLikelihoodDervGenericSIMD(PhyloNeighbor *dad_branch, PhyloNode *dad, double &df, double &ddf);
 
-    /*
-    template <class VectorClass, const int VCSIZE, const int nstates>
-    void computeMixrateLikelihoodDervEigenSIMD(PhyloNeighbor *dad_branch, PhyloNode *dad, double &df, double &ddf);
-
-    template <class VectorClass, const int VCSIZE, const int nstates>
-    void computeMixtureLikelihoodDervEigenSIMD(PhyloNeighbor *dad_branch, PhyloNode *dad, double &df, double &ddf);
-
-    template <class VectorClass, const int VCSIZE, const int nstates>
-    void computeSitemodelLikelihoodDervEigenSIMD(PhyloNeighbor *dad_branch, PhyloNode *dad, double &df, double &ddf);
-    */
-
     /**
             compute tree likelihood and derivatives on a branch. used to optimize branch length
             @param dad_branch the branch leading to the subtree
@@ -1158,6 +1207,28 @@ public:
     typedef void (PhyloTree::*ComputeLikelihoodDervType)(PhyloNeighbor *, PhyloNode *, double &, double &);
     ComputeLikelihoodDervType computeLikelihoodDervPointer;
 
+    template <class VectorClass, const bool SAFE_NUMERIC, const int nstates, const bool FMA = false, const bool SITE_MODEL = false>
+    void computeLikelihoodDervMultiSIMD(PhyloNeighbor *dad_branch, PhyloNode *dad, int num_len, double *len, double *lh, double *df, double *ddf);
+
+    template <class VectorClass, const bool SAFE_NUMERIC, const bool FMA = false, const bool SITE_MODEL = false>
+    void computeLikelihoodDervMultiGenericSIMD(PhyloNeighbor *dad_branch, PhyloNode *dad, int num_len, double *len, double *lh, double *df, double *ddf);
+
+    /**
+            compute tree likelihood and derivatives on a branch for several branch lengths at once,
+            reading the likelihood buffer theta_all only once for all of them
+            @param dad_branch the branch leading to the subtree
+            @param dad its dad, used to direct the tranversal
+            @param num_len number of branch lengths
+            @param len branch lengths
+            @param lh (OUT) tree log-likelihood for each branch length
+            @param df (OUT) first derivative for each branch length
+            @param ddf (OUT) second derivative for each branch length
+     */
+    void computeLikelihoodDervMulti(PhyloNeighbor *dad_branch, PhyloNode *dad, int num_len, double *len, double *lh, double *df, double *ddf);
+
+    typedef void (PhyloTree::*ComputeLikelihoodDervMultiType)(PhyloNeighbor *, PhyloNode *, int, double *, double *, double *, double *);
+    ComputeLikelihoodDervMultiType computeLikelihoodDervMultiPointer;
+
     /****************************************************************************
             Stepwise addition (greedy) by maximum parsimony
      ****************************************************************************/
@@ -1182,9 +1253,45 @@ public:
      * FAST VERSION: compute parsimony tree by step-wise addition
      * @param out_prefix prefix for .parstree file
      * @param alignment input alignment
+     * @param rstream random stream for the taxon addition order, NULL for the global stream
+     * @return parsimony score
+     */
+    int computeParsimonyTree(const char *out_prefix, Alignment *alignment, int *rstream = NULL);
+
+    /**
+     * FAST VERSION: improve the parsimony tree by subtree pruning and regrafting (SPR).
+     * Only the partial parsimony vectors invalidated by a pruning or regrafting are recomputed.
+     * @param radius maximal distance of the regraft positions from the pruned branch
      * @return parsimony score
      */
-    int computeParsimonyTree(const char *out_prefix, Alignment *alignment);
+    int optimizeParsimonySPR(int radius);
+
+    /**
+     * FAST VERSION: used internally by optimizeParsimonySPR() to move a subtree to its best position
+     * @param node root of the subtree
+     * @param dad the node connecting the subtree to the rest of the tree
+     * @param radius maximal distance of the regraft positions from the pruned branch
+     * @param score (IN/OUT) parsimony score of the tree
+     * @return TRUE if the subtree was moved to a better position, FALSE if the tree is unchanged
+     */
+    bool regraftParsimonySPR(PhyloNode *node, PhyloNode *dad, int radius, int &score);
+
+    /**
+     * take dad out of its branches to left and right, which are merged into the branch left-right.
+     * The free neighbors of dad then point to (Node*)1 and (Node*)2 as in computeParsimonyTree().
+     * @param dad the node to take out, must have degree 3
+     * @param left one neighbor of dad
+     * @param right another neighbor of dad
+     */
+    void pruneSubtreeMP(PhyloNode *dad, PhyloNode *left, PhyloNode *right);
+
+    /**
+     * insert a node pruned by pruneSubtreeMP() into the branch target_node-target_dad
+     * @param dad the pruned node
+     * @param target_node one end of the branch
+     * @param target_dad the other end of the branch
+     */
+    void insertSubtreeMP(PhyloNode *dad, PhyloNode *target_node, PhyloNode *target_dad);
 
 
     /****************************************************************************
@@ -1254,6 +1361,21 @@ public:
      */
     virtual void computeFuncDerv(double value, double &df, double &ddf);
 
+    /**
+            Inherited from Optimization class.
+            Evaluate negative log-likelihood and its derivatives for several lengths of the
+            current branch with one pass over the likelihood buffer.
+            Used by Brent's method (-brent) for the initial bracket and by the reset of a
+            diverged Newton-Raphson step; minimizeNewton() needs the derivatives of one step
+            before it can choose the next length, thus it still evaluates one length per pass.
+            @param num number of branch lengths
+            @param values branch lengths
+            @param fvalues (OUT) negative log-likelihoods
+            @param df (OUT) first derivatives, NULL if not needed
+            @param ddf (OUT) second derivatives, NULL if not needed
+     */
+    virtual void computeFuncDervMulti(int num, double *values, double *fvalues, double *df, double *ddf);
+
     /**
         optimize the scaling factor for tree length, given all branch lengths fixed
         @param scaling (IN/OUT) start value of scaling factor, and as output the optimal value
@@ -1299,6 +1421,24 @@ public:
     /** buffer used when computing partial_lh, to avoid repeated mem allocation */
     double *buffer_partial_lh;
 
+    /** per-thread buffer to expand single-precision partial_lh into double (-lhfloat) */
+    double *float_lh_buffer;
+
+    /** per-thread buffer to gather patterns with repeats in the subtree into vectors */
+    double *repeat_lh_buffer;
+
+    /** offset (in floats) of the binary exponents inside a single-precision partial_lh vector */
+    size_t float_lh_exp_offset;
+
+    /** buffers of leaf classes, class table and sort order for computeSiteRepeats() */
+    vector<int> repeat_leaf_class, repeat_table, repeat_order;
+
+    /** last stamp given to SiteRepeats */
+    int repeat_stamp;
+
+    /** SiteRepeats with stamp up to this value are outdated, e.g. after ptn_invar changed */
+    int repeat_valid_stamp;
+
     /**
      * frequencies of alignment patterns, used as buffer for likelihood computation
      */
@@ -1374,9 +1514,10 @@ public:
     /**
     *   Get a random NNI from an internal branch, checking for consistency with constraintTree
     *   @param branch the internal branch
+    *   @param rstream random number stream, NULL for the global stream
     *   @return an NNIMove, node1 and node2 are set to NULL if not consistent with constraintTree
     */
-    NNIMove getRandomNNI(Branch& branch);
+    NNIMove getRandomNNI(Branch& branch, int *rstream = NULL);
 
 
     /**
@@ -1556,6 +1697,31 @@ public:
     void regraftSubtree(PruningInfo &info,
             PhyloNode *in_node, PhyloNode *in_dad);
 
+    /**
+            move the subtree rooted at node from its current position to the branch (node1-node2).
+            dad is taken out of its two other branches, which are merged, and inserted into (node1-node2).
+            Partial likelihoods are only cleared along the paths to the old and new position of dad,
+            so that evaluating the new position reuses the partial likelihoods of the moved subtree.
+            Splits stored in the neighbors are not updated.
+            @param node root of the subtree to move
+            @param dad neighbor of node connecting the subtree to the rest of the tree, must have degree 3
+            @param node1 one end node of the regraft branch, outside the subtree
+            @param node2 the other end node of the regraft branch
+            @param len1 length of the new branch (dad-node1), default: half of the regraft branch
+            @param len2 length of the new branch (dad-node2), default: the rest of the regraft branch
+     */
+    void moveSubtree(PhyloNode *node, PhyloNode *dad, PhyloNode *node1, PhyloNode *node2,
+            double len1 = -1.0, double len2 = -1.0);
+
+    /**
+            collect the branches at most \a radius branches away from node, in depth-first order
+            @param branches (OUT) the branches
+            @param radius maximal distance of the branches
+            @param node the starting node
+            @param dad dad of the node, used to direct the search
+     */
+    void getSPRRegraftBranches(vector<Branch> &branches, int radius, PhyloNode *node, PhyloNode *dad);
+
     /****************************************************************************
             Approximate Likelihood Ratio Test with SH-like interpretation
      ****************************************************************************/
@@ -1779,6 +1945,13 @@ public:
 
     void getMemoryRequired(uint64_t &partial_lh_entries, uint64_t &scale_num_entries, uint64_t &partial_pars_entries);
 
+    /**
+     * print allocation, eviction and recomputation counts of the memory saving mode
+     */
+    void reportMemSlots(ostream &out) {
+        mem_slots.report(out);
+    }
+
     /****** following variables are for ultra-fast bootstrap *******/
     /** 2 to save all trees, 1 to save intermediate trees */
     int save_all_trees;
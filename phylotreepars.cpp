@@ -319,7 +319,7 @@ void PhyloTree::computeAllPartialPars(PhyloNode *node, PhyloNode *dad) {
 // pointer object to it:
 //ptrdiff_t (*p_myrandom)(ptrdiff_t) = myrandom;
 
-int PhyloTree::computeParsimonyTree(const char *out_prefix, Alignment *alignment) {
+int PhyloTree::computeParsimonyTree(const char *out_prefix, Alignment *alignment, int *rstream) {
     aln = alignment;
     int size = aln->getNSeq();
     if (size < 3)
@@ -334,7 +334,7 @@ int PhyloTree::computeParsimonyTree(const char *out_prefix, Alignment *alignment
         for (int i = 0; i < size; i++)
             taxon_order[i] = i;
         // randomize the addition order
-        my_random_shuffle(taxon_order.begin(), taxon_order.end());
+        my_random_shuffle(taxon_order.begin(), taxon_order.end(), rstream);
 
         root = newNode(size);
 
@@ -381,8 +381,8 @@ int PhyloTree::computeParsimonyTree(const char *out_prefix, Alignment *alignment
                 taxon_order.push_back(i);
             }
         // randomize the addition order
-        my_random_shuffle(taxon_order.begin()+leafNum, taxon_order.begin()+constraintTree.leafNum);
-        my_random_shuffle(taxon_order.begin()+constraintTree.leafNum, taxon_order.end());
+        my_random_shuffle(taxon_order.begin()+leafNum, taxon_order.begin()+constraintTree.leafNum, rstream);
+        my_random_shuffle(taxon_order.begin()+constraintTree.leafNum, taxon_order.end(), rstream);
 
     }
     root = findNodeID(taxon_order[0]);
@@ -466,6 +466,8 @@ int PhyloTree::computeParsimonyTree(const char *out_prefix, Alignment *alignment
     initializeTree();
 
     setAlignment(alignment);
+    if (Params::getInstance().pars_spr && Params::getInstance().sprDist > 0)
+        best_pars_score = optimizeParsimonySPR(Params::getInstance().sprDist);
 //    initializeAllPartialPars();
 //    clearAllPartialLH();
     fixNegativeBranch(true);
@@ -499,7 +501,7 @@ int PhyloTree::addTaxonMPFast(Node *added_taxon, Node* added_node, Node* node, N
         ((PhyloNeighbor*) node->findNeighbor(added_node))->partial_lh_computed;
     // compute the likelihood
     ((PhyloNeighbor*) added_taxon->findNeighbor(added_node))->clearPartialLh();
-    int score = computeParsimonyBranch((PhyloNeighbor*) added_node->neighbors[0], (PhyloNode*) added_node);
+    int score = computeParsimonyBranch((PhyloNeighbor*) added_node->findNeighbor(added_taxon), (PhyloNode*) added_node);
     if (leafNum < constraintTree.leafNum) {
         // still during addition of taxa from constraint tree
         if (!constraintTree.isCompatible(this))
@@ -523,3 +525,127 @@ int PhyloTree::addTaxonMPFast(Node *added_taxon, Node* added_node, Node* node, N
     return score;
 
 }
+
+/****************************************************************************
+ Subtree Pruning and Regrafting by maximum parsimony
+ ****************************************************************************/
+
+int PhyloTree::optimizeParsimonySPR(int radius) {
+    best_pars_score = INT_MAX;
+    int score = computeParsimony();
+    int num_rounds = 0;
+    while (true) {
+        NodeVector nodes1, nodes2;
+        getBranches(nodes1, nodes2);
+        int num_moves = 0;
+        for (int i = 0; i < nodes1.size(); i++)
+            for (int j = 0; j < 2; j++) {
+                // prune the subtree on either side of the branch
+                PhyloNode *node = (PhyloNode*) (j == 0 ? nodes1[i] : nodes2[i]);
+                PhyloNode *dad = (PhyloNode*) (j == 0 ? nodes2[i] : nodes1[i]);
+                // the branch may be gone after a previous move
+                if (dad->degree() != 3 || !node->isNeighbor(dad))
+                    continue;
+                if (regraftParsimonySPR(node, dad, radius, score))
+                    num_moves++;
+            }
+        num_rounds++;
+        if (verbose_mode >= VB_MAX)
+            cout << "Parsimony SPR round " << num_rounds << ": " << num_moves << " moves, score = " << score << endl;
+        if (num_moves == 0)
+            break;
+    }
+    return score;
+}
+
+bool PhyloTree::regraftParsimonySPR(PhyloNode *node, PhyloNode *dad, int radius, int &score) {
+    PhyloNode *left = NULL, *right = NULL;
+    FOR_NEIGHBOR_IT(dad, node, it)
+        if (!left)
+            left = (PhyloNode*) (*it)->node;
+        else
+            right = (PhyloNode*) (*it)->node;
+
+    pruneSubtreeMP(dad, left, right);
+    // addTaxonMPFast() redirects the free neighbors of dad to the partial parsimony of the target branch
+    PhyloNeighbor *free_nei1 = (PhyloNeighbor*) dad->findNeighbor((Node*) 1);
+    PhyloNeighbor *free_nei2 = (PhyloNeighbor*) dad->findNeighbor((Node*) 2);
+    UINT *free_pars1 = free_nei1->partial_pars;
+    UINT *free_pars2 = free_nei2->partial_pars;
+
+    // the original position comes first, thus a move must strictly improve the score
+    vector<Branch> regrafts;
+    regrafts.push_back(Branch(left, right));
+    getSPRRegraftBranches(regrafts, radius, left, right);
+    getSPRRegraftBranches(regrafts, radius, right, left);
+
+    // consecutive positions are neighbors, thus only few partial parsimony vectors are recomputed per position
+    best_pars_score = INT_MAX;
+    int best = 0;
+    for (int i = 0; i < regrafts.size(); i++) {
+        int new_score = addTaxonMPFast(node, dad, regrafts[i].first, regrafts[i].second);
+        if (new_score < best_pars_score) {
+            best_pars_score = new_score;
+            best = i;
+        }
+    }
+    free_nei1->partial_pars = free_pars1;
+    free_nei2->partial_pars = free_pars2;
+
+    insertSubtreeMP(dad, (PhyloNode*) regrafts[best].first, (PhyloNode*) regrafts[best].second);
+    if (best != 0 && !constraintTree.empty() && !constraintTree.isCompatible(this)) {
+        // go back to the original position
+        pruneSubtreeMP(dad, (PhyloNode*) regrafts[best].first, (PhyloNode*) regrafts[best].second);
+        insertSubtreeMP(dad, left, right);
+        best = 0;
+    }
+    ((PhyloNeighbor*) node->findNeighbor(dad))->clearPartialLh();
+    if (best == 0)
+        return false;
+    // the subtree now sees a different rest of the tree
+    node->clearReversePartialLh(dad);
+    score = best_pars_score;
+    return true;
+}
+
+void PhyloTree::pruneSubtreeMP(PhyloNode *dad, PhyloNode *left, PhyloNode *right) {
+    PhyloNeighbor *dad_left = (PhyloNeighbor*) dad->findNeighbor(left);
+    PhyloNeighbor *dad_right = (PhyloNeighbor*) dad->findNeighbor(right);
+    left->updateNeighbor(dad, right, -1.0);
+    right->updateNeighbor(dad, left, -1.0);
+    dad->updateNeighbor(left, (Node*) 1, -1.0);
+    dad->updateNeighbor(right, (Node*) 2, -1.0);
+
+    // the subtrees at left and right seen from dad are unchanged by the pruning
+    PhyloNeighbor *left_right = (PhyloNeighbor*) left->findNeighbor(right);
+    PhyloNeighbor *right_left = (PhyloNeighbor*) right->findNeighbor(left);
+    swap(left_right->partial_pars, dad_right->partial_pars);
+    swap(left_right->partial_lh_computed, dad_right->partial_lh_computed);
+    swap(right_left->partial_pars, dad_left->partial_pars);
+    swap(right_left->partial_lh_computed, dad_left->partial_lh_computed);
+    dad_left->clearPartialLh();
+    dad_right->clearPartialLh();
+    left->clearReversePartialLh(right);
+    right->clearReversePartialLh(left);
+}
+
+void PhyloTree::insertSubtreeMP(PhyloNode *dad, PhyloNode *target_node, PhyloNode *target_dad) {
+    target_node->updateNeighbor(target_dad, dad, -1.0);
+    target_dad->updateNeighbor(target_node, dad, -1.0);
+    dad->updateNeighbor((Node*) 1, target_node, -1.0);
+    dad->updateNeighbor((Node*) 2, target_dad, -1.0);
+
+    // the subtrees at target_node and target_dad seen from dad are those seen from each other before
+    PhyloNeighbor *dad_node = (PhyloNeighbor*) dad->findNeighbor(target_node);
+    PhyloNeighbor *dad_dad = (PhyloNeighbor*) dad->findNeighbor(target_dad);
+    PhyloNeighbor *node_dad = (PhyloNeighbor*) target_node->findNeighbor(dad);
+    PhyloNeighbor *dad_node_back = (PhyloNeighbor*) target_dad->findNeighbor(dad);
+    swap(dad_dad->partial_pars, node_dad->partial_pars);
+    swap(dad_dad->partial_lh_computed, node_dad->partial_lh_computed);
+    swap(dad_node->partial_pars, dad_node_back->partial_pars);
+    swap(dad_node->partial_lh_computed, dad_node_back->partial_lh_computed);
+    node_dad->clearPartialLh();
+    dad_node_back->clearPartialLh();
+    target_node->clearReversePartialLh(dad);
+    target_dad->clearReversePartialLh(dad);
+}
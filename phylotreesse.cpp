@@ -28,13 +28,11 @@
 #endif
 
 //#include "phylokernel.h"
-//#include "phylokernelmixture.h"
-//#include "phylokernelmixrate.h"
-//#include "phylokernelsitemodel.h"
 
 #include "model/modelgtr.h"
 #include "model/modelset.h"
 
+
 /* BQM: to ignore all-gapp subtree at an alignment site */
 //#define IGNORE_GAP_LH
 
@@ -47,6 +45,12 @@ void PhyloTree::setParsimonyKernel(LikelihoodKernel lk) {
         computePartialParsimonyPointer = &PhyloTree::computePartialParsimonyFast;
     	return;
     }
+#ifdef INCLUDE_AVX512
+    if (instruction_set >= 9) {
+        setParsimonyKernelAVX512();
+        return;
+    }
+#endif
     if (instruction_set >= 7) {
         setParsimonyKernelAVX();
         return;
@@ -94,12 +98,14 @@ void PhyloTree::setLikelihoodKernel(LikelihoodKernel lk, int num_threads) {
 #if INSTRSET < 2
         computeLikelihoodBranchPointer = &PhyloTree::computeLikelihoodBranchGenericSIMD<Vec1d, SAFE_LH>;
         computeLikelihoodDervPointer = &PhyloTree::computeLikelihoodDervGenericSIMD<Vec1d, SAFE_LH>;
+        computeLikelihoodDervMultiPointer = &PhyloTree::computeLikelihoodDervMultiGenericSIMD<Vec1d, SAFE_LH>;
         computePartialLikelihoodPointer = &PhyloTree::computePartialLikelihoodGenericSIMD<Vec1d, SAFE_LH>;
         computeLikelihoodFromBufferPointer = &PhyloTree::computeLikelihoodFromBufferGenericSIMD<Vec1d, SAFE_LH>;
         sse = LK_EIGEN;
 #else
         computeLikelihoodBranchPointer = NULL;
         computeLikelihoodDervPointer = NULL;
+        computeLikelihoodDervMultiPointer = NULL;
         computePartialLikelihoodPointer = NULL;
         computeLikelihoodFromBufferPointer = NULL;
         sse = LK_EIGEN;
@@ -133,6 +139,7 @@ void PhyloTree::setLikelihoodKernel(LikelihoodKernel lk, int num_threads) {
     if (model_factory && model_factory->model->isSiteSpecificModel()) {
         computeLikelihoodBranchPointer = &PhyloTree::computeLikelihoodBranchGenericSIMD<Vec1d, SAFE_LH, false, true>;
         computeLikelihoodDervPointer = &PhyloTree::computeLikelihoodDervGenericSIMD<Vec1d, SAFE_LH, false, true>;
+        computeLikelihoodDervMultiPointer = &PhyloTree::computeLikelihoodDervMultiGenericSIMD<Vec1d, SAFE_LH, false, true>;
         computePartialLikelihoodPointer = &PhyloTree::computePartialLikelihoodGenericSIMD<Vec1d, SAFE_LH, false, true>;
         computeLikelihoodFromBufferPointer = &PhyloTree::computeLikelihoodFromBufferGenericSIMD<Vec1d, SAFE_LH, false, true>;
         return;
@@ -141,11 +148,13 @@ void PhyloTree::setLikelihoodKernel(LikelihoodKernel lk, int num_threads) {
     //--- naive (no SIMD) kernel ---
     computeLikelihoodBranchPointer = &PhyloTree::computeLikelihoodBranchGenericSIMD<Vec1d, SAFE_LH>;
     computeLikelihoodDervPointer = &PhyloTree::computeLikelihoodDervGenericSIMD<Vec1d, SAFE_LH>;
+    computeLikelihoodDervMultiPointer = &PhyloTree::computeLikelihoodDervMultiGenericSIMD<Vec1d, SAFE_LH>;
     computePartialLikelihoodPointer = &PhyloTree::computePartialLikelihoodGenericSIMD<Vec1d, SAFE_LH>;
     computeLikelihoodFromBufferPointer = &PhyloTree::computeLikelihoodFromBufferGenericSIMD<Vec1d, SAFE_LH>;
 #else
     computeLikelihoodBranchPointer = NULL;
     computeLikelihoodDervPointer = NULL;
+    computeLikelihoodDervMultiPointer = NULL;
     computePartialLikelihoodPointer = NULL;
     computeLikelihoodFromBufferPointer = NULL;
 #endif
@@ -166,6 +175,265 @@ void PhyloTree::computePartialLikelihood(TraversalInfo &info, size_t ptn_left, s
 	(this->*computePartialLikelihoodPointer)(info, ptn_left, ptn_right, thread_id);
 }
 
+bool PhyloTree::useTraversalDAG(size_t nptn) {
+    return num_threads > 1 && traversal_info.size() > 1 && nptn <= (size_t)params->lk_dag_max_ptn*num_threads;
+}
+
+void PhyloTree::computePartialLikelihoodDAG(vector<size_t> &limits) {
+    int num_info = traversal_info.size();
+    int num_blocks = limits.size()-1;
+    int i, j;
+
+    // dependencies between traversal_info, keyed by partial_lh vectors:
+    // read-after-write for children, write-after-write and write-after-read
+    // for mem_slots reused within the traversal (memory saving mode)
+    vector<IntVector> dependents(num_info);
+    IntVector num_deps(num_info, 0);
+    map<double*, int> last_writer;
+    map<double*, IntVector> readers;
+
+    for (i = 0; i < num_info; i++) {
+        PhyloNeighbor *dad_branch = traversal_info[i].dad_branch;
+        PhyloNode *dad = traversal_info[i].dad;
+        FOR_NEIGHBOR_IT(dad_branch->node, dad, it) {
+            PhyloNeighbor *child = (PhyloNeighbor*)*it;
+            // partial_lh paged in from the spill file does not read the children
+            if (child->node->isLeaf() || !child->partial_lh || traversal_info[i].page_in)
+                continue;
+            map<double*, int>::iterator w = last_writer.find(child->partial_lh);
+            if (w != last_writer.end()) {
+                dependents[w->second].push_back(i);
+                num_deps[i]++;
+            }
+            readers[child->partial_lh].push_back(i);
+        }
+        double *out = dad_branch->partial_lh;
+        map<double*, int>::iterator w = last_writer.find(out);
+        if (w != last_writer.end()) {
+            dependents[w->second].push_back(i);
+            num_deps[i]++;
+        }
+        IntVector &out_readers = readers[out];
+        for (IntVector::iterator r = out_readers.begin(); r != out_readers.end(); r++)
+            if (*r != i) {
+                dependents[*r].push_back(i);
+                num_deps[i]++;
+            }
+        out_readers.clear();
+        last_writer[out] = i;
+    }
+
+    // task (info, block) only depends on tasks of the same pattern block
+    int num_tasks = num_info*num_blocks;
+    IntVector pending(num_tasks);
+    IntVector ready;
+    ready.reserve(num_tasks);
+    for (i = num_info-1; i >= 0; i--)
+        for (j = 0; j < num_blocks; j++) {
+            pending[i*num_blocks+j] = num_deps[i];
+            if (num_deps[i] == 0)
+                ready.push_back(i*num_blocks+j);
+        }
+    int num_done = 0;
+    mutex dag_mutex;
+
+    // each participant owns a slot of the per-thread buffers
+    ThreadPool::getInstance().run(min(num_threads, num_tasks), [&](int thread_id) {
+        while (true) {
+            int task = -1;
+            bool finished;
+            {
+                lock_guard<mutex> guard(dag_mutex);
+                if (!ready.empty()) {
+                    // LIFO order follows a subtree upwards while its blocks are still in cache
+                    task = ready.back();
+                    ready.pop_back();
+                }
+                finished = (num_done == num_tasks);
+            }
+            if (task < 0) {
+                if (finished) break;
+                this_thread::yield();
+                continue;
+            }
+            int info = task / num_blocks;
+            int block = task % num_blocks;
+            computePartialLikelihood(traversal_info[info], limits[block], limits[block+1], thread_id);
+            {
+                lock_guard<mutex> guard(dag_mutex);
+                num_done++;
+                for (IntVector::iterator it = dependents[info].begin(); it != dependents[info].end(); it++)
+                    if (--pending[(*it)*num_blocks+block] == 0)
+                        ready.push_back((*it)*num_blocks+block);
+            }
+        }
+    });
+    assert(num_done == num_tasks);
+}
+
+/**
+    combine the pattern classes of two subtrees and the invariant status into the classes of their parent
+    @param cls1 class of each pattern in the first subtree
+    @param num_cls1 number of classes in cls1
+    @param cls2 class of each pattern in the second subtree
+    @param num_cls2 number of classes in cls2
+    @param ptn_invar probability of each pattern to be invariant
+    @param[out] rep parent classes (ptn_class, ptn_repeat, num_class)
+    @param table dense table of combined classes, all entries must be -1 and remain so
+    @param order buffer for sorting patterns
+*/
+static void combineRepeatClasses(int *cls1, int num_cls1, int *cls2, int num_cls2, double *ptn_invar,
+    size_t nptn, SiteRepeats &rep, vector<int> &table, vector<int> &order)
+{
+    size_t ptn;
+    // scaling is only done for non-invariant sites, thus the invariant status is part of the class
+    num_cls2 *= 2;
+    rep.ptn_class.resize(nptn);
+    rep.ptn_repeat.resize(nptn);
+    int *ptn_class = &rep.ptn_class[0], *ptn_repeat = &rep.ptn_repeat[0];
+    int num_combined = 0;
+    uint64_t table_size = (uint64_t)num_cls1 * num_cls2;
+    if (table_size <= 16*nptn + 1024) {
+        // dense table of (class, representative), reset entries afterwards
+        if (table.size() < table_size)
+            table.resize(table_size, -1);
+        order.resize(nptn);
+        int *first = &order[0];
+        for (ptn = 0; ptn < nptn; ptn++) {
+            int key = cls1[ptn]*num_cls2 + cls2[ptn]*2 + (ptn_invar[ptn] == 0.0);
+            int &id = table[key];
+            if (id < 0) {
+                first[num_combined] = ptn;
+                id = num_combined++;
+            }
+            ptn_class[ptn] = id;
+            ptn_repeat[ptn] = first[id];
+        }
+        for (ptn = 0; ptn < nptn; ptn++)
+            table[cls1[ptn]*num_cls2 + cls2[ptn]*2 + (ptn_invar[ptn] == 0.0)] = -1;
+        rep.num_class = num_combined;
+        return;
+    }
+    // otherwise stable counting sort of patterns by (cls1, cls2, invariant)
+    order.resize(2*nptn + max(num_cls1, num_cls2) + 1);
+    int *sorted = &order[0], *sorted2 = sorted + nptn, *count = sorted2 + nptn;
+    int i;
+    // ptn_repeat temporarily holds the second key
+    for (ptn = 0; ptn < nptn; ptn++)
+        ptn_repeat[ptn] = cls2[ptn]*2 + (ptn_invar[ptn] == 0.0);
+    memset(count, 0, sizeof(int)*(num_cls2+1));
+    for (ptn = 0; ptn < nptn; ptn++)
+        count[ptn_repeat[ptn]+1]++;
+    for (i = 0; i < num_cls2; i++)
+        count[i+1] += count[i];
+    for (ptn = 0; ptn < nptn; ptn++)
+        sorted2[count[ptn_repeat[ptn]]++] = ptn;
+    memset(count, 0, sizeof(int)*(num_cls1+1));
+    for (ptn = 0; ptn < nptn; ptn++)
+        count[cls1[ptn]+1]++;
+    for (i = 0; i < num_cls1; i++)
+        count[i+1] += count[i];
+    for (ptn = 0; ptn < nptn; ptn++)
+        sorted[count[cls1[sorted2[ptn]]]++] = sorted2[ptn];
+    // consecutive patterns with equal keys form a class, the first one has the lowest index
+    int prev = -1, first = -1;
+    for (ptn = 0; ptn < nptn; ptn++) {
+        int cur = sorted[ptn];
+        if (prev < 0 || cls1[cur] != cls1[prev] || ptn_repeat[cur] != ptn_repeat[prev]) {
+            num_combined++;
+            first = cur;
+        }
+        ptn_class[cur] = num_combined-1;
+        sorted2[ptn] = first;
+        prev = cur;
+    }
+    for (ptn = 0; ptn < nptn; ptn++)
+        ptn_repeat[sorted[ptn]] = sorted2[ptn];
+    rep.num_class = num_combined;
+}
+
+void PhyloTree::computeSiteRepeats(TraversalInfo &info, size_t max_orig_nptn, size_t nptn) {
+    PhyloNeighbor *dad_branch = info.dad_branch;
+    PhyloNode *node = (PhyloNode*)dad_branch->node;
+    SiteRepeats &rep = dad_branch->site_repeats;
+    info.ptn_repeat = NULL;
+
+    if (node->degree() != 3) {
+        // multifurcating nodes are computed without repeats
+        rep.ptn_class.clear();
+        rep.ptn_repeat.clear();
+        rep.children.clear();
+        rep.stamp = 0;
+        return;
+    }
+
+    PhyloNeighbor *children[2];
+    int stamps[2], id = 0;
+    FOR_NEIGHBOR_IT(node, info.dad, it) {
+        children[id] = (PhyloNeighbor*)*it;
+        stamps[id] = children[id]->node->isLeaf() ? -1-children[id]->node->id : children[id]->site_repeats.stamp;
+        id++;
+    }
+
+    // reuse classes if the children did not change, e.g. only branch lengths were changed
+    if (rep.stamp > repeat_valid_stamp && rep.children.size() == 2 &&
+        rep.children[0].first == children[0] && rep.children[0].second == stamps[0] &&
+        rep.children[1].first == children[1] && rep.children[1].second == stamps[1])
+    {
+        if (!rep.ptn_repeat.empty())
+            info.ptn_repeat = &rep.ptn_repeat[0];
+        return;
+    }
+
+    rep.stamp = ++repeat_stamp;
+    rep.children.clear();
+    rep.children.push_back(make_pair(children[0], stamps[0]));
+    rep.children.push_back(make_pair(children[1], stamps[1]));
+    rep.ptn_class.clear();
+    rep.ptn_repeat.clear();
+    rep.num_class = nptn;
+
+    int *cls[2], num_cls[2];
+    size_t orig_nptn = aln->size();
+    size_t unobserved_nptn = max_orig_nptn + model_factory->unobserved_ptns.size();
+    size_t ptn;
+    repeat_leaf_class.resize(2*nptn);
+    for (id = 0; id < 2; id++) {
+        PhyloNeighbor *child = children[id];
+        if (child->node->isLeaf()) {
+            // leaf: class is the state, as used by the kernel
+            cls[id] = &repeat_leaf_class[id*nptn];
+            int leaf_id = child->node->id;
+            for (ptn = 0; ptn < nptn; ptn++) {
+                if (ptn < orig_nptn)
+                    cls[id][ptn] = (aln->at(ptn))[leaf_id];
+                else if (ptn >= max_orig_nptn && ptn < unobserved_nptn)
+                    cls[id][ptn] = model_factory->unobserved_ptns[ptn-max_orig_nptn];
+                else
+                    cls[id][ptn] = aln->STATE_UNKNOWN;
+            }
+            num_cls[id] = aln->STATE_UNKNOWN+1;
+        } else {
+            SiteRepeats &child_rep = child->site_repeats;
+            // (almost) all patterns differ in the child subtree, thus also here
+            if (child_rep.stamp <= repeat_valid_stamp || child_rep.ptn_class.size() != nptn)
+                return;
+            cls[id] = &child_rep.ptn_class[0];
+            num_cls[id] = child_rep.num_class;
+        }
+    }
+
+    combineRepeatClasses(cls[0], num_cls[0], cls[1], num_cls[1], ptn_invar, nptn, rep, repeat_table, repeat_order);
+
+    // not worth to keep if less than a quarter of patterns are repeats
+    if ((size_t)rep.num_class > nptn*3/4) {
+        rep.ptn_class.clear();
+        rep.ptn_repeat.clear();
+        return;
+    }
+    info.ptn_repeat = &rep.ptn_repeat[0];
+}
+
 double PhyloTree::computeLikelihoodBranch(PhyloNeighbor *dad_branch, PhyloNode *dad) {
 	return (this->*computeLikelihoodBranchPointer)(dad_branch, dad);
 
@@ -175,6 +443,10 @@ void PhyloTree::computeLikelihoodDerv(PhyloNeighbor *dad_branch, PhyloNode *dad,
 	(this->*computeLikelihoodDervPointer)(dad_branch, dad, df, ddf);
 }
 
+void PhyloTree::computeLikelihoodDervMulti(PhyloNeighbor *dad_branch, PhyloNode *dad, int num_len, double *len, double *lh, double *df, double *ddf) {
+	(this->*computeLikelihoodDervMultiPointer)(dad_branch, dad, num_len, len, lh, df, ddf);
+}
+
 
 double PhyloTree::computeLikelihoodFromBuffer() {
 	assert(current_it && current_it_back);
@@ -212,10 +484,7 @@ void PhyloTree::computeTipPartialLikelihood() {
         int nstates = aln->num_states;
         int nseq = aln->getNSeq();
         assert(vector_size > 0);
-#ifdef _OPENMP
-        #pragma omp parallel for schedule(static)
-#endif
-        for (int nodeid = 0; nodeid < nseq; nodeid++) {
+        ThreadPool::getInstance().run(nseq, [&](int nodeid) {
             int i, x, v;
             double *partial_lh = tip_partial_lh + tip_block_size*nodeid;
             size_t ptn;
@@ -303,7 +572,7 @@ void PhyloTree::computeTipPartialLikelihood() {
             // dummy values
 //            for (ptn = nptn; ptn < max_nptn; ptn++, partial_lh += nstates)
 //                memcpy(partial_lh, partial_lh-nstates, nstates*sizeof(double));
-        } // FOR nodeid
+        }); // FOR nodeid
         return;
     }
     
@@ -398,6 +667,10 @@ void PhyloTree::computePtnInvar() {
 
     double *state_freq = aligned_alloc<double>(nstates);
     model->getStateFrequency(state_freq);
+    // repeat classes depend on which sites are invariant
+    vector<bool> invar_sites(maxptn);
+    for (ptn = 0; ptn < maxptn; ptn++)
+        invar_sites[ptn] = (ptn_invar[ptn] != 0.0);
 	memset(ptn_invar, 0, maxptn*sizeof(double));
 	double p_invar = site_rate->getPInvar();
 	if (p_invar != 0.0) {
@@ -417,6 +690,11 @@ void PhyloTree::computePtnInvar() {
 			ptn_invar[ptn] = p_invar;
 	}
 	aligned_free(state_freq);
+    for (ptn = 0; ptn < maxptn; ptn++)
+        if (invar_sites[ptn] != (ptn_invar[ptn] != 0.0)) {
+            repeat_valid_stamp = repeat_stamp;
+            break;
+        }
 }
 
 /*******************************************************
@@ -35,6 +35,10 @@ StopRule::StopRule() : CheckpointFactory()
 	step_iteration = 100;
 	start_real_time = -1.0;
 	max_run_time = -1.0;
+	deadline = 0.0;
+	last_check_time = 0.0;
+	max_check_interval = 0.0;
+	deadline_reserve_iterations = 0;
 	curIteration = 0;
     should_stop = false;
 }
@@ -112,7 +116,7 @@ void StopRule::restoreCheckpoint() {
 //}
 
 bool StopRule::meetStopCondition(int cur_iteration, double cur_correlation) {
-    if (should_stop)
+    if (should_stop || meetDeadline())
         return true;
 	switch (stop_condition) {
 		case SC_FIXED_ITERATION:
@@ -133,6 +137,23 @@ bool StopRule::meetStopCondition(int cur_iteration, double cur_correlation) {
 	return false;
 }
 
+void StopRule::setDeadline(double deadline, int reserve_iterations) {
+	this->deadline = deadline;
+	deadline_reserve_iterations = reserve_iterations;
+	last_check_time = 0.0;
+	max_check_interval = 0.0;
+}
+
+bool StopRule::meetDeadline() {
+	if (deadline <= 0.0)
+		return false;
+	double now = getRealTime();
+	if (last_check_time > 0.0)
+		max_check_interval = max(max_check_interval, now - last_check_time);
+	last_check_time = now;
+	return now + (1 + deadline_reserve_iterations) * max_check_interval >= deadline;
+}
+
 double StopRule::getRemainingTime(int cur_iteration) {
 	double realtime_secs = getRealTime() - start_real_time;
 	int niterations;
@@ -154,7 +175,10 @@ double StopRule::getRemainingTime(int cur_iteration) {
 //			niterations = getLastImprovedIteration() + unsuccess_iteration;
 		break;
 	}
-	return (niterations - cur_iteration) * realtime_secs / (cur_iteration - 1);
+	double remaining_time = (niterations - cur_iteration) * realtime_secs / (cur_iteration - 1);
+	if (deadline > 0.0)
+		remaining_time = min(remaining_time, deadline - getRealTime());
+	return remaining_time;
 }
 
 //void StopRule::setStopCondition(STOP_CONDITION sc) {
@@ -216,6 +240,14 @@ int StopRule::getLastImprovedIteration() {
 	return time_vec[0];
 }
 
+void StopRule::adaptUnsuccessIteration(int min_it, int max_it) {
+	// time_vec holds the improved iterations, latest first
+	int max_gap = 0;
+	for (int i = 0; i+1 < time_vec.size(); i++)
+		max_gap = max(max_gap, (int)(time_vec[i] - time_vec[i+1]));
+	unsuccess_iteration = min(max(2*max_gap, min_it), max_it);
+}
+
 void StopRule::cmpInvMat (DoubleMatrix &oriMat, DoubleMatrix &invMat, int size) {
 	//invMat.setLimit (size, size);
 	double eps = 1.0e-20; /* ! */
@@ -72,6 +72,18 @@ public:
 	*/
 	int getLastImprovedIteration();
 
+	/**
+		Adapt the number of unsuccessful iterations to stop to twice the largest gap
+		between improved iterations observed so far
+		@param min_it lower bound on the number of unsuccessful iterations
+		@param max_it upper bound on the number of unsuccessful iterations
+	*/
+	void adaptUnsuccessIteration(int min_it, int max_it);
+
+	int getUnsuccessIteration() const {
+		return unsuccess_iteration;
+	}
+
 	/**
 		main function to check the stop condition
 		@param current_iteration current iteration number
@@ -91,6 +103,25 @@ public:
 	/** get the remaining time to converge, in seconds */
 	double getRemainingTime(int cur_iteration);
 
+	/**
+		set the wall-clock time by which the tree search must stop
+		@param deadline absolute time as returned by getRealTime(), <= 0 for no deadline
+		@param reserve_iterations number of iterations worth of time to keep after the search
+	*/
+	void setDeadline(double deadline, int reserve_iterations = 0);
+
+	/**
+		check whether the next iteration is expected to overrun the deadline, the iteration
+		time is estimated by the longest interval between two consecutive calls
+		@return TRUE if a deadline is set and would be overrun, FALSE otherwise
+	*/
+	bool meetDeadline();
+
+	/** @return the longest iteration time observed by meetDeadline(), in seconds */
+	double getIterationTime() const {
+		return max_check_interval;
+	}
+
 	/**
 		@return the number of iterations required to stop the search
 	*/
@@ -160,6 +191,18 @@ private:
 	/** max wall-clock running time to stop */
 	double max_run_time;
 
+	/** wall-clock time to stop the search, <= 0 for none */
+	double deadline;
+
+	/** time of the last call to meetDeadline() */
+	double last_check_time;
+
+	/** longest interval between two calls to meetDeadline() */
+	double max_check_interval;
+
+	/** number of iterations worth of time kept after the deadline */
+	int deadline_reserve_iterations;
+
     /** starting real time of the program */
     double start_real_time;
 
@@ -0,0 +1,177 @@
+/***************************************************************************
+ *   Copyright (C) 2009-2026 by                                            *
+ *   BUI Quang Minh <minh.bui@univie.ac.at>                                *
+ *                                                                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "threadpool.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace std;
+
+/** number of idle rounds before a worker goes to sleep */
+const int POOL_SPIN_COUNT = 10000;
+
+/** ID of the calling thread within the pool, -1 for threads outside the pool */
+static thread_local int pool_worker_id = -1;
+
+ThreadPool &ThreadPool::getInstance() {
+    // never destroyed: workers may still be blocked when the program exits
+    static ThreadPool *instance = new ThreadPool();
+    return *instance;
+}
+
+ThreadPool::ThreadPool() {
+    num_threads = 1;
+    num_pending = 0;
+    stopped = false;
+}
+
+void ThreadPool::init(int num_threads) {
+    if (num_threads == this->num_threads)
+        return;
+    stop();
+#ifdef _OPENMP
+    this->num_threads = max(num_threads, 1);
+#else
+    this->num_threads = 1;
+#endif
+    pool_worker_id = 0;
+    queues.assign(this->num_threads, vector<TaskGroup*>());
+    queue_mutex = vector<mutex>(this->num_threads);
+    num_pending = 0;
+    stopped = false;
+    for (int id = 1; id < this->num_threads; id++)
+        workers.push_back(thread(&ThreadPool::workerLoop, this, id));
+}
+
+void ThreadPool::stop() {
+    if (workers.empty())
+        return;
+    {
+        lock_guard<mutex> lock(sleep_mutex);
+        stopped = true;
+    }
+    sleep_cond.notify_all();
+    for (vector<thread>::iterator it = workers.begin(); it != workers.end(); it++)
+        it->join();
+    workers.clear();
+    num_threads = 1;
+}
+
+void ThreadPool::run(int num_tasks, const function<void(int)> &func) {
+    int id = pool_worker_id;
+#ifdef _OPENMP
+    // inside an OpenMP parallel region the other cores are already busy
+    if (omp_in_parallel())
+        id = -1;
+#endif
+    if (num_threads <= 1 || num_tasks <= 1 || id < 0) {
+        for (int task = 0; task < num_tasks; task++)
+            func(task);
+        return;
+    }
+
+    TaskGroup group;
+    group.func = &func;
+    group.num_tasks = num_tasks;
+    group.next = 0;
+    group.done = 0;
+    {
+        lock_guard<mutex> lock(queue_mutex[id]);
+        queues[id].push_back(&group);
+    }
+    {
+        lock_guard<mutex> lock(sleep_mutex);
+        num_pending++;
+    }
+    sleep_cond.notify_all();
+
+    // work on own tasks first, other workers steal the rest
+    int task;
+    while ((task = group.next++) < num_tasks) {
+        if (task == num_tasks-1)
+            num_pending--;
+        func(task);
+        group.done++;
+    }
+
+    {
+        lock_guard<mutex> lock(queue_mutex[id]);
+        vector<TaskGroup*> &queue = queues[id];
+        for (vector<TaskGroup*>::iterator it = queue.begin(); it != queue.end(); it++)
+            if (*it == &group) {
+                queue.erase(it);
+                break;
+            }
+    }
+
+    // help others while the stolen tasks are running
+    while (group.done < num_tasks) {
+        if (!executeOne(id))
+            this_thread::yield();
+    }
+}
+
+bool ThreadPool::executeOne(int worker_id) {
+    if (num_pending == 0)
+        return false;
+    for (int i = 0; i < num_threads; i++) {
+        int q = (worker_id + i) % num_threads;
+        TaskGroup *group = NULL;
+        int task = -1;
+        {
+            // claim under the lock, so that the owner cannot leave with the group
+            lock_guard<mutex> lock(queue_mutex[q]);
+            for (vector<TaskGroup*>::iterator it = queues[q].begin(); it != queues[q].end(); it++)
+                if ((*it)->next < (*it)->num_tasks && (task = (*it)->next++) < (*it)->num_tasks) {
+                    group = *it;
+                    break;
+                }
+        }
+        if (group) {
+            if (task == group->num_tasks-1)
+                num_pending--;
+            (*group->func)(task);
+            group->done++;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::workerLoop(int worker_id) {
+    pool_worker_id = worker_id;
+    int idle = 0;
+    while (!stopped) {
+        if (executeOne(worker_id)) {
+            idle = 0;
+            continue;
+        }
+        if (++idle < POOL_SPIN_COUNT) {
+            this_thread::yield();
+            continue;
+        }
+        unique_lock<mutex> lock(sleep_mutex);
+        sleep_cond.wait(lock, [this] { return stopped || num_pending > 0; });
+        idle = 0;
+    }
+}
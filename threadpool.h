@@ -0,0 +1,120 @@
+/***************************************************************************
+ *   Copyright (C) 2009-2026 by                                            *
+ *   BUI Quang Minh <minh.bui@univie.ac.at>                                *
+ *                                                                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <vector>
+#include <functional>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+/**
+    group of independent tasks 0..num_tasks-1 submitted by one thread
+*/
+struct TaskGroup {
+    /** function to execute a task */
+    const std::function<void(int)> *func;
+
+    /** number of tasks */
+    int num_tasks;
+
+    /** next task to be claimed */
+    std::atomic<int> next;
+
+    /** number of finished tasks */
+    std::atomic<int> done;
+};
+
+/**
+    process-wide pool of worker threads for the likelihood kernels and partition loops.
+    Each worker keeps its own queue of task groups; idle workers steal tasks
+    from the oldest groups of other workers, and a thread waiting for its group
+    executes other tasks meanwhile. Partition-level and pattern-level tasks thus
+    share the same cores without nested parallel regions.
+*/
+class ThreadPool {
+public:
+
+    /** @return the single instance of the pool */
+    static ThreadPool &getInstance();
+
+    /**
+        start the worker threads, the calling thread becomes worker 0
+        @param num_threads total number of threads
+    */
+    void init(int num_threads);
+
+    /** stop all worker threads */
+    void stop();
+
+    /** @return total number of threads including the calling thread */
+    int getNumThreads() { return num_threads; }
+
+    /**
+        execute func(0), ..., func(num_tasks-1) in parallel and wait for them.
+        The calling thread takes part in the work. Calls from threads outside
+        the pool or with a single task are executed sequentially.
+        @param num_tasks number of tasks
+        @param func function to execute a task
+    */
+    void run(int num_tasks, const std::function<void(int)> &func);
+
+protected:
+
+    ThreadPool();
+
+    /** main loop of a worker thread */
+    void workerLoop(int worker_id);
+
+    /**
+        claim and execute one task from any queue, starting with the queue of worker_id
+        @return TRUE if a task was executed, FALSE if no task was available
+    */
+    bool executeOne(int worker_id);
+
+    /** total number of threads */
+    int num_threads;
+
+    /** worker threads, excluding the master thread */
+    std::vector<std::thread> workers;
+
+    /** task group queues, one per thread */
+    std::vector<std::vector<TaskGroup*> > queues;
+
+    /** mutexes protecting queues */
+    std::vector<std::mutex> queue_mutex;
+
+    /** number of task groups with unclaimed tasks */
+    std::atomic<int> num_pending;
+
+    /** TRUE to stop all workers */
+    std::atomic<bool> stopped;
+
+    /** mutex and condition for sleeping workers */
+    std::mutex sleep_mutex;
+    std::condition_variable sleep_cond;
+
+};
+
+#endif // THREADPOOL_H
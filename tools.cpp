@@ -730,6 +730,7 @@ void parseArg(int argc, char *argv[], Params &params) {
     params.partition_file = NULL;
     params.partition_type = 0;
     params.partfinder_rcluster = 100;
+    params.partfinder_rcluster_max = 0;
     params.remove_empty_seq = true;
     params.terrace_aware = true;
     params.sequence_type = NULL;
@@ -772,6 +773,9 @@ void parseArg(int argc, char *argv[], Params &params) {
     params.model_test_again = false;
     params.model_test_and_tree = 0;
     params.model_test_separate_rate = false;
+    params.model_test_parallel = false;
+    params.model_cache_dir = NULL;
+    params.model_prune_margin = 0.0;
     params.optimize_mixmodel_weight = false;
     params.optimize_rate_matrix = false;
     params.store_trans_matrix = false;
@@ -810,6 +814,12 @@ void parseArg(int argc, char *argv[], Params &params) {
     params.lk_no_avx = 0;
     params.lk_safe_scaling = false;
     params.numseq_safe_scaling = 2000;
+    params.lk_float_storage = false;
+    params.lk_float_tolerance = 1e-6;
+    params.lk_dag_max_ptn = 1000;
+    params.nni_workers = 1;
+    params.num_searchers = 1;
+    params.lk_site_repeats = true;
     params.print_site_lh = WSL_NONE;
     params.print_partition_lh = false;
     params.print_site_prob = WSL_NONE;
@@ -877,6 +887,7 @@ void parseArg(int argc, char *argv[], Params &params) {
     params.new_heuristic = true;
     params.iteration_multiple = 1;
     params.initPS = 0.5;
+    params.adaptive_search = false;
 #ifdef USING_PLL
     params.pll = true;
 #else
@@ -886,12 +897,18 @@ void parseArg(int argc, char *argv[], Params &params) {
     params.parbran = false;
     params.binary_aln_file = NULL;
     params.maxtime = 1000000;
+    params.deadline = 0.0;
     params.reinsert_par = false;
     params.bestStart = true;
     params.snni = true; // turn on sNNI default now
 //    params.autostop = true; // turn on auto stopping rule by default now
     params.unsuccess_iteration = 100;
     params.speednni = true; // turn on reduced hill-climbing NNI by default now
+    params.nni_radius = 2;
+    params.nni_incremental = false;
+    params.lh_spr = false;
+    params.lh_spr_radius = 5;
+    params.lh_spr_top = 3;
     params.numInitTrees = 100;
     params.fixStableSplits = false;
     params.stableSplitThreshold = 0.9;
@@ -902,6 +919,7 @@ void parseArg(int argc, char *argv[], Params &params) {
     params.numSupportTrees = 20;
 //    params.sprDist = 20;
     params.sprDist = 6;
+    params.pars_spr = false;
     params.numNNITrees = 20;
     params.avh_test = 0;
     params.bootlh_test = 0;
@@ -924,6 +942,8 @@ void parseArg(int argc, char *argv[], Params &params) {
 	params.count_trees = false;
 	params.print_branch_lengths = false;
 	params.lh_mem_save = LM_PER_NODE; // auto detect
+    params.lh_mem_spill = false;
+    params.mem_evict_policy = MEM_EVICT_SIZE;
 	params.start_tree = STT_PLL_PARSIMONY;
 	params.print_splits_file = false;
     params.ignore_identical_seqs = true;
@@ -1600,6 +1620,15 @@ void parseArg(int argc, char *argv[], Params &params) {
                 if (params.partfinder_rcluster < 0 || params.partfinder_rcluster > 100)
                     throw "rcluster percentage must be between 0 and 100";
 				continue;
+            }
+            if (strcmp(argv[cnt], "-rcluster-max") == 0) {
+				cnt++;
+				if (cnt >= argc)
+					throw "Use -rcluster-max <num>";
+                params.partfinder_rcluster_max = convert_int(argv[cnt]);
+                if (params.partfinder_rcluster_max < 0)
+                    throw "rcluster-max must not be negative";
+				continue;
             }
 			if (strcmp(argv[cnt], "-keep_empty_seq") == 0) {
 				params.remove_empty_seq = false;
@@ -1741,6 +1770,10 @@ void parseArg(int argc, char *argv[], Params &params) {
 				params.initPS = convert_double(argv[cnt]);
 				continue;
 			}
+			if (strcmp(argv[cnt], "-adapt") == 0) {
+				params.adaptive_search = true;
+				continue;
+			}
 			if (strcmp(argv[cnt], "-n") == 0) {
 				cnt++;
 				if (cnt >= argc)
@@ -1838,6 +1871,26 @@ void parseArg(int argc, char *argv[], Params &params) {
 				params.model_test_separate_rate = true;
 				continue;
 			}
+			if (strcmp(argv[cnt], "-mpar") == 0) {
+				params.model_test_parallel = true;
+				continue;
+			}
+			if (strcmp(argv[cnt], "-mprune") == 0) {
+				cnt++;
+				if (cnt >= argc)
+					throw "Use -mprune <margin>";
+				params.model_prune_margin = convert_double(argv[cnt]);
+				if (params.model_prune_margin < 0)
+					throw "Negative -mprune margin";
+				continue;
+			}
+			if (strcmp(argv[cnt], "-mcache") == 0) {
+				cnt++;
+				if (cnt >= argc)
+					throw "Use -mcache <directory>";
+				params.model_cache_dir = argv[cnt];
+				continue;
+			}
 			if (strcmp(argv[cnt], "-mwopt") == 0) {
 				params.optimize_mixmodel_weight = true;
 				continue;
@@ -1929,6 +1982,54 @@ void parseArg(int argc, char *argv[], Params &params) {
 				continue;
 			}
 
+			if (strcmp(argv[cnt], "-lhfloat") == 0) {
+				params.lk_float_storage = true;
+				continue;
+			}
+
+			if (strcmp(argv[cnt], "-lhfloat-eps") == 0) {
+				cnt++;
+				if (cnt >= argc)
+                    throw "Use -lhfloat-eps <relative_tolerance>";
+				params.lk_float_tolerance = convert_double(argv[cnt]);
+                if (params.lk_float_tolerance < 0.0)
+                    throw "-lhfloat-eps must not be negative";
+				continue;
+			}
+
+			if (strcmp(argv[cnt], "-dag") == 0) {
+				cnt++;
+				if (cnt >= argc)
+                    throw "Use -dag <max_patterns_per_thread>";
+				params.lk_dag_max_ptn = convert_int(argv[cnt]);
+                if (params.lk_dag_max_ptn < 0)
+                    throw "-dag must not be negative";
+				continue;
+			}
+			if (strcmp(argv[cnt], "-nnipar") == 0) {
+				cnt++;
+				if (cnt >= argc)
+                    throw "Use -nnipar <num_branches>";
+				params.nni_workers = convert_int(argv[cnt]);
+                if (params.nni_workers < 1)
+                    throw "-nnipar must be positive";
+				continue;
+			}
+			if (strcmp(argv[cnt], "-nsearch") == 0) {
+				cnt++;
+				if (cnt >= argc)
+                    throw "Use -nsearch <num_searchers>";
+				params.num_searchers = convert_int(argv[cnt]);
+                if (params.num_searchers < 1)
+                    throw "-nsearch must be positive";
+				continue;
+			}
+
+			if (strcmp(argv[cnt], "-norepeat") == 0) {
+				params.lk_site_repeats = false;
+				continue;
+			}
+
 
 			if (strcmp(argv[cnt], "-f") == 0) {
 				cnt++;
@@ -2528,12 +2629,14 @@ void parseArg(int argc, char *argv[], Params &params) {
 			}
 			if (strcmp(argv[cnt], "-upNNI") == 0) {
  				params.upper_bound_NNI = true;
+				continue;
 			}
 			if (strcmp(argv[cnt], "-upFrac") == 0) {
 				cnt++;
 				if (cnt >= argc)
 				  throw "Use -upFrac <fraction>";
 				params.upper_bound_frac = convert_double(argv[cnt]);
+				continue;
 			}
 			if (strcmp(argv[cnt], "-ecoR") == 0) {
 				cnt++;
@@ -2641,6 +2744,26 @@ void parseArg(int argc, char *argv[], Params &params) {
                 }
 				continue;
 			}
+			if (strcmp(argv[cnt], "-spill") == 0) {
+				params.lh_mem_spill = true;
+				continue;
+			}
+			if (strcmp(argv[cnt], "-mem-evict") == 0) {
+				cnt++;
+				if (cnt >= argc)
+					throw "Use -mem-evict size|lru|weighted|nni";
+				if (strcmp(argv[cnt], "size") == 0)
+					params.mem_evict_policy = MEM_EVICT_SIZE;
+				else if (strcmp(argv[cnt], "lru") == 0)
+					params.mem_evict_policy = MEM_EVICT_LRU;
+				else if (strcmp(argv[cnt], "weighted") == 0)
+					params.mem_evict_policy = MEM_EVICT_WEIGHTED;
+				else if (strcmp(argv[cnt], "nni") == 0)
+					params.mem_evict_policy = MEM_EVICT_NNI;
+				else
+					throw "Use -mem-evict size|lru|weighted|nni";
+				continue;
+			}
 //			if (strcmp(argv[cnt], "-storetrees") == 0) {
 //				params.store_candidate_trees = true;
 //				continue;
@@ -2695,6 +2818,16 @@ void parseArg(int argc, char *argv[], Params &params) {
 				params.stop_condition = SC_REAL_TIME;
 				continue;
 			}
+			if (strcmp(argv[cnt], "-deadline") == 0) {
+				cnt++;
+				if (cnt >= argc)
+					throw "Use -deadline <time_in_minutes>";
+				double minutes = convert_double(argv[cnt]);
+				if (minutes <= 0)
+					throw "-deadline must be positive";
+				params.deadline = getRealTime() + minutes * 60;
+				continue;
+			}
 			if (strcmp(argv[cnt], "-numpars") == 0 || strcmp(argv[cnt], "-ninit") == 0) {
 				cnt++;
 				if (cnt >= argc)
@@ -2849,6 +2982,43 @@ void parseArg(int argc, char *argv[], Params &params) {
 				params.speednni = false;
 				continue;
 			}
+			if (strcmp(argv[cnt], "-nnirad") == 0) {
+				cnt++;
+				if (cnt >= argc)
+					throw "Use -nnirad <radius>";
+				params.nni_radius = convert_int(argv[cnt]);
+                if (params.nni_radius < 1)
+                    throw "-nnirad must be positive";
+				continue;
+			}
+			if (strcmp(argv[cnt], "-nniinc") == 0) {
+				params.nni_incremental = true;
+				continue;
+			}
+			if (strcmp(argv[cnt], "-lspr") == 0) {
+				params.lh_spr = true;
+				continue;
+			}
+			if (strcmp(argv[cnt], "-lsprrad") == 0) {
+				cnt++;
+				if (cnt >= argc)
+					throw "Use -lsprrad <radius>";
+				params.lh_spr_radius = convert_int(argv[cnt]);
+                if (params.lh_spr_radius < 1)
+                    throw "-lsprrad must be positive";
+				params.lh_spr = true;
+				continue;
+			}
+			if (strcmp(argv[cnt], "-lsprtop") == 0) {
+				cnt++;
+				if (cnt >= argc)
+					throw "Use -lsprtop <number>";
+				params.lh_spr_top = convert_int(argv[cnt]);
+                if (params.lh_spr_top < 1)
+                    throw "-lsprtop must be positive";
+				params.lh_spr = true;
+				continue;
+			}
             
 			if (strcmp(argv[cnt], "-snni") == 0) {
 				params.snni = true;
@@ -3056,6 +3226,10 @@ void parseArg(int argc, char *argv[], Params &params) {
 				params.sprDist = convert_int(argv[cnt]);
 				continue;
 			}
+			if (strcmp(argv[cnt], "-parsspr") == 0) {
+				params.pars_spr = true;
+				continue;
+			}
 			if (strcmp(argv[cnt], "-no_rescale_gamma_invar") == 0) {
 				params.no_rescale_gamma_invar = true;
 				continue;
@@ -3216,6 +3390,18 @@ void parseArg(int argc, char *argv[], Params &params) {
     if (params.lh_mem_save == LM_MEM_SAVE && params.partition_file)
         outError("-mem option does not work with partition models yet");
 
+    if (params.lk_float_storage && params.partition_file)
+        outError("-lhfloat option does not work with partition models yet");
+
+    if (params.lk_float_storage && (params.print_ancestral_sequence != AST_NONE || params.upper_bound_NNI))
+        outError("-lhfloat option does not work with ancestral sequence reconstruction or -upNNI yet");
+
+    if (params.upper_bound_NNI && params.nni5) {
+        // the bound only covers the central branch, not the 4 adjacent branches optimized by -nni5
+        outWarning("-upNNI requires -nni1, option ignored");
+        params.upper_bound_NNI = false;
+    }
+
     if (!params.out_prefix) {
     	if (params.eco_dag_file)
     		params.out_prefix = params.eco_dag_file;
@@ -3327,6 +3513,12 @@ void usage_iqtree(char* argv[], bool full_command) {
             << "  -pre <PREFIX>        Using <PREFIX> for output files (default: aln/partition)" << endl
 #ifdef _OPENMP
             << "  -nt <#cpu_cores>     Number of cores/threads to use (REQUIRED)" << endl
+            << "  -dag <num>           Compute subtrees concurrently if #patterns per thread is" << endl
+            << "                       at most <num> (default: 1000; 0 to disable)" << endl
+            << "  -nnipar <num>        Evaluate NNIs of <num> branches concurrently, each on" << endl
+            << "                       its own tree copy (default: 1)" << endl
+            << "  -nsearch <num>       Perturb and optimize <num> candidate trees in parallel" << endl
+            << "                       per search iteration (default: 1)" << endl
 #endif
             << "  -seed <number>       Random seed number, normally used for debugging purpose" << endl
             << "  -v, -vv, -vvv        Verbose mode, printing more messages to screen" << endl
@@ -3334,6 +3526,14 @@ void usage_iqtree(char* argv[], bool full_command) {
             << "  -keep-ident          Keep identical sequences (default: remove & finally add)" << endl
             << "  -safe                Safe likelihood kernel to avoid numerical underflow" << endl
             << "  -mem RAM             Maximal RAM usage for memory saving mode" << endl
+            << "  -spill               Page evicted partial likelihoods of memory saving mode" << endl
+            << "                       to a scratch file instead of recomputing them" << endl
+            << "  -mem-evict <policy>  Slot evicted in memory saving mode: size (smallest subtree," << endl
+            << "                       default), lru, weighted (size/age) or nni (keep NNI branch)" << endl
+            << "  -lhfloat             Store partial likelihoods in single precision (half RAM)" << endl
+            << "  -lhfloat-eps <num>   Relative log-likelihood tolerance of -lhfloat against" << endl
+            << "                       double precision (default: 1e-6, 0 to skip the check)" << endl
+            << "  -norepeat            Do not reuse partial likelihoods of repeated subtree patterns" << endl
             << endl << "CHECKPOINTING TO RESUME STOPPED RUN:" << endl
             << "  -redo                Redo analysis even for successful runs (default: resume)" << endl
             << "  -cptime <seconds>    Minimum checkpoint time interval (default: 20)" << endl
@@ -3348,9 +3548,21 @@ void usage_iqtree(char* argv[], bool full_command) {
             << "  -nbest <number>      Number of best trees retained during search (defaut: 5)" << endl
             << "  -n <#iterations>     Fix number of iterations to <#iterations> (default: auto)" << endl
             << "  -nstop <number>      Number of unsuccessful iterations to stop (default: 100)" << endl
+            << "  -deadline <minutes>  Wall-clock limit of the whole run: phases are shortened so" << endl
+            << "                       that final trees are written before the limit" << endl
             << "  -pers <proportion>   Perturbation strength for randomized NNI (default: 0.5)" << endl
+            << "  -adapt               Adapt perturbation strength, number of top trees perturbed" << endl
+            << "                       and -nstop to the search progress (default: off)" << endl
             << "  -sprrad <number>     Radius for parsimony SPR search (default: 6)" << endl
+            << "  -parsspr             Improve parsimony start trees by parsimony SPR (default: off)" << endl
             << "  -allnni              Perform more thorough NNI search (default: off)" << endl
+            << "  -nnirad <number>     Radius of branches re-evaluated around applied NNIs (default: 2)" << endl
+            << "  -nniinc              Keep NNI scores of branches away from applied NNIs" << endl
+            << "  -upNNI               Skip NNIs whose likelihood upper bound is below current score (with -nni1)" << endl
+            << "  -upFrac <fraction>   Relative slack added to the upper bound test (default: 0)" << endl
+            << "  -lspr                Alternate NNI search with likelihood SPR rounds (default: off)" << endl
+            << "  -lsprrad <number>    Radius of regraft positions for likelihood SPR (default: 5)" << endl
+            << "  -lsprtop <number>    Number of best regraft positions fully optimized (default: 3)" << endl
             << "  -g <constraint_tree> (Multifurcating) topological constraint tree file" << endl
 //            << "  -iqp                 Use the IQP tree perturbation (default: randomized NNI)" << endl
 //            << "  -iqpnni              Switch back to the old IQPNNI tree search algorithm" << endl
@@ -3383,6 +3595,7 @@ void usage_iqtree(char* argv[], bool full_command) {
             << "  -m TESTNEWMERGEONLY  Like -m TESTMERGEONLY but includes FreeRate heterogeneity" << endl
             << "  -m TESTNEWMERGE      Like -m TESTNEWMERGEONLY followed by tree reconstruction" << endl
             << "  -rcluster <percent>  Percentage of partition pairs (relaxed clustering alg.)" << endl
+            << "  -rcluster-max <num>  Max number of partition pairs per merging step (0: no limit)" << endl
             << "  -mset program        Restrict search to models supported by other programs" << endl
             << "                       (i.e., raxml, phyml or mrbayes)" << endl
             << "  -mset m1,...,mk      Restrict search to models in a comma-separated list" << endl
@@ -3399,6 +3612,11 @@ void usage_iqtree(char* argv[], bool full_command) {
 //            << "  -msep                Perform model selection and then rate selection" << endl
             << "  -mtree               Performing full tree search for each model considered" << endl
             << "  -mredo               Ignoring model results computed earlier (default: no)" << endl
+            << "  -mpar                Fit candidate models in parallel, one matrix per thread" << endl
+            << "  -mcache <directory>  Reuse models fitted to identical data and starting tree by" << endl
+            << "                       other runs, and store new ones in this directory" << endl
+            << "  -mprune <margin>     Skip +I+G and +R models of matrices whose +G model is more than" << endl
+            << "                       <margin> criterion units behind the best model (default: 0, off)" << endl
             << "  -madd mx1,...,mxk    List of mixture models to also consider" << endl
             << "  -mdef <nexus_file>   A model definition NEXUS file (see Manual)" << endl
 
@@ -433,6 +433,12 @@ enum LhMemSave {
 	LM_PER_NODE, LM_MEM_SAVE
 };
 
+/** which slot memory saving mode evicts: smallest subtree, least recently used,
+    subtree size divided by time since last use, or smallest subtree away from the current NNI branch */
+enum MemEvictPolicy {
+    MEM_EVICT_SIZE, MEM_EVICT_LRU, MEM_EVICT_WEIGHTED, MEM_EVICT_NNI
+};
+
 enum SiteLoglType {
     WSL_NONE, WSL_SITE, WSL_RATECAT, WSL_MIXTURE, WSL_MIXTURE_RATECAT
 };
@@ -582,6 +588,11 @@ public:
 	 */
 	int sprDist;
 
+	/**
+	 *  TRUE to improve IQ-TREE parsimony start trees by parsimony SPR with radius sprDist
+	 */
+	bool pars_spr;
+
 	/**
 	 *  Number of NNI locally optimal trees generated from the set of parsimony trees
 	 *  Default = 20 (out of 100 parsimony trees)
@@ -606,12 +617,44 @@ public:
 	 */
 	bool speednni;
 
+	/**
+	 *  radius (number of branches) around the applied NNIs re-evaluated by speednni, default: 2
+	 */
+	int nni_radius;
+
+	/**
+	 *  TRUE to cache the best positive NNI of each branch, so that speednni keeps the scores of
+	 *  branches outside nni_radius and re-evaluates them only before applying
+	 */
+	bool nni_incremental;
+
+	/**
+	 *  TRUE to alternate the NNI search with rounds of likelihood SPR moves
+	 */
+	bool lh_spr;
+
+	/**
+	 *  radius (number of branches) of regraft positions for likelihood SPR, default: 5
+	 */
+	int lh_spr_radius;
+
+	/**
+	 *  number of best regraft positions per subtree whose branch lengths are optimized, default: 3
+	 */
+	int lh_spr_top;
+
 
 	/**
 	 *  portion of NNI used for perturbing the tree
 	 */
 	double initPS;
 
+	/**
+	 *  TRUE to adapt the perturbation strength, the number of top trees to perturb
+	 *  and the number of unsuccessful iterations to the progress of the search
+	 */
+	bool adaptive_search;
+
 	/**
 	 *  logl epsilon for model parameter optimization
 	 */
@@ -689,6 +732,12 @@ public:
      */
     double maxtime;
 
+    /**
+     *  Wall-clock time (as returned by getRealTime()) by which the whole run must have
+     *  written its final trees, 0 for no deadline
+     */
+    double deadline;
+
     /**
      *  Turn on parsimony branch length estimation
      */
@@ -784,6 +833,9 @@ public:
     /** percentage for rcluster algorithm like PartitionFinder */
     double partfinder_rcluster; 
 
+    /** maximal number of partition pairs examined per merging step, 0 for no limit */
+    int partfinder_rcluster_max;
+
     /** remove all-gap sequences in partition model to account for terrace default: TRUE */
     bool remove_empty_seq;
 
@@ -1258,6 +1310,17 @@ public:
     /** true to fist test equal rate model, then test rate heterogeneity (default: false) */
     bool model_test_separate_rate;
 
+    /** true to fit independent candidate models concurrently in model testing, one matrix per thread,
+        without warm starts from nested matrices (default: false) */
+    bool model_test_parallel;
+
+    /** directory of the model cache shared across runs, NULL to not use it */
+    char *model_cache_dir;
+
+    /** skip the +I+G and +R models of a matrix whose +G model is worse than the best model by more than
+        max(model_prune_margin, twice the largest gain of such a model over +G seen so far), 0 to test all */
+    double model_prune_margin;
+
     /** TRUE to optimize mixture model weights */
     bool optimize_mixmodel_weight;
 
@@ -1458,6 +1521,28 @@ public:
     /** minimum number of sequences to always use safe scaling, default: 2000 */
     int numseq_safe_scaling;
 
+    /** TRUE to store partial likelihood vectors in single precision, default: FALSE */
+    bool lk_float_storage;
+
+    /** maximal relative log-likelihood difference between single and double precision storage,
+        default: 1e-6, 0 to skip the comparison */
+    double lk_float_tolerance;
+
+    /** maximal number of patterns per thread to compute partial likelihoods as a task graph
+        over subtrees and pattern blocks (0 to disable), default: 1000 */
+    int lk_dag_max_ptn;
+
+    /** number of branches whose NNIs are evaluated concurrently, each on its own
+        copy of the tree (1 to disable), default: 1 */
+    int nni_workers;
+
+    /** number of threads each perturbing a candidate tree and optimizing it by NNI
+        in every search iteration (1 to disable), default: 1 */
+    int num_searchers;
+
+    /** TRUE to compute partial likelihoods only once for patterns repeated within a subtree, default: TRUE */
+    bool lk_site_repeats;
+
     /**
      	 	WSL_NONE: do not print anything
             WSL_SITE: print site log-likelihood
@@ -1827,6 +1912,12 @@ public:
     /** maximum size of memory allowed to use */
     double max_mem_size;
 
+    /** TRUE to spill evicted partial likelihoods of memory saving mode to a scratch file */
+    bool lh_mem_spill;
+
+    /** eviction policy of memory saving mode */
+    MemEvictPolicy mem_evict_policy;
+
 	/* TRUE to print .splits file in star-dot format */
 	bool print_splits_file;
     
@@ -2314,11 +2405,11 @@ int random_int(int n, int *rstream = NULL);
 double random_double(int *rstream = NULL);
 
 template <class T>
-void my_random_shuffle (T first, T last)
+void my_random_shuffle (T first, T last, int *rstream = NULL)
 {
 	int n = last - first;
 	for (int i=n-1; i>0; --i) {
-		swap (first[i],first[random_int(i+1)]);
+		swap (first[i],first[random_int(i+1, rstream)]);
 	}
 }
 
@@ -670,29 +670,29 @@ NNIMove getBestNNIForBranUB(PhyloNode *node1, PhyloNode *node2, PhyloTree *tree)
     clear_pl_lh[0] = clear_pl_lh[1] = clear_pl_lh[2] = clear_pl_lh[3] = 1;
 
     double* T1_partial_lh;
-    if(((PhyloNeighbor*) (*nniMoves[0].node1Nei_it))->get_partial_lh_computed() == 0){
-    	tree->computePartialLikelihood((PhyloNeighbor*) (*nniMoves[0].node1Nei_it), node1);
+    if((((PhyloNeighbor*) (*nniMoves[0].node1Nei_it))->get_partial_lh_computed() & 1) == 0){
+    	tree->computeLikelihoodBranch((PhyloNeighbor*) (*nniMoves[0].node1Nei_it), node1);
     	clear_pl_lh[0] = 0;
     }
     T1_partial_lh = ((PhyloNeighbor*) (*nniMoves[0].node1Nei_it))->get_partial_lh();
 
     double* T2_partial_lh;
-    if(((PhyloNeighbor*) (*node1Nei2_it))->get_partial_lh_computed() == 0){
-    	tree->computePartialLikelihood(((PhyloNeighbor*) (*node1Nei2_it)), node1);
+    if((((PhyloNeighbor*) (*node1Nei2_it))->get_partial_lh_computed() & 1) == 0){
+    	tree->computeLikelihoodBranch(((PhyloNeighbor*) (*node1Nei2_it)), node1);
     	clear_pl_lh[1] = 0;
     }
     T2_partial_lh = ((PhyloNeighbor*) (*node1Nei2_it))->get_partial_lh();
 
     double* T3_partial_lh;
-    if(((PhyloNeighbor*) (*nniMoves[0].node2Nei_it))->get_partial_lh_computed() == 0){
-    	tree->computePartialLikelihood(((PhyloNeighbor*) (*nniMoves[0].node2Nei_it)), node1);
+    if((((PhyloNeighbor*) (*nniMoves[0].node2Nei_it))->get_partial_lh_computed() & 1) == 0){
+    	tree->computeLikelihoodBranch(((PhyloNeighbor*) (*nniMoves[0].node2Nei_it)), node1);
     	clear_pl_lh[2] = 0;
     }
     T3_partial_lh = ((PhyloNeighbor*) (*nniMoves[0].node2Nei_it))->get_partial_lh();
 
     double* T4_partial_lh;
-    if(((PhyloNeighbor*) (*nniMoves[1].node2Nei_it))->get_partial_lh_computed() == 0){
-    	tree->computePartialLikelihood(((PhyloNeighbor*) (*nniMoves[1].node2Nei_it)), node1);
+    if((((PhyloNeighbor*) (*nniMoves[1].node2Nei_it))->get_partial_lh_computed() & 1) == 0){
+    	tree->computeLikelihoodBranch(((PhyloNeighbor*) (*nniMoves[1].node2Nei_it)), node1);
     	clear_pl_lh[3] = 0;
     }
     T4_partial_lh = ((PhyloNeighbor*) (*nniMoves[1].node2Nei_it))->get_partial_lh();
@@ -806,6 +806,57 @@ NNIMove getBestNNIForBranUB(PhyloNode *node1, PhyloNode *node2, PhyloTree *tree)
 	}
 }
 
+double UpperBoundBranch(PhyloNode *node1, PhyloNode *node2, PhyloTree *tree){
+	ModelFactory *model_factory = tree->getModelFactory();
+	ModelSubst *model = tree->getModel();
+	RateHeterogeneity *site_rate = tree->getRate();
+	if (tree->isSuperTree() || !tree->computeLikelihoodDervPointer || model->isSiteSpecificModel() ||
+		!model_factory->unobserved_ptns.empty())
+		return 0.0;
+
+	// fill theta_all, the partial likelihoods of both ends multiplied in the eigen space
+	double df, ddf;
+	tree->theta_computed = false;
+	tree->computeLikelihoodDerv((PhyloNeighbor*) node1->findNeighbor(node2), node1, df, ddf);
+
+	/*
+	 * The likelihood of a pattern is the sum over categories c and states i of
+	 * prop[c] * theta[c][i] * exp(eval[i] * rate[c] * t), where every eval[i] <= 0.
+	 * Each term is at most max(theta[c][i], 0) for all t >= 0.
+	 */
+	size_t nstates = tree->aln->num_states;
+	size_t ncat = site_rate->getNRate();
+	size_t ncat_mix = (model_factory->fused_mix_rate) ? ncat : ncat*model->getNMixtures();
+	size_t denom = (model_factory->fused_mix_rate) ? 1 : ncat;
+	size_t block = ncat_mix * nstates;
+	size_t vsize = tree->vector_size;
+	double prop[ncat_mix];
+	for (size_t c = 0; c < ncat_mix; c++)
+		prop[c] = site_rate->getProp(c%ncat) * model->getMixtureWeight(c/denom);
+
+	double UB = 0.0;
+	size_t nptn = tree->aln->size();
+	for (size_t ptn = 0; ptn < nptn; ptn++) {
+		// SIMD kernels interleave the patterns of one vector
+		double *theta = tree->theta_all + (ptn/vsize)*vsize*block + ptn%vsize;
+		double lh = tree->ptn_invar[ptn];
+		for (size_t c = 0; c < ncat_mix; c++)
+			for (size_t i = 0; i < nstates; i++) {
+				double val = theta[(c*nstates+i)*vsize];
+				if (val > 0.0)
+					lh += prop[c] * val;
+			}
+		if (lh <= 0.0) {
+			tree->theta_computed = false;
+			return 0.0;
+		}
+		UB += (log(lh) + tree->buffer_scale_all[ptn]) * tree->ptn_freq[ptn];
+	}
+	// theta_all may be reused only for the branch given by current_it
+	tree->theta_computed = false;
+	return UB;
+}
+
 double logC(double t, PhyloTree* tree){
 	//double c = log((1+3*exp(-t)))-log(1-exp(-t));
 
@@ -840,14 +891,14 @@ void sumFraction(PhyloNode *node1, PhyloNode *node2, PhyloTree *tree){
 //	int loglh = tree->computeLikelihood();
 
     double* T1_partial_lh;
-    if(nei1->get_partial_lh_computed() == 0){
-    	tree->computePartialLikelihood(nei1, node1);
+    if((nei1->get_partial_lh_computed() & 1) == 0){
+    	tree->computeLikelihoodBranch(nei1, node1);
     }
     T1_partial_lh = nei1->get_partial_lh();
 
     double* T2_partial_lh;
-    if(nei2->get_partial_lh_computed() == 0){
-    	tree->computePartialLikelihood(nei2, node2);
+    if((nei2->get_partial_lh_computed() & 1) == 0){
+    	tree->computeLikelihoodBranch(nei2, node2);
     }
     T2_partial_lh = nei2->get_partial_lh();
 
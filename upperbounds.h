@@ -77,6 +77,12 @@ NodeVector getBranchABid(double brLen, PhyloTree* tree);
  * Applying UBs to NNI search
  */
 NNIMove getBestNNIForBranUB(PhyloNode *node1, PhyloNode *node2, PhyloTree *tree);
+
+/*
+ * Upper bound of the log-likelihood of tree over all lengths of the branch node1-node2,
+ * the other branch lengths are fixed. Returns 0.0 if no bound is available for the model.
+ */
+double UpperBoundBranch(PhyloNode *node1, PhyloNode *node2, PhyloTree *tree);
 double logC(double t, PhyloTree* tree);
 
 /**
@@ -350,6 +350,12 @@ static inline Vec1d nmul_add(Vec1d const & a, Vec1d const & b, Vec1d const & c)
     return c - a * b;
 }
 
+// Select between two operands. Corresponds to this pseudocode:
+// for (int i = 0; i < 1; i++) result[i] = s[i] ? a[i] : b[i];
+static inline Vec1d select (Vec1db const & s, Vec1d const & a, Vec1d const & b) {
+    return Vec1d(s.xmm ? a.xmm : b.xmm);
+}
+
 
 /*****************************************************************************
 *